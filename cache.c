@@ -0,0 +1,228 @@
+/* cache.c - cache of map, info and smallOnes files
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -c the map, info, smallOnes and text files written are kept in a
+ * cache directory, named for a hash of everything that goes into them:
+ * the contents of the input file, how it was read, the file being made,
+ * whether the vehicle is a boat and the version of this program. a job
+ * finding its file there links it into the output directory instead of
+ * compressing or searching anything. the file name is not part of the key,
+ * so vehicles with the same terrain share entries.
+ *
+ * files are hard linked both ways where the system allows, copied where it
+ * doesn't. openFile removes a file before writing it, so writing never
+ * goes through a link into the cache.
+ *
+ * images are not cached, nor are windows (-W) - they depend on the files
+ * already in the output directory.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "registry.h"
+#include "cache.h"
+#include "islands.h"
+#include "manifest.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern char *inputType[];
+extern THREAD_LOCAL userData data;
+
+static THREAD_LOCAL char               *hashedPath = NULL;
+static THREAD_LOCAL unsigned long long  inputHash  = 0;
+
+/************************************  functions             ************************/
+
+static unsigned long long
+hashBytes ( unsigned long long hash, unsigned char *p, int size )
+{
+  while ( size-- > 0 )
+    hash = ( hash ^ *p++ ) * CACHE_HASH_PRIME;
+  return hash;
+} /* end hashBytes */
+
+static unsigned long long
+hashFile ( char *path )
+{
+  unsigned char buffer[ 4096 ];
+  FILE *fp;
+  int   size;
+
+  /* every job of a run reads the same file - hash it once */
+  if ( hashedPath && !strcmp ( hashedPath, path )) return inputHash;
+
+  if ( !( fp = fopen ( path, READ_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening file to hash: %s\n", path );
+  inputHash = CACHE_HASH_SEED;
+  while (( size = fread ( buffer, 1, sizeof ( buffer ), fp )) > 0 )
+    inputHash = hashBytes ( inputHash, buffer, size );
+  fclose ( fp );
+
+  if ( hashedPath ) free ( hashedPath );
+  hashedPath = dupString ( path );
+  return inputHash;
+} /* end hashFile */
+
+static char *
+cacheName ( jobList *job )
+{
+  char buffer[ BUF_SIZE ];
+  unsigned long long hash;
+  int key[8];
+
+  key[0] = MAJOR_VERSION;
+  key[1] = MINOR_VERSION;
+  key[2] = data.readflag;
+  key[3] = job->in.type  & ~( FTF_READ | FTF_WRITE );
+  key[4] = job->in.level;
+  key[5] = job->out.type & ~( FTF_READ | FTF_WRITE );
+  key[6] = job->out.level;
+  key[7] = ISSEA ( job->out.vehicle );
+
+  hash = hashFile ( job->in.path );
+  hash = hashBytes ( hash, (unsigned char *) key, sizeof ( key ));
+  hash = hashBytes ( hash, (unsigned char *) SUB_VERSION, strlen ( SUB_VERSION ));
+
+  /* smallOnes and info with islands dropped are other files */
+  if ( data.minIsland || ( data.islands & ISL_SPAWNS )) {
+    key[0] = data.minIsland;
+    key[1] = data.islands & ISL_SPAWNS;
+    hash = hashBytes ( hash, (unsigned char *) key, sizeof ( int ) * 2 );
+    hash = hashBytes ( hash, (unsigned char *) data.spawn, sizeof ( int ) * 2 * data.spawns );
+  }
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_CACHE, data.cachepath, PATHSEP, hash );
+  return dupString ( buffer );
+} /* end cacheName */
+
+static int
+copyFile ( char *src, char *dst )
+{
+  char   buffer[ 4096 ];
+  FILE  *in;
+  FILE  *out;
+  size_t size;
+  int    ret = TRUE;
+
+  if ( !( in = fopen ( src, READ_MODE ))) return FALSE;
+  if ( !( out = fopen ( dst, WRITE_MODE ))) {
+    fclose ( in );
+    return FALSE;
+  }
+  while (( size = fread ( buffer, 1, sizeof ( buffer ), in )) > 0 )
+    if ( fwrite ( buffer, 1, size, out ) != size ) ret = FALSE;
+  fclose ( in );
+  if ( fclose ( out )) ret = FALSE;
+  if ( !ret ) remove ( dst );
+  return ret;
+} /* end copyFile */
+
+static int
+linkFile ( char *src, char *dst )
+{
+  remove ( dst );
+#ifdef IS_UNIX
+  if ( !link ( src, dst )) return TRUE;
+#endif
+  return copyFile ( src, dst );
+} /* end linkFile */
+
+int
+isCacheJob ( jobList *job )
+{
+  return ( data.cachepath && job->in.path && job->out.path &&
+	   ( job->out.type & FTF_WRITE ) && IMGTYPES(job->out.type) &&
+	   !( job->out.type & FTF_IMG ) &&
+	   !( data.writeflag & FTF_REGION ) &&
+	   /* the island files are written as the smallOnes are made */
+	   !( data.islands & ( ISL_REPORT | ISL_GRAPH )));
+} /* end isCacheJob */
+
+int
+cacheFetch ( jobList *job )
+{
+  char *entry;
+  char *name;
+  int   ret = FALSE;
+
+  if ( !isCacheJob ( job )) return FALSE;
+
+  entry = cacheName ( job );
+  if ( isFile ( entry )) {
+    name = fullName ( job->out.path, job->out.type, job->out.vehicle, job->out.level );
+    debug ( DBG_NOTICE, "Cached %s %s level %d file: %s\n",
+	    baseName[job->out.vehicle], inputType[findLn2 ( IMGTYPES(job->out.type))],
+	    job->out.level, name );
+    if (( ret = linkFile ( entry, name ))) {
+      /* the map wasn't made - leave word so later jobs can make it */
+      ghostMap ( &(job->out) );
+      if ( data.manifest ) manifestAdd ( name );
+    } else
+      debug ( DBG_WARN, "Error copying cached file %s to %s\n", entry, name );
+    free ( name );
+  }
+  free ( entry );
+  return ret;
+} /* end cacheFetch */
+
+void
+cacheStore ( jobList *job )
+{
+  char  buffer[ BUF_SIZE ];
+  char *entry;
+  char *name;
+  int   linked;
+
+  if ( !isCacheJob ( job )) return;
+
+  entry = cacheName ( job );
+  name  = fullName ( job->out.path, job->out.type, job->out.vehicle, job->out.level );
+  if ( isFile ( name ) && !isFile ( entry )) {
+    debug ( DBG_INFO, "Caching %s as %s\n", name, entry );
+    linked = FALSE;
+#ifdef IS_UNIX
+    linked = !link ( name, entry );
+#endif
+    /* copies land under a temporary name so a half written entry is never
+     * found */
+    snprintf ( buffer, BUF_SIZE, "%s.tmp", entry );
+    if ( !linked && ( !copyFile ( name, buffer ) || rename ( buffer, entry )))
+      debug ( DBG_WARN, "Error caching %s\n", name );
+  }
+  free ( name );
+  free ( entry );
+} /* end cacheStore */
+
+void
+cacheForget ( void )
+{
+  /* the input file changed - hash it again */
+  if ( hashedPath ) free ( hashedPath );
+  hashedPath = NULL;
+} /* end cacheForget */
@@ -0,0 +1,44 @@
+/* cache.h - cache of map, info and smallOnes files header file
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+
+/************************************  macros                 ***********************/
+
+/* 64 bit FNV-1a */
+#define CACHE_HASH_SEED  0xcbf29ce484222325ULL
+#define CACHE_HASH_PRIME 0x100000001b3ULL
+
+#define FILENAME_CACHE "%s%c%016llx.raw"
+
+/************************************  prototypes             ***********************/
+
+int             isCacheJob      ( jobList *job );
+int             cacheFetch      ( jobList *job );
+void            cacheStore      ( jobList *job );
+void            cacheForget     ( void );
+
+#endif /* __CACHE_H__ */
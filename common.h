@@ -40,6 +40,7 @@
 
 #ifdef IS_UNIX
   #include <unistd.h>
+  #include <sys/stat.h>
 #else
   #include <direct.h>
 #endif
@@ -71,6 +72,7 @@
 
 #define VT_TYPES 5
 #define MAX_LEVEL 5
+#define MAX_SPAWNS 64
 #define MAP_TYPES 3
 
 #ifdef IS_UNIX
@@ -78,11 +80,15 @@
   #define PATHSEP '/'
   #define LINEFEED "\n"
   #define COMMENTTAG "#"
+  /* each thread has its own - a library call, or a render worker,
+   * sees only its own run */
+  #define THREAD_LOCAL __thread
 #else
   #define COMSEP '/'
   #define PATHSEP '\\'
   #define LINEFEED "\r\n"
   #define COMMENTTAG ";"
+  #define THREAD_LOCAL
 #endif
 
 #define READ_MODE  "rb"
@@ -92,6 +98,8 @@
 #define BI_RLE8 1
 #define BI_RLE4 2
 #define BI_BITFIELDS 3
+#define BI_JPEG 4
+#define BI_PNG 5
 
 #define DIB_SIGNATURE 0x4D42 /* "BM" */
 #define DIB_PALVERSION 0x0300
@@ -112,11 +120,24 @@
 #define FILENAME_SO_RAW     "%s%c%s.raw"
 #define FILENAME_INFO_RAW   "%s%c%sInfo.raw"
 #define FILENAME_IMG_MAP    "%s%c%s%dLevel%dMap%s"
+#define FILENAME_IMG_NATIVE "%s%c%s%dLevel%dMapNative%s"
+#define FILENAME_IMG_THUMB  "%s%c%s%dLevel%dMapThumb%s"
 #define FILENAME_IMG_SO     "%s%c%s%s"
 #define FILENAME_IMG_INFO   "%s%c%sInfo%s"
 #define FILENAME_TXT        "%s%c%s.txt"
 #define FILENAME_GRID       "%s%cGrid.raw"
 #define FILENAME_NUM_GRID   "%s%cNumberedGrid.raw"   
+#define FILENAME_ISLANDS    "%s%c%sIslands.txt"
+#define FILENAME_GRAPH      "%s%c%sGraph.csr"
+#define FILENAME_PATHS      "%s%c%sPaths.txt"
+#define FILENAME_REACH      "%s%c%s%dLevel%dReach%s"
+#define FILENAME_VERIFY     "%s%c%sVerify.txt"
+#define FILENAME_LEVELS     "%s%c%sLevels.txt"
+#define FILENAME_CHECK      "%s%c%s%dLevel%dCheck%s"
+#define FILENAME_DIFF       "%s%cDiff.txt"
+#define FILENAME_DIFF_IMG   "%s%c%s%dLevel%dDiff%s"
+#define FILENAME_STATS      "%s%cStats%s"
+#define FILENAME_MANIFEST   "%s%cManifest.txt"
 
 #define FILENAME_MAP        "%s%c%s%dLevel%dMap%s"
 #define FILENAME_SO         "%s%c%s%s"
@@ -124,7 +145,10 @@
 #define FILE_8BIT_RAW_EXT   "8Bit.raw"
 #define FILE_RAW_EXT        ".raw"
 #define FILE_BMP_EXT        ".bmp"
+#define FILE_PNG_EXT        ".png"
 #define FILE_TXT_EXT        ".txt"
+#define FILE_JSON_EXT       ".json"
+#define FILE_CSV_EXT        ".csv"
 
 /* some useful macros */
 #define ABS(a) (( 1 + (a) >= 1 ) ? (a) : 0 - (a) )
@@ -170,6 +194,7 @@ typedef enum _errFlag
 
 typedef enum _debugFlag
   {
+    DBG_QUIET = -1,         /* not even errors - the library */
     DBG_ERR = 0,
     DBG_WARN,
     DBG_NOTICE,
@@ -209,6 +234,12 @@ typedef enum _fileTypeFlag
     FTF_GRAY    = 1 << 12,  /* 4096                                   */
     FTF_PREP    = 1 << 13,
     FTF_BATCH   = 1 << 14,
+    FTF_NATIVE  = 1 << 15,  /* 32768 - images at the level's own res   */
+    FTF_PYRAMID = 1 << 16,  /* 65536 - images as a zoom pyramid of tiles */
+    FTF_RLE     = 1 << 17,  /* 131072 - run length encoded bitmaps     */
+    FTF_PNG     = 1 << 18,  /* 262144 - png instead of bmp images      */
+    FTF_REGION  = 1 << 19,  /* 524288 - only a window of tiles         */
+    FTF_THUMB   = 1 << 20,  /* 1048576 - density thumbnail of the map  */
   } fileTypeFlag;	      
 
 #define FTF_ALL_MAPS ( FTF_MAP | FTF_SO | FTF_INFO )
@@ -374,11 +405,42 @@ typedef struct _tileData
 
 } tileData;
 
+/* a window of tiles, corners included */
+typedef struct _tileRegion
+{
+  int  x0;
+  int  y0;
+  int  x1;
+  int  y1;
+} tileRegion;
+
 typedef struct _tileImageData
 {
   unsigned char * pt[4];
 } tileImageData;
 
+typedef struct _lineSegment
+{
+  int  x1;
+  int  y1;
+  int  x2;
+  int  y2;
+  int  color;
+} lineSegment;
+
+/* map space line segments, indexed by the rows of tiles they cross */
+typedef struct _segmentBins
+{
+  int                 segments;
+  int                 rows;
+  int                *start;
+  int                *index;
+  struct _lineSegment *seg;
+} segmentBins;
+
+/* fills count pixels starting at pixel offset in an image buffer */
+typedef void (*spanFill) ( unsigned char *buf, int offset, int count, int value );
+
 typedef struct _pathfindingmap
 {
   FILE                    *fp;
@@ -397,6 +459,23 @@ typedef struct _pathfindingmap
   struct _tileImageData   *img;
   unsigned char           *bmp;
   unsigned char           *buf;
+  spanFill                 fill;
+  struct _segmentBins     *lines;
+  struct _pyramidData     *pyramid;
+  unsigned char           *rle;
+  int                      rleSize;
+  struct _pngStream       *png;
+  struct _tileRegion       win;
+  unsigned char           *dirty;
+
+  /* registry bookkeeping */
+  char                    *source;
+  unsigned int             hash;
+  int                      serial;
+  long long                bytes;
+  struct _pathfindingmap  *hashNext;
+  struct _pathfindingmap  *lruPrev;
+  struct _pathfindingmap  *lruNext;
 
   struct _pathfindingmap  *prev;
   struct _pathfindingmap  *next;
@@ -406,6 +485,7 @@ typedef struct _userData
 {
   char                   *inpath;
   char                   *outpath;
+  char                   *cachepath;
   
   jobList                *jobs;
 
@@ -414,6 +494,31 @@ typedef struct _userData
   struct _pathfindingmap *maps;
 
   debugFlag               debug;
+  int                     threads;
+  struct _tileRegion      region;
+  int                     thumbSize;
+  int                     budget;
+  int                     update;
+  int                     watch;
+  int                     port;
+  FILE                 *(*opener) ( char *path, const char *mode );
+  char                   *shmName;
+  int                     islands;
+  int                     minIsland;
+  int                     spawns;
+  int                     spawn[ MAX_SPAWNS ][2];
+  char                   *queryPath;
+  int                     bench;
+  int                     reach;
+  int                     reachLevel;
+  char                   *verifyPath;
+  char                   *checkPath;
+  int                     checkImage;
+  char                   *diffPath;
+  int                     problems;
+  int                     stats;
+  int                     manifest;
+  char                   *manifestPath;
 } userData;
 
 
@@ -26,11 +26,56 @@
 
 #include "common.h"
 #include "commonutils.h"
+#include "image.h"
+#include "watch.h"
+#include "server.h"
+#include "library.h"
 
 /************************************  global variables      *********************/
 
-extern userData data;
-extern char *baseName[];
+/* shared by the program and the library - each thread has its own, a
+ * library call swaps its context's in */
+THREAD_LOCAL userData data = {
+  .inpath    = NULL,
+  .outpath   = NULL,
+  .cachepath = NULL,
+  .jobs      = NULL,
+  .readflag  = RF_NONE,
+  .writeflag = FTF_NONE,
+  .maps      = NULL,
+  .debug     = DBG_WARN,
+  .threads   = 0
+  /* the rest start at 0 */
+};
+
+THREAD_LOCAL int freeInpath  = FALSE;
+
+unsigned char *baseName[] = {
+  "Tank",
+  "Infantry",
+  "Boat",
+  "LandingCraft",
+  "Car",
+  "Heli",
+  "Amphibius"
+};
+
+char *inputType[] = {
+  "Pathfinding",
+  "Info",
+  "SmallOnes",
+  "Text"
+};
+
+char *ext[] = {
+  FILE_BMP_EXT,
+  FILE_8BIT_RAW_EXT,
+  FILE_RAW_EXT,
+  FILE_TXT_EXT
+};
+
+/* the last error shutdown was given */
+static THREAD_LOCAL char errorText[ BUF_SIZE ];
 
 /************************************  functions             *********************/
 
@@ -93,7 +138,14 @@ openFile ( pathfindingmap *map, const char *mode )
   debug ( DBG_INFO, "Opening file for %s: %s\n",
 	  ( isRead ? "reading" : "writing" ), filename );
 
-  if ( !( map->fp = fopen (( filename), mode )))
+  /* the old file may be a link into the cache - don't write through it */
+  if ( !isRead && !data.opener ) remove ( filename );
+
+  /* the library keeps its files in memory */
+  if ( data.opener ) map->fp = data.opener ( filename, mode );
+  else map->fp = fopen (( filename), mode );
+
+  if ( !map->fp )
     debug ( DBG_ERR, "Error opening file for %s: %s\n",
 	    ( isRead ? "reading" : "writing" ), filename );
   else ret = TRUE;
@@ -109,17 +161,33 @@ shutdown ( int err, char *format, ... )
   va_list ap;
   va_start ( ap, format );
 
-  /* check level of shutdown and report */
-  if ( format ) {
-    if (err) debug ( DBG_ERR, format, ap );
-    else debug ( DBG_INFO, format, ap );
-  }
-
+  /* check level of shutdown and report - the arguments are already in ap,
+   * so print them here rather than through debug */
+  if ( format ) vsnprintf ( errorText, sizeof ( errorText ), format, ap );
+  else errorText[0] = '\0';
   va_end(ap);
+
+  /* on a render thread, it is handed to the thread that started them */
+  renderRecover ( err );
+  if ((( err ) ? DBG_ERR : DBG_INFO ) <= data.debug )
+    printf ( "%s", errorText );
+
+  /* while watching, an error only ends the build it happened in */
+  watchRecover ( err );
+  /* and while serving, only the request it happened in */
+  serverRecover ( err );
+  /* and called from the library, it is handed back to the caller */
+  libraryRecover ( err );
   freeAll ();
   exit (err);
 } /* end shutdown */
 
+char *
+errorMessage ( void )
+{
+  return errorText;
+} /* end errorMessage */
+
 void
 debug ( debugFlag level, char *format, ... )
 {
@@ -192,7 +260,8 @@ isFile ( char *str )
 {
   FILE *fp;
 
-  if ( !( fp = fopen ( str, READ_MODE ))) return FALSE;
+  fp = data.opener ? data.opener ( str, READ_MODE ) : fopen ( str, READ_MODE );
+  if ( !fp ) return FALSE;
   else fclose ( fp );
 
   return TRUE;
@@ -211,6 +280,19 @@ isDir ( char *str )
   
 }
 
+int
+makeDir ( char *str )
+{
+  /* an existing directory is as good as a new one */
+  if ( isDir ( str )) return TRUE;
+
+#ifdef IS_UNIX
+  return ( mkdir ( str, 0755 ) == 0 );
+#else
+  return ( _mkdir ( str ) == 0 );
+#endif
+}
+
 
 char *
 fullName ( char *path, int type, int vehicle, int level )
@@ -221,7 +303,8 @@ fullName ( char *path, int type, int vehicle, int level )
   memset ( buffer, 0, sizeof (buffer));
 
   if ( type & FTF_IMG ) {
-    ext = ( type & FTF_RAW ) ? FILE_8BIT_RAW_EXT : FILE_BMP_EXT;
+    ext = ( type & FTF_RAW ) ? FILE_8BIT_RAW_EXT :
+      ( type & FTF_PNG ) ? FILE_PNG_EXT : FILE_BMP_EXT;
     
     switch ( type  & ( FTF_IMG - 1 ))
       {
@@ -234,7 +317,9 @@ fullName ( char *path, int type, int vehicle, int level )
 	}
 	break;
       case FTF_MAP:
-	sprintf ( buffer, FILENAME_IMG_MAP,
+	sprintf ( buffer,
+		  ( type & FTF_THUMB ) ? FILENAME_IMG_THUMB :
+		  (( type & FTF_NATIVE ) && level ) ? FILENAME_IMG_NATIVE : FILENAME_IMG_MAP,
 		  path, PATHSEP, baseName[vehicle], vehicle, level, ext );
 	break;
       case FTF_INFO:
@@ -376,7 +461,8 @@ addVehicle ( char *filename, int vtype, int level )
 	  else job.out.level = 0;
 	  job.out.path = data.outpath;
 	  addJob ( &(data.jobs), &job );
-	  if ( !IMGFLAG( data.writeflag ) && (job.out.type & FTF_MAP ))	
+	  /* a window patched into level 0 still makes the other levels */
+	  if ( !IMGFLAG( data.writeflag & ~FTF_REGION ) && (job.out.type & FTF_MAP ))	
 	    for ( i = 1; i <= maxLevel; i++ ) {
 	      job.out.level = i;
 	    addJob ( &(data.jobs), &job );
@@ -427,7 +513,7 @@ isPathmapFile ( char *path, int *vtype, int *level )
   *vtype = -1;
 
   for ( i = VT_TANK; i <= VT_AMPHIBIUS; i++ ) {
-    for ( j = 0; j <= strlen ( baseName[i] ) + 1; j++ ) 
+    for ( j = 0; j <= strlen ( baseName[i] ); j++ ) 
       scanVt[j] = (char) toupper ( baseName[i][j] );
     if ( strncmp ( buffer, scanVt, strlen ( scanVt )) == 0 ) {
       *vtype = i;
@@ -442,8 +528,9 @@ isPathmapFile ( char *path, int *vtype, int *level )
   if ( sscanf ( p, "%*01dLEVEL%01dMAP.%s", &scanLvl, scanExt) == 2 ) {
     if ( !strncmp ( scanExt, "RAW", 3 )) {
       data.readflag = RF_MAP;
-      if ( !IMGFLAG( data.writeflag )) data.writeflag |= FTF_IMG;
-    } else if ( !strncmp ( scanExt, "BMP", 3 )) {
+      if ( !IMGFLAG( data.writeflag & ~FTF_REGION )) data.writeflag |= FTF_IMG;
+    } else if ( !strncmp ( scanExt, "BMP", 3 ) || !strncmp ( scanExt, "PNG", 3 )) {
+      /* png or bmp is sorted out when the image is loaded */
       data.readflag = RF_BMP;
     }
     if ( !IMGTYPES( data.writeflag )) data.writeflag |= FTF_ALL_MAPS;
@@ -454,13 +541,14 @@ isPathmapFile ( char *path, int *vtype, int *level )
     if ( sscanf ( p, "%*01dLEVEL%01dMAP8BIT.%s", &scanLvl, scanExt) == 2 ) {
       if ( strncmp ( scanExt, "RAW", 3 )) return FALSE;
       data.readflag = RF_RAW;
-      if ( !IMGTYPES( data.writeflag )) data.writeflag = FTF_ALL_MAPS;
+      if ( !IMGTYPES( data.writeflag ))
+	data.writeflag = FTF_ALL_MAPS | ( data.writeflag & FTF_REGION );
       *level = scanLvl;
       return TRUE;
       
     } else if ( !strncmp ( p, "INFO.RAW", 8 )) {
       data.readflag = RF_INFO;
-      data.writeflag = FTF_INFO_IMG;
+      data.writeflag = FTF_INFO_IMG | ( data.writeflag & ( FTF_RLE | FTF_PYRAMID | FTF_PNG | FTF_REGION ));
       *level = (( *vtype == 2 ) || ( *vtype == 3 )) ? 3 : 1;
       return TRUE;
       
@@ -36,12 +36,14 @@ char          *fullPath          ( pathfindingmap *map );
 int            openFile          ( pathfindingmap *map, const char *mode );
 void           shutdown          ( int err, char *format, ... );
 void           debug             ( debugFlag level, char *format, ... );
+char          *errorMessage      ( void );
 int            fileSize          ( pathfindingmap *map );
 char          *fileName          ( char *path );
 char          *strToUpper        ( char *str );
 int            strCaseCmp        ( char *dst, char *src, int n );
 int            isFile            ( char *str );
 int            isDir             ( char *str );
+int            makeDir           ( char *str );
 char          *fullName          ( char *path, int type, int vehicle, int level );
 jobList       *addJob            ( jobList **list, jobList *curJob );
 void           addJobs           ( void );
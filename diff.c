@@ -0,0 +1,347 @@
+/* diff.c - what changed between two sets of pathmap files
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -d old, the pathmap files in the directory old are compared with
+ * those in the input directory - every level of every vehicle's map and
+ * the smallOnes. tiles with the same uniform flag are passed over, mixed
+ * tiles are compared with memcmp, and only those that differ are XORed
+ * and counted a word at a time.
+ *
+ * Diff.txt lists the tiles that changed with how many pixels became NoGo
+ * or DoGo, and the smallOnes points and links added, removed or moved.
+ * each level that changed is drawn in VehicleNLevelNDiff.bmp.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "memory.h"
+#include "image.h"
+#include "textfile.h"
+#include "diff.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern THREAD_LOCAL userData data;
+
+/************************************  prototypes             ***********************/
+
+static int                 diffLevel    ( FILE *fp, vehicleType vehicle, int level );
+static void                diffTile     ( tileData *was, tileData *now, int bytes, diffCount *count );
+static unsigned long long  tileWord     ( tileData *tile, int offset, int bytes );
+static int                 diffPoints   ( FILE *fp, vehicleType vehicle );
+static void                diffLinks    ( FILE *fp, pathfindingmap *soMap, int tile, int next,
+					  int links, int was, diffSmallOnes *count );
+static int                 mapPixel     ( pathfindingmap *map, int x, int y );
+static void                writeDiff    ( pathfindingmap *was, pathfindingmap *now );
+
+/************************************  functions             ************************/
+
+void
+diffSets ( void )
+{
+  char buffer[ BUF_SIZE ];
+  FILE *fp;
+  vehicleType vehicle;
+  int level;
+  int changed = 0;
+
+  if ( !data.inpath || !data.outpath )
+    shutdown ( EF_DATA_MISSING, "Insufficient arguments\n" );
+  if ( !isDir ( data.inpath ) || !isDir ( data.outpath ))
+    shutdown ( EF_DATA_MISSING, "%cd compares the pathmap files in two directories\n", COMSEP );
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_DIFF, data.outpath, PATHSEP );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+  fprintf ( fp, "# %s compared with %s%s", data.inpath, data.diffPath, LINEFEED );
+
+  for ( vehicle = VT_TANK; vehicle <= VT_AMPHIBIUS; vehicle++ ) {
+    for ( level = 0; level <= MAX_LEVEL; level++ )
+      changed += diffLevel ( fp, vehicle, level );
+    changed += diffPoints ( fp, vehicle );
+  }
+
+  fprintf ( fp, "# %d files changed%s", changed, LINEFEED );
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing %s\n", buffer );
+
+  debug ( DBG_NOTICE, "%d files changed, see %s\n", changed, buffer );
+
+  /* nothing else is done */
+  shutdown ( EF_NONE, "" );
+} /* end diffSets */
+
+/* returns TRUE if the level changed */
+static int
+diffLevel ( FILE *fp, vehicleType vehicle, int level )
+{
+  pathfindingmap *was;
+  pathfindingmap *now;
+  diffCount count;
+  char name[ BUF_SIZE ];
+  char path[ BUF_SIZE ];
+  int toNoGo, toDoGo;
+  int tile;
+
+  snprintf ( path, BUF_SIZE, FILENAME_MAP_RAW,
+	     data.diffPath, PATHSEP, baseName[ vehicle ], vehicle, level );
+  was = readMapFile ( path, FTF_MAP, vehicle, level );
+  snprintf ( path, BUF_SIZE, FILENAME_MAP_RAW,
+	     data.inpath, PATHSEP, baseName[ vehicle ], vehicle, level );
+  now = readMapFile ( path, FTF_MAP, vehicle, level );
+  if ( !was && !now ) return FALSE;
+
+  snprintf ( name, BUF_SIZE, "%s%dLevel%d", baseName[ vehicle ], vehicle, level );
+  if ( !was || !now ) {
+    fprintf ( fp, "%s: %s%s", name, was ? "removed" : "added", LINEFEED );
+    if ( was ) freeMap ( &was );
+    if ( now ) freeMap ( &now );
+    return TRUE;
+  }
+
+  if (( was->tilesPerRow != now->tilesPerRow ) || ( was->rowsPerTile != now->rowsPerTile ) ||
+      ( was->bytesPerRow != now->bytesPerRow )) {
+    fprintf ( fp, "%s: %d tiles of %d rows across, were %d of %d%s", name,
+	      now->tilesPerRow, now->rowsPerTile, was->tilesPerRow, was->rowsPerTile, LINEFEED );
+    freeMap ( &was );
+    freeMap ( &now );
+    return TRUE;
+  }
+
+  memset ( &count, 0, sizeof ( diffCount ));
+  count.tiles = now->tiles;
+  for ( tile = 0; tile < now->tiles; tile++ ) {
+    toNoGo = count.toNoGo;
+    toDoGo = count.toDoGo;
+    diffTile ( &(was->tile[ tile ]), &(now->tile[ tile ]), now->bytesPerTile, &count );
+    if (( toNoGo == count.toNoGo ) && ( toDoGo == count.toDoGo )) continue;
+
+    count.changed++;
+    fprintf ( fp, "%s tile: %02dx%02d %d pixels now NoGo, %d now DoGo%s", name,
+	      tile % now->tilesPerRow, tile / now->tilesPerRow,
+	      count.toNoGo - toNoGo, count.toDoGo - toDoGo, LINEFEED );
+  }
+  fprintf ( fp, "# %s: %d tiles, %d changed, %d pixels now NoGo, %d now DoGo%s", name,
+	    count.tiles, count.changed, count.toNoGo, count.toDoGo, LINEFEED );
+
+  if ( count.changed ) writeDiff ( was, now );
+  freeMap ( &was );
+  freeMap ( &now );
+  return count.changed ? TRUE : FALSE;
+} /* end diffLevel */
+
+static void
+diffTile ( tileData *was, tileData *now, int bytes, diffCount *count )
+{
+  unsigned long long w, n;
+  int i;
+
+  /* the same uniform tile, or the same bits */
+  if (( was->flag == now->flag ) &&
+      (( was->flag != TDT_MIXED ) || !memcmp ( was->bits, now->bits, bytes )))
+    return;
+
+  for ( i = 0; i < bytes; i += 8 ) {
+    w = tileWord ( was, i, bytes );
+    n = tileWord ( now, i, bytes );
+    count->toNoGo += __builtin_popcountll ( n & ~w );
+    count->toDoGo += __builtin_popcountll ( w & ~n );
+  }
+} /* end diffTile */
+
+/* 8 bytes of a tile from offset, or what's left of it */
+static unsigned long long
+tileWord ( tileData *tile, int offset, int bytes )
+{
+  unsigned long long word = 0;
+  int len;
+
+  len = MIN ( 8, bytes - offset );
+  if ( tile->flag == TDT_MIXED ) memcpy ( &word, tile->bits + offset, len );
+  else if ( tile->flag == TDT_NOGO ) word = ( len == 8 ) ? ~0ULL : ( 1ULL << ( len * 8 )) - 1;
+  return word;
+} /* end tileWord */
+
+/* returns TRUE if the smallOnes changed */
+static int
+diffPoints ( FILE *fp, vehicleType vehicle )
+{
+  pathfindingmap *was;
+  pathfindingmap *now;
+  smallOnesData *w, *n;
+  diffSmallOnes count;
+  char path[ BUF_SIZE ];
+  int tilesPerRow;
+  int tile;
+  int i;
+  int changed;
+
+  snprintf ( path, BUF_SIZE, FILENAME_SO_RAW, data.diffPath, PATHSEP, baseName[ vehicle ] );
+  was = readMapFile ( path, FTF_SO, vehicle, 0 );
+  snprintf ( path, BUF_SIZE, FILENAME_SO_RAW, data.inpath, PATHSEP, baseName[ vehicle ] );
+  now = readMapFile ( path, FTF_SO, vehicle, 0 );
+  if ( !was && !now ) return FALSE;
+
+  if ( !was || !now || ( was->tilesPerRow != now->tilesPerRow )) {
+    if ( !was || !now )
+      fprintf ( fp, "%s smallOnes: %s%s", baseName[ vehicle ], was ? "removed" : "added", LINEFEED );
+    else
+      fprintf ( fp, "%s smallOnes: %d tiles across, were %d%s", baseName[ vehicle ],
+		now->tilesPerRow, was->tilesPerRow, LINEFEED );
+    if ( was ) freeMap ( &was );
+    if ( now ) freeMap ( &now );
+    return TRUE;
+  }
+
+  memset ( &count, 0, sizeof ( diffSmallOnes ));
+  tilesPerRow = now->tilesPerRow;
+  for ( tile = 0; tile < now->tiles; tile++ ) {
+    w = &(was->so[ tile ]);
+    n = &(now->so[ tile ]);
+    if ( !memcmp ( w, n, sizeof ( smallOnesData ))) continue;
+
+    for ( i = 0; i < 4; i++ ) {
+      if ( !(( w->active | n->active ) & ( ACT_OFF << i ))) continue;
+      if (( w->active & n->active & ( ACT_OFF << i )) &&
+	  ( w->pt[i][0] == n->pt[i][0] ) && ( w->pt[i][1] == n->pt[i][1] ))
+	continue;
+
+      fprintf ( fp, "%s tile: %02dx%02d:%d ", baseName[ vehicle ],
+		tile % tilesPerRow, tile / tilesPerRow, i );
+      if ( !( n->active & ( ACT_OFF << i ))) {
+	fprintf ( fp, "pt: %02dx%02d removed%s", w->pt[i][0], w->pt[i][1], LINEFEED );
+	count.removed++;
+      } else if ( !( w->active & ( ACT_OFF << i ))) {
+	fprintf ( fp, "pt: %02dx%02d added%s", n->pt[i][0], n->pt[i][1], LINEFEED );
+	count.added++;
+      } else {
+	fprintf ( fp, "pt: %02dx%02d moved to %02dx%02d%s",
+		  w->pt[i][0], w->pt[i][1], n->pt[i][0], n->pt[i][1], LINEFEED );
+	count.moved++;
+      }
+    }
+
+    diffLinks ( fp, now, tile, tile + tilesPerRow, n->hasLower, w->hasLower, &count );
+    diffLinks ( fp, now, tile, tile + 1, n->hasRight, w->hasRight, &count );
+  }
+
+  fprintf ( fp, "# %s smallOnes: %d points added, %d removed, %d moved, "
+	    "%d links added, %d removed%s", baseName[ vehicle ], count.added, count.removed,
+	    count.moved, count.linked, count.unlinked, LINEFEED );
+
+  changed = count.added || count.removed || count.moved || count.linked || count.unlinked;
+  freeMap ( &was );
+  freeMap ( &now );
+  return changed;
+} /* end diffPoints */
+
+/* the links from tile to next that are new, or gone */
+static void
+diffLinks ( FILE *fp, pathfindingmap *soMap, int tile, int next, int links, int was,
+	    diffSmallOnes *count )
+{
+  int tilesPerRow;
+  int bit;
+
+  tilesPerRow = soMap->tilesPerRow;
+  for ( bit = 0; bit < 16; bit++ ) {
+    if ( !(( links ^ was ) & ( 1 << bit ))) continue;
+    fprintf ( fp, "%s tile: %02dx%02d:%d to %02dx%02d:%d link %s%s", baseName[ soMap->io.vehicle ],
+	      tile % tilesPerRow, tile / tilesPerRow, bit / 4,
+	      next % tilesPerRow, next / tilesPerRow, bit % 4,
+	      ( links & ( 1 << bit )) ? "added" : "removed", LINEFEED );
+    if ( links & ( 1 << bit )) count->linked++;
+    else count->unlinked++;
+  }
+} /* end diffLinks */
+
+static int
+mapPixel ( pathfindingmap *map, int x, int y )
+{
+  tileData *tile;
+  int dim;
+
+  dim  = map->bytesPerRow * 8;
+  tile = &(map->tile[ ( y / map->rowsPerTile ) * map->tilesPerRow + x / dim ]);
+  if ( tile->flag != TDT_MIXED ) return ( tile->flag == TDT_NOGO );
+  return ( tile->bits[ ( y % map->rowsPerTile ) * map->bytesPerRow + ( x % dim ) / 8 ] >>
+	   ( x % 8 )) & 1;
+} /* end mapPixel */
+
+/* a 4 bit bitmap of the new level, the pixels that changed in their own
+ * colors */
+static void
+writeDiff ( pathfindingmap *was, pathfindingmap *now )
+{
+  pathfindingmap image;
+  char buffer[ BUF_SIZE ];
+  unsigned char *line;
+  FILE *fp;
+  int width, height;
+  int x, y;
+  int w, n;
+  int color;
+
+  memset ( &image, 0, sizeof ( pathfindingmap ));
+  image.io.type    = FTF_IMG | FTF_MAP;
+  image.io.vehicle = now->io.vehicle;
+  image.io.level   = now->io.level;
+  image.io.bits    = 4;
+
+  width  = now->tilesPerRow * now->bytesPerRow * 8;
+  height = now->tilesPerCol * now->rowsPerTile;
+  if ( !( line = (unsigned char *) calloc (( width + 1 ) / 2 + 4, 1 )))
+    shutdown ( EF_MALLOC, "Memory allocation error drawing the %s level %d diff\n",
+	       baseName[ now->io.vehicle ], now->io.level );
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_DIFF_IMG, data.outpath, PATHSEP,
+	     baseName[ now->io.vehicle ], now->io.vehicle, now->io.level, FILE_BMP_EXT );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+  writeBmpHeaderDim ( &image, fp, width, height );
+
+  for ( y = 0; y < height; y++ ) {
+    for ( x = 0; x < width; x++ ) {
+      w = mapPixel ( was, x, y );
+      n = mapPixel ( now, x, y );
+      if ( w == n ) color = n ? DIFF_NOGO : DIFF_DOGO;
+      else color = n ? DIFF_TO_NOGO : DIFF_TO_DOGO;
+      if ( x % 2 ) line[ x / 2 ] |= color;
+      else line[ x / 2 ] = color << 4;
+    }
+    /* bitmap rows are padded out to 4 bytes */
+    if ( !fwrite ( line, (( width * 4 + 31 ) / 32 ) * 4, 1, fp ))
+      shutdown ( EF_FILE_WRITE, "Error writing the %s level %d diff\n",
+		 baseName[ now->io.vehicle ], now->io.level );
+  }
+
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing the %s level %d diff\n",
+	       baseName[ now->io.vehicle ], now->io.level );
+  free ( line );
+} /* end writeDiff */
@@ -0,0 +1,62 @@
+/* diff.h - what changed between two sets of pathmap files
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __DIFF_H__
+#define __DIFF_H__
+
+
+/************************************  macros                 ***********************/
+
+/* colors of the diff images, from the default palette */
+#define DIFF_DOGO       0
+#define DIFF_NOGO       5     /* unchanged NoGo, dimmed */
+#define DIFF_TO_NOGO    12
+#define DIFF_TO_DOGO    10
+
+/************************************  structures and enums  ************************/
+
+/* the changes to one map file */
+typedef struct _diffCount
+{
+  int  tiles;
+  int  changed;     /* tiles */
+  int  toNoGo;      /* pixels DoGo before, NoGo now */
+  int  toDoGo;      /* ... and the other way */
+} diffCount;
+
+/* ... and to one smallOnes file */
+typedef struct _diffSmallOnes
+{
+  int  added;
+  int  removed;
+  int  moved;
+  int  linked;      /* links added */
+  int  unlinked;    /* links removed */
+} diffSmallOnes;
+
+/************************************  prototypes             ***********************/
+
+void             diffSets         ( void );
+
+#endif /* __DIFF_H__ */
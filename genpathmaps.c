@@ -29,76 +29,69 @@
 #include "pathfindingmap.h"
 #include "smallones.h"
 #include "textfile.h"
+#include "registry.h"
+#include "cache.h"
+#include "update.h"
+#include "watch.h"
+#include "server.h"
+#include "sharedmaps.h"
+#include "islands.h"
+#include "pathquery.h"
+#include "reach.h"
+#include "verify.h"
+#include "levelcheck.h"
+#include "diff.h"
+#include "stats.h"
+#include "manifest.h"
 
 /************************************  prototypes             ***********************/
 
 void     parseArgs    ( int argc, char *argv[] );
+char    *optionArg    ( int argc, char *argv[], int *i );
 void     usage        ( const char *name );
 void     addJobs      ( void );
+void     runJobs      ( void );
+void     finishInput  ( mapIOData *in );
 int      addInputFile ( jobList **list, char *path, int single );
 jobList *addJob       ( jobList **list, jobList *job );
 
 /************************************  global variables      *********************/
 
-userData data = {
-  NULL,
-  NULL,
-  NULL,
-  RF_NONE,
-  FTF_NONE,
-  NULL,
-  DBG_WARN
-};
-
-int freeInpath  = FALSE;
-
-unsigned char *baseName[] = {
-  "Tank",
-  "Infantry",
-  "Boat",
-  "LandingCraft",
-  "Car",
-  "Heli",
-  "Amphibius"
-};
-
-char *inputType[] = {
-  "Pathfinding",
-  "Info",
-  "SmallOnes",
-  "Text"
-};
-
-char *ext[] = {
-  FILE_BMP_EXT,
-  FILE_8BIT_RAW_EXT,
-  FILE_RAW_EXT,
-  FILE_TXT_EXT
-};
+extern THREAD_LOCAL userData data;
 
 /************************************  entry point           *********************/
 
 int
 main (int argc, char *argv[])
 {
-  jobList *job;
-
   debug ( DBG_NOTICE , "Starting %s\n", fileName ( argv[0] ));
 
   /* parse out command line arguments */
   parseArgs ( argc, argv );
+
+  /* comparing two sets of files doesn't come back */
+  if ( data.diffPath ) diffSets ();
+  if ( data.stats ) writeStats ();
+  if ( data.manifestPath ) checkManifest ();
+
+  /* watching doesn't come back */
+  if ( data.watch ) watchInput ( runJobs );
   addJobs ();
 
   /* any files to process? */
   if ( !data.jobs )
     shutdown ( EF_NO_JOBS, "No input files were found.\n");
 
-  while ( data.jobs ) {
-    job = data.jobs;
-    getMap ( &(data.maps), &(job->in), &(job->out) );
-    data.jobs = data.jobs->next;
-    freeJob ( job );
-  }
+  /* serving doesn't come back either */
+  if ( data.port ) serveMaps ( data.jobs, data.port );
+
+  /* with -U, what's in the output directory now is the last run */
+  loadPrevious ( data.jobs );
+  runJobs ();
+
+  /* with -Y, -x or -r, a build script wants to know */
+  if ( data.problems )
+    shutdown ( EF_BAD_DATA, "%d problems were found in the files checked\n", data.problems );
 
   /* get more coffee */
   shutdown ( EF_NONE, "" );
@@ -109,12 +102,53 @@ main (int argc, char *argv[])
 
 /************************************  functions             *********************/
 
+void
+runJobs ( void )
+{
+  jobList *job;
+
+  while ( data.jobs ) {
+    job = data.jobs;
+    setMapSource ( &(job->in) );
+    if ( !cacheFetch ( job )) {
+      getMap ( &(data.maps), &(job->in), &(job->out) );
+      cacheStore ( job );
+    }
+    /* the last job of an input - its maps are all made */
+    if ( !job->next || strcmp ( job->next->in.path, job->in.path ))
+      finishInput ( &(job->in) );
+    data.jobs = data.jobs->next;
+    freeJob ( job );
+    /* let go of old maps if over budget */
+    trimMaps ();
+  }
+
+  /* with -o, list what was written */
+  if ( data.manifest ) writeManifest ();
+} /* end runJobs */
+
+void
+finishInput ( mapIOData *in )
+{
+  /* with -E, share the maps */
+  if ( data.shmName ) publishMaps ( in );
+  /* with -q, find paths on them */
+  if ( data.queryPath ) runQueries ( in );
+  /* with -r, flood it from the spawn points */
+  if ( data.reach ) floodReach ( in );
+  /* with -Y, check the smallOnes given against it */
+  if ( data.verifyPath ) verifySmallOnes ( in );
+  /* with -x, check the other levels given against it */
+  if ( data.checkPath ) checkLevels ( in );
+} /* end finishInput */
+
 void
 parseArgs ( int argc, char *argv[] )
 {
   char argType;
   int i = 0;
   char *name;
+  char *arg;
 
   if (( name = strrchr ( argv[0], PATHSEP )) == NULL ) name = argv[0];
   else name++;
@@ -161,6 +195,22 @@ parseArgs ( int argc, char *argv[] )
 	  /* output preprocessed images */
 	  data.writeflag |= ( FTF_IMG | FTF_PREP );
 	  break;
+	case 'n':
+	  /* output compressed levels at their own resolution */
+	  data.writeflag |= ( FTF_IMG | FTF_NATIVE );
+	  break;
+	case 'p':
+	  /* output png images */
+	  data.writeflag |= ( FTF_IMG | FTF_PNG );
+	  break;
+	case 'C':
+	  /* run length encode bitmap images */
+	  data.writeflag |= ( FTF_IMG | FTF_RLE );
+	  break;
+	case 'Z':
+	  /* output images as a directory of zoom level tiles */
+	  data.writeflag |= ( FTF_IMG | FTF_PYRAMID );
+	  break;
 	case 'D':
 	  /* write smallOnes plot raw file with lines and grid */
 	  data.writeflag |= FTF_DIAG_IMG;
@@ -181,6 +231,175 @@ parseArgs ( int argc, char *argv[] )
 	  /* use alternate compression method for info file */
 	  data.writeflag |= FTF_ALT;
 	  break;
+	case 'j':
+	  /* number of threads rendering images */
+	  data.threads = atoi ( optionArg ( argc, argv, &i ));
+	  break;
+	case 'c':
+	  /* keep map, info and smallOnes files in a cache directory */
+	  data.cachepath = dupString ( optionArg ( argc, argv, &i ));
+	  if ( !makeDir ( data.cachepath )) {
+	    printf ( "Bad cache directory: %s\n", data.cachepath );
+	    exit (0);
+	  }
+	  break;
+	case 'U':
+	  /* only make again the tiles that changed since the last run -
+	   * all the game files are written so they stay in step */
+	  data.update = TRUE;
+	  data.writeflag |= FTF_ALL_MAPS;
+	  break;
+	case 'w':
+	  /* keep running, building again whenever the input changes */
+	  data.watch = TRUE;
+	  break;
+	case 'H':
+	  /* serve tiles of the maps over http on this port */
+	  data.port = atoi ( optionArg ( argc, argv, &i ));
+	  if ( !INRANGE ( data.port, 1, 65535 )) {
+	    printf ( "Bad port: %s\n", argv[i] );
+	    exit (0);
+	  }
+	  break;
+	case 'E':
+	  /* also put the maps in shared memory, /name.Vehicle */
+	  data.shmName = dupString ( optionArg ( argc, argv, &i ));
+	  if ( !*data.shmName || strchr ( data.shmName, '/' )) {
+	    printf ( "Bad shared memory name: %s\n", argv[i] );
+	    exit (0);
+	  }
+	  break;
+	case 'i':
+	  /* report the smallOnes islands */
+	  data.islands |= ISL_REPORT;
+	  break;
+	case 'k':
+	  /* drop smallOnes islands with fewer points */
+	  if (( data.minIsland = atoi ( optionArg ( argc, argv, &i ))) < 1 ) {
+	    printf ( "Bad island size: %s\n", argv[i] );
+	    exit (0);
+	  }
+	  break;
+	case 'K':
+	  /* drop smallOnes islands no spawn point is in */
+	  data.islands |= ISL_SPAWNS;
+	  break;
+	case 's':
+	  /* a spawn point, in level 0 pixels */
+	  if ( data.spawns == MAX_SPAWNS ) {
+	    printf ( "Only %d spawn points can be given\n", MAX_SPAWNS );
+	    exit (0);
+	  }
+	  if ( sscanf ( optionArg ( argc, argv, &i ), "%d,%d",
+			&(data.spawn[ data.spawns ][0]),
+			&(data.spawn[ data.spawns ][1]) ) != 2 ) {
+	    printf ( "Bad spawn point: %s\n", argv[i] );
+	    exit (0);
+	  }
+	  data.spawns++;
+	  break;
+	case 'g':
+	  /* write the smallOnes graph for other tools */
+	  data.islands |= ISL_GRAPH;
+	  break;
+	case 'q':
+	  /* find the paths between the points in this file */
+	  data.queryPath = dupString ( optionArg ( argc, argv, &i ));
+	  if ( !isFile ( data.queryPath )) {
+	    printf ( "Bad query file: %s\n", data.queryPath );
+	    exit (0);
+	  }
+	  break;
+	case 'b':
+	  /* time the queries against a search of level 0 alone */
+	  data.bench = TRUE;
+	  break;
+	case 'r':
+	  /* flood this level from the first spawn point */
+	  data.reachLevel = atoi ( optionArg ( argc, argv, &i ));
+	  if ( !INRANGE ( data.reachLevel, 0, MAX_LEVEL ) || !isdigit ( argv[i][0] )) {
+	    printf ( "Bad level to flood: %s\n", argv[i] );
+	    exit (0);
+	  }
+	  data.reach = TRUE;
+	  break;
+	case 'Y':
+	  /* check the smallOnes in this file, or the directory they're in */
+	  data.verifyPath = dupString ( optionArg ( argc, argv, &i ));
+	  if ( !isFile ( data.verifyPath ) && !isDir ( data.verifyPath )) {
+	    printf ( "Bad smallOnes file or directory: %s\n", data.verifyPath );
+	    exit (0);
+	  }
+	  break;
+	case 'x':
+	  /* check the levels in this directory against level 0 */
+	  data.checkPath = dupString ( optionArg ( argc, argv, &i ));
+	  if ( !isDir ( data.checkPath )) {
+	    printf ( "Bad directory of levels: %s\n", data.checkPath );
+	    exit (0);
+	  }
+	  break;
+	case 'X':
+	  /* draw where they differ */
+	  data.checkImage = TRUE;
+	  break;
+	case 'd':
+	  /* compare the pathmap files in the input directory with these */
+	  data.diffPath = dupString ( optionArg ( argc, argv, &i ));
+	  if ( !isDir ( data.diffPath )) {
+	    printf ( "Bad directory to compare with: %s\n", data.diffPath );
+	    exit (0);
+	  }
+	  break;
+	case 'a':
+	  /* sum up the pathmap files in the input directory */
+	  arg = optionArg ( argc, argv, &i );
+	  if ( !strcmp ( arg, "json" )) data.stats = STATS_JSON;
+	  else if ( !strcmp ( arg, "csv" )) data.stats = STATS_CSV;
+	  else {
+	    printf ( "Bad stats format, json or csv: %s\n", arg );
+	    exit (0);
+	  }
+	  break;
+	case 'o':
+	  /* list the files written with their checksums */
+	  data.manifest = TRUE;
+	  break;
+	case 'O':
+	  /* check the files in the input directory against a manifest */
+	  data.manifestPath = dupString ( optionArg ( argc, argv, &i ));
+	  if ( !isFile ( data.manifestPath )) {
+	    printf ( "Bad manifest file: %s\n", data.manifestPath );
+	    exit (0);
+	  }
+	  break;
+	case 'm':
+	  /* megabytes of maps to keep between jobs */
+	  if (( data.budget = atoi ( optionArg ( argc, argv, &i ))) < 1 ) {
+	    printf ( "Bad memory budget: %s\n", argv[i] );
+	    exit (0);
+	  }
+	  break;
+	case 't':
+	  /* density thumbnail of the map, n pixels across */
+	  if (( data.thumbSize = atoi ( optionArg ( argc, argv, &i ))) < 1 ) {
+	    printf ( "Bad thumbnail size: %s\n", argv[i] );
+	    exit (0);
+	  }
+	  data.writeflag |= ( FTF_IMG | FTF_MAP | FTF_THUMB );
+	  break;
+	case 'W':
+	  /* only work on a window of level 0 tiles */
+	  if (( sscanf ( optionArg ( argc, argv, &i ), "%d,%d,%d,%d",
+			 &(data.region.x0), &(data.region.y0),
+			 &(data.region.x1), &(data.region.y1) ) != 4 ) ||
+	      ( data.region.x0 < 0 ) || ( data.region.x0 > data.region.x1 ) ||
+	      ( data.region.y0 < 0 ) || ( data.region.y0 > data.region.y1 )) {
+	    printf ( "Bad region: %s\n", argv[i] );
+	    exit (0);
+	  }
+	  data.writeflag |= FTF_REGION;
+	  break;
 	case 'v':
 	  data.debug++;
 	  break;
@@ -213,8 +432,58 @@ parseArgs ( int argc, char *argv[] )
       }
     }
   }
+
+  if ( data.bench && !data.queryPath ) {
+    printf ( "%cb needs a query file (%cq file)\n", COMSEP, COMSEP );
+    exit (0);
+  }
+
+  if ( data.checkImage && !data.checkPath ) {
+    printf ( "%cX needs a directory of levels to check (%cx dir)\n", COMSEP, COMSEP );
+    exit (0);
+  }
+
+  /* a window only loads some of the tiles */
+  if ( data.checkPath && ( data.writeflag & FTF_REGION )) {
+    printf ( "%cx checks the whole map, not a window (%cW)\n", COMSEP, COMSEP );
+    exit (0);
+  }
+
+  if ( data.stats && data.diffPath ) {
+    printf ( "%ca and %cd can't be used together\n", COMSEP, COMSEP );
+    exit (0);
+  }
+
+  /* the files written are checksummed on the way out */
+  if ( data.manifest ) data.opener = manifestOpen;
+
+  if ( data.reach && !data.spawns ) {
+    printf ( "%cr needs at least one spawn point (%cs x,y)\n", COMSEP, COMSEP );
+    exit (0);
+  }
+
+  if (( data.islands & ISL_SPAWNS ) && !data.spawns ) {
+    printf ( "%cK needs at least one spawn point (%cs x,y)\n", COMSEP, COMSEP );
+    exit (0);
+  }
+
+#ifdef IS_UNIX
+  /* default to one render thread per processor */
+  if ( data.threads < 1 ) data.threads = (int) sysconf ( _SC_NPROCESSORS_ONLN );
+#endif
 } /* end parseArgs */
 
+char *
+optionArg ( int argc, char *argv[], int *i )
+{
+  /* the value is the next argument */
+  if ( ++(*i) >= argc ) {
+    printf ( "Parameter %s needs a value\n", argv[*i - 1] );
+    exit (0);
+  }
+  return argv[*i];
+} /* end optionArg */
+
 void
 usage ( const char *name )
 {
@@ -237,7 +506,11 @@ usage ( const char *name )
   printf ( "     %cI = output info file\n",                                  COMSEP );
   printf ( "     %cT = output text file (smallOnes points)\n",               COMSEP );
   printf ( "     %c8 = output is 8 bit raw image file\n",                    COMSEP );
-  printf ( "     %cB = output is a bitmap image\n\n",                        COMSEP );
+  printf ( "     %cB = output is a bitmap image\n",                          COMSEP );
+  printf ( "     %cn = output compressed levels at their own resolution\n",  COMSEP );
+  printf ( "     %cZ = output images as a zoom pyramid of bitmap tiles\n", COMSEP );
+  printf ( "     %cC = run length encode bitmap images\n",                 COMSEP );
+  printf ( "     %cp = output png images instead of bitmaps\n\n",         COMSEP );
 
   printf ( "     %cD = output diagnostic images\n",                          COMSEP );
   printf ( "     %cG = include grid in diagnostic images\n",                 COMSEP );
@@ -245,6 +518,30 @@ usage ( const char *name )
   printf ( "     %cL = connect points in smallOnes diagnostic image\n\n",    COMSEP );
 
   printf ( "     %cA = use alternat compression method\n", COMSEP );
+  printf ( "     %cj n = render images on n threads\n", COMSEP );
+  printf ( "     %cc dir = reuse map, info and smallOnes files cached in dir\n", COMSEP );
+  printf ( "     %cU = only update tiles changed since the files in the output path\n", COMSEP );
+  printf ( "     %cw = keep running and rebuild when the input file changes\n", COMSEP );
+  printf ( "     %cH port = serve map tiles on http://127.0.0.1:port/\n", COMSEP );
+  printf ( "     %cE name = share the maps in memory as /name.Vehicle\n", COMSEP );
+  printf ( "     %ci = report the smallOnes islands (areas linked to each other)\n", COMSEP );
+  printf ( "     %ck n = drop smallOnes islands of fewer than n points\n", COMSEP );
+  printf ( "     %cK = drop smallOnes islands with no spawn point in them\n", COMSEP );
+  printf ( "     %cs x,y = a spawn point, in level 0 pixels from the bottom left (can be repeated)\n", COMSEP );
+  printf ( "     %cg = write the smallOnes graph as a list of links for each point\n", COMSEP );
+  printf ( "     %cq file = find paths between the x0,y0 x1,y1 pairs in file\n", COMSEP );
+  printf ( "     %cb = also time the paths against a search of level 0 alone\n", COMSEP );
+  printf ( "     %cr n = flood level n from the first spawn point, check the others\n", COMSEP );
+  printf ( "     %cY path = check the smallOnes in path (a file or directory) against the map\n", COMSEP );
+  printf ( "     %cx dir = check the level 1 to 5 map files in dir against level 0\n", COMSEP );
+  printf ( "     %cX = also draw the pixels of each level that differ\n", COMSEP );
+  printf ( "     %cd dir = list what changed from the files in dir to those in the input dir\n", COMSEP );
+  printf ( "     %ca json|csv = sum up the pathmap files in the input dir\n", COMSEP );
+  printf ( "     %co = list the files written, with their size and crc32c, in Manifest.txt\n", COMSEP );
+  printf ( "     %cO file = check the files in the input dir against the manifest file\n", COMSEP );
+  printf ( "     %cm n = keep at most n MB of maps in memory between jobs\n", COMSEP );
+  printf ( "     %ct n = output an n x n density thumbnail of the map\n", COMSEP );
+  printf ( "     %cW x0,y0,x1,y1 = only the window of level 0 tiles x0,y0 to x1,y1\n", COMSEP );
   printf ( "     %cv = increase output verbosity\n", COMSEP );
   printf ( "     %cV = print version number and quit\n", COMSEP );
   printf ( "     %ch or %c\?  = display this help\n\n", COMSEP, COMSEP );
@@ -266,6 +563,78 @@ usage ( const char *name )
 	   name, PATHSEP, PATHSEP, PATHSEP );
   printf ( "All of the compressed game pathfinding files are created and output to\n" );
   printf ( "the output directory. 8 bit raw images produce the same result.\n\n" );
+  printf ( "     %s %cW 10,4,13,6 %csome_path%cInfantry1Level0Map.bmp %coutput\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "With a window, images are cut down to those tiles. A bitmap of just the\n" );
+  printf ( "window is patched into the level 0 search map already in the output\n" );
+  printf ( "directory, and the game files are made from that.\n\n" );
+  printf ( "     %s %cc cache %csome_path%cInfantry1Level0Map.bmp %coutput\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "Game files made from a bitmap are also kept in the cache directory. Run\n" );
+  printf ( "again on an unchanged bitmap, they are linked from there, not made.\n\n" );
+  printf ( "     %s %cU %csome_path%cInfantry1Level0Map.bmp %coutput\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "The game files already in the output directory are updated. Only the\n" );
+  printf ( "tiles that differ from the level 0 search map there are worked on.\n\n" );
+  printf ( "     %s %cw %csome_path %coutput\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP );
+  printf ( "Every level 0 bitmap or 8 bit raw image in some_path is made into game\n" );
+  printf ( "files, then again each time one is saved. Only the vehicle that changed\n" );
+  printf ( "is done, and only its changed tiles. Stop with Ctrl-C.\n\n" );
+  printf ( "     %s %cH 8042 %csome_path%cTank0Level0Map.bmp %coutput\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "No files are written. Tiles of every level, the info and smallOnes maps\n" );
+  printf ( "and a numbered grid are drawn when asked for, e.g.\n" );
+  printf ( "http://127.0.0.1:8042/Tank/map/1/5/7.bmp is column 5 row 7 of level 1.\n" );
+  printf ( "Layers are map, info, smallones and grid. Stop with Ctrl-C.\n\n" );
+  printf ( "     %s %cE sim %csome_path%cTank0Level0Map.bmp %coutput\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "The files are made as usual, and every level, the info and the smallOnes\n" );
+  printf ( "maps are also left in the shared memory /sim.Tank for other programs on\n" );
+  printf ( "this machine. sharedmaps.h has the layout and the functions to read it.\n\n" );
+  printf ( "     %s %ci %ck 8 %cs 120,900 %csome_path%cTank0Level0Map.bmp %coutput\n\n",
+	   name, COMSEP, COMSEP, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "TankIslands.txt lists the groups of smallOnes points linked to each other,\n" );
+  printf ( "biggest first, and which spawn points are in them. Groups of fewer than 8\n" );
+  printf ( "points are left out of Tank.raw and TankInfo.raw.\n\n" );
+  printf ( "     %s %cb %cq paths.txt %csome_path%cTank0Level0Map.bmp %coutput\n\n",
+	   name, COMSEP, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "Each line of paths.txt is a start and a goal in level 0 pixels, like\n" );
+  printf ( "100,220 870,640. The paths are found over the smallOnes points, then\n" );
+  printf ( "pixel by pixel inside the tiles, as the game does. TankPaths.txt has\n" );
+  printf ( "each length and how much was searched. With %cb every path is also found\n", COMSEP );
+  printf ( "on the level 0 map alone, and the speed and lengths are compared.\n\n" );
+  printf ( "     %s %cr 0 %cs 120,900 %cs 1900,310 %csome_path%cTank0Level0Map.bmp %coutput\n\n",
+	   name, COMSEP, COMSEP, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "Everything a tank can reach from 120,900 is drawn in Tank0Level0Reach.bmp\n" );
+  printf ( "and if 1900,310 is not part of it, or 120,900 is not on DoGo, the\n" );
+  printf ( "program ends with an error.\n\n" );
+  printf ( "     %s %cY %csome_path%cTank.txt %csome_path%cTank0Level0Map.raw %coutput\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "The points and links in Tank.txt are checked against the map. Points on\n" );
+  printf ( "NoGo, links between areas that don't touch and areas that touch with no\n" );
+  printf ( "link are listed in TankVerify.txt, and the program ends with an error.\n\n" );
+  printf ( "     %s %cX %cx %csome_path %csome_path%cTank0Level0Map.raw %coutput\n\n",
+	   name, COMSEP, COMSEP, PATHSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "Tank0Level1Map.raw and Tank0Level2Map.raw are checked against what level 0\n" );
+  printf ( "makes. The tiles that differ are listed in TankLevels.txt and drawn in\n" );
+  printf ( "Tank0Level1Check.bmp and Tank0Level2Check.bmp, and the program ends with\n" );
+  printf ( "an error.\n\n" );
+  printf ( "     %s %cd %cold_path %cnew_path %coutput\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "Every map level and smallOnes file in new_path is compared with the one in\n" );
+  printf ( "old_path. Diff.txt lists the tiles that changed, with the pixels that are\n" );
+  printf ( "now NoGo or DoGo, and the smallOnes points and links added, removed or\n" );
+  printf ( "moved. Each level that changed is drawn in Tank0Level0Diff.bmp and so on.\n\n" );
+  printf ( "     %s %ca json %cpath %coutput\n\n", name, COMSEP, PATHSEP, PATHSEP );
+  printf ( "Every map level and smallOnes file in path is read, and Stats.json gets the\n" );
+  printf ( "uniform and mixed tiles and walkable fraction of each level, and the points,\n" );
+  printf ( "links and areas per tile of each smallOnes. No images are drawn.\n\n" );
+  printf ( "     %s %cO %cold_path%cManifest.txt %cdeployed_path\n\n",
+	   name, COMSEP, PATHSEP, PATHSEP, PATHSEP );
+  printf ( "Each file listed in a Manifest.txt written with %co is read from deployed_path\n", COMSEP );
+  printf ( "and its size and crc32c checked. Files that are missing or don't match are\n" );
+  printf ( "listed, and the program ends with an error.\n\n" );
 
   exit(0);
 } /* end usage */
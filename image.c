@@ -27,9 +27,15 @@
 #include "common.h"
 #include "commonutils.h"
 
+#ifdef __BMI2__
+  #include <immintrin.h>
+#endif
+
 #include "image.h"
 #include "smallones.h"
 #include "pathfindingmap.h"
+#include "pyramid.h"
+#include "png.h"
 
 /************************************  global variables      ************************/
 
@@ -68,7 +74,9 @@ rgbQuad defaultColors[16] = {
 
 };
 
-unsigned char colors[16] = {
+/* the gray levels of the map values - setImageColors starts each image
+ * from these, 1 and 4 bit images then use their own */
+static unsigned char grayLevels[16] = {
   0,                        /* DoGo                                                   */
   23,                       /* info1                                                  */
   47,                       /* info2                                                  */
@@ -87,8 +95,24 @@ unsigned char colors[16] = {
   255                       /* NoGo                                                   */
 };
 
+/* the levels of the image this thread is writing */
+THREAD_LOCAL unsigned char colors[16];
+
+
 
+#ifdef IS_UNIX
+/* the band queue this thread is rendering or writing for, and where an
+ * error goes back to - see renderRecover */
+static THREAD_LOCAL bandQueue *rendering = NULL;
+static THREAD_LOCAL jmp_buf    renderTrap;
+#endif
 
+/* tables for blitMapRow, rebuilt when the scale changes */
+THREAD_LOCAL unsigned char      bitReverse[256];
+THREAD_LOCAL unsigned long long blitTable[256];
+THREAD_LOCAL int                blitMult = 0;
+
+extern THREAD_LOCAL userData data;
 extern char *baseName[];
 
 /************************************  functions             ************************/
@@ -96,7 +120,16 @@ extern char *baseName[];
 void
 loadImage ( pathfindingmap *map )
 {
-  if ( map->io.type & FTF_RAW ) {
+  /* a window is patched into the map that is already there */
+  if ( data.writeflag & FTF_REGION ) loadPatchBase ( map );
+
+  if (( map->io.type & FTF_RAW ) && map->tile ) {
+    if ( fileSize ( map ) != WIN_COLS ( map ) * WIN_ROWS ( map ) * TILE_DIM * TILE_DIM )
+      shutdown ( EF_FILE_SIZE,
+		 "Bad file size for 8 bit %s map window.\n",
+		 baseName[map->io.vehicle] );
+    readPixels ( map, 8, BI_RGB );
+  } else if ( map->io.type & FTF_RAW ) {
     /* only accept the 3 allowed map sizes (are there more?) */
     switch ( fileSize ( map ))
       {
@@ -117,16 +150,17 @@ loadImage ( pathfindingmap *map )
 		   "Bad file size for 8 bit %s map.\n",
 		   baseName[map->io.vehicle] );
       }
-    readPixels ( map, 8 );
-  } else {
-    loadBmpHeader ( map );
-    readPixels ( map, map->io.bits );
-  }
+    readPixels ( map, 8, BI_RGB );
+  } else if ( isPngFile ( map )) {
+    loadPng ( map );
+    readPixels ( map, map->io.bits, BI_PNG );
+  } else
+    readPixels ( map, map->io.bits, loadBmpHeader ( map ));
 
 
 } /* end loadMap8Bit */
 
-void
+int
 loadBmpHeader ( pathfindingmap *map )
 {
   bidHeader      header;
@@ -158,16 +192,15 @@ loadBmpHeader ( pathfindingmap *map )
 	       "Unexpected bitmap info header size for %s file.\n",
 	       baseName[map->io.vehicle] );
 
-  if (( infoHeader.biWidth != infoHeader.biHeight ) ||
-      !(( infoHeader.biWidth == SM_MAP ) ||
-	( infoHeader.biWidth == MD_MAP ) ||
-	( infoHeader.biWidth == XL_MAP ) ||
-	( infoHeader.biWidth == LG_MAP )))
+  if ( !isImageDim ( map, infoHeader.biWidth, infoHeader.biHeight ))
     shutdown ( EF_BAD_DATA,
 	       "%s bitmap file has the wrong dimentions\n",
 	       baseName[map->io.vehicle] );
 
-  if ( infoHeader.biCompression )
+  /* run length encoding is the only compression understood */
+  if ( infoHeader.biCompression &&
+       !(( infoHeader.biCompression == BI_RLE8 ) && ( infoHeader.biBitCount == 8 )) &&
+       !(( infoHeader.biCompression == BI_RLE4 ) && ( infoHeader.biBitCount == 4 )))
     shutdown ( EF_BAD_DATA,
 	       "%s bitmap file compression is unsupported.\n",
 	       baseName[map->io.vehicle] );
@@ -199,7 +232,7 @@ loadBmpHeader ( pathfindingmap *map )
 	       baseName[map->io.vehicle] );
 
   map->io.bits = infoHeader.biBitCount;
-  map->res = infoHeader.biWidth;
+  return infoHeader.biCompression;
 } /* end loadBmpHeader */
 
 void
@@ -213,62 +246,663 @@ writeImageFile ( pathfindingmap *map )
 
   if ( map->io.type & FTF_RAW )  map->io.bits = 8;
   else if ( map->io.type & FTF_MAP )
-    map->io.bits = ( map->io.type & FTF_PREP ) ? 4 : 1;
+    /* there is no run length encoding for 1 bit bitmaps */
+    map->io.bits = (( map->io.type & FTF_PREP ) || isRleImage ( map )) ? 4 : 1;
   else if ( map->io.type & ( FTF_SO | FTF_INFO ))
     map->io.bits = 4;
 
-  mult    = (( map->io.type & FTF_INFO ) ? 1 : ( 1 << map->io.level ));
+  setSpanFill ( map );
+  setImageWindow ( map );
+  setImageColors ( map );
+
+  mult    = imageScale ( map );
   mapDim  = map->res * mult;
   tileDim = TILE_DIM * mult;
   bufSize = ( mapDim * tileDim * map->io.bits ) / 8;
 
-  /* create output buffer - image width x tile length */
-  if ((map->buf  = (unsigned char *) malloc ( bufSize )) == NULL )
-    shutdown ( EF_MALLOC, "Error creating output buffer\n" );
+  /* worst case a row of run length codes is 2 bytes a pixel */
+  if ( isRleImage ( map )) {
+    if ( !( map->rle = (unsigned char *) malloc ( mapDim * 2 + 4 )))
+      shutdown ( EF_MALLOC, "Error creating run length buffer\n" );
+    map->rleSize = 0;
+  }
+
+  /* pyramids write a bitmap header per tile, otherwise if not
+   * outputing raw, write bitmap header
+   */
+  if ( map->io.type & FTF_PYRAMID ) initPyramid ( map );
+  else if ( isPngImage ( map ))
+    map->png = pngOpen ( map, map->fp, imageWidth ( map ), imageHeight ( map ));
+  else if ( !( map->io.type & FTF_RAW )) writeBmpHeader ( map );
+
+  /* 1 bit map bitmaps are copied straight from the tile data */
+  if ( isBlitImage ( map )) initBlitTable ( mult );
+
+  /* smallOnes lines are gathered for the whole map up front */
+  if (( IMGTYPES( map->io.type ) == FTF_SO ) && !( map->io.type & FTF_PREP )) {
+    freeSegmentBins ( &(map->lines) );
+    buildSmallOnesLines ( map );
+  }
+
+  /* process the file one tile row at a time - on as many threads as we
+   * have, if there is more than one row to do
+   */
+#ifdef IS_UNIX
+  if (( data.threads > 1 ) && ( WIN_ROWS ( map ) > 1 ))
+    writeBandsThreaded ( map, bufSize );
+  else
+#endif
+  {
+    /* create output buffer - image width x tile length */
+    if ((map->buf  = (unsigned char *) malloc ( bufSize )) == NULL )
+      shutdown ( EF_MALLOC, "Error creating output buffer\n" );
+
+    for ( row=0; row < WIN_ROWS ( map ); row += 1 ) {
+      renderBand ( map, imageBandRow ( map, row ));
+      writeImageBand ( map, map->buf, bufSize );
+    }
+    free ( map->buf );
+    map->buf = NULL;
+  }
+  freeSegmentBins ( &(map->lines) );
+  if ( map->io.type & FTF_PYRAMID ) finishPyramid ( map );
+  if ( map->rle ) finishRleImage ( map );
+  if ( map->png ) {
+    pngClose ( map->png );
+    map->png = NULL;
+  }
+} /* end writeImageFile */
+
+int
+imageScale ( pathfindingmap *map )
+{
+  /* compressed map levels are blown back up to level 0 size, unless
+   * they are wanted at their own resolution
+   */
+  if ( map->io.type & ( FTF_INFO | FTF_NATIVE )) return 1;
+  return 1 << map->io.level;
+} /* end imageScale */
+
+int
+imageWidth ( pathfindingmap *map )
+{
+  return WIN_COLS ( map ) * TILE_DIM * imageScale ( map );
+} /* end imageWidth */
+
+int
+imageHeight ( pathfindingmap *map )
+{
+  return WIN_ROWS ( map ) * TILE_DIM * imageScale ( map );
+} /* end imageHeight */
+
+void
+setImageWindow ( pathfindingmap *map )
+{
+  int ratio;
+
+  map->win.x0 = map->win.y0 = 0;
+  map->win.x1 = map->tilesPerRow - 1;
+  map->win.y1 = map->tilesPerCol - 1;
+
+  /* pyramids are already a way to look at a piece of the map */
+  if ( !( data.writeflag & FTF_REGION ) || ( map->io.type & FTF_PYRAMID )) return;
+
+  /* the region is in level 0 tiles, compressed levels have fewer */
+  ratio = ( map->res << (( map->io.type & FTF_INFO ) ? 0 : map->io.level )) /
+    ( TILE_DIM * map->tilesPerRow );
+  if ( ratio < 1 ) ratio = 1;
+
+  map->win.x0 = data.region.x0 / ratio;
+  map->win.y0 = data.region.y0 / ratio;
+  map->win.x1 = MIN ( data.region.x1 / ratio, map->tilesPerRow - 1 );
+  map->win.y1 = MIN ( data.region.y1 / ratio, map->tilesPerCol - 1 );
+
+  if (( map->win.x0 > map->win.x1 ) || ( map->win.y0 > map->win.y1 ))
+    shutdown ( EF_BAD_DATA, "Region is outside the %s map\n",
+	       baseName[map->io.vehicle] );
+} /* end setImageWindow */
 
-  /* if not outputing raw, write bitmap header */
-  if ( !( map->io.type & FTF_RAW )) writeBmpHeader ( map );
+int
+isWindowLoad ( pathfindingmap *map )
+{
+  /* tiles outside the window can only be left behind when all that
+   * is wanted is a picture of this map
+   */
+  return (( data.writeflag & FTF_REGION ) && ( data.writeflag & FTF_IMG ) &&
+	  !( data.writeflag & ( FTF_PYRAMID | FTF_THUMB )) &&
+	  ( IMGTYPES( data.writeflag ) == IMGTYPES( map->io.type )));
+} /* end isWindowLoad */
+
+int
+isImageDim ( pathfindingmap *map, int width, int height )
+{
+  /* a patch has to be the size of the window */
+  if ( map->tile )
+    return (( width  == WIN_COLS ( map ) * TILE_DIM ) &&
+	    ( height == WIN_ROWS ( map ) * TILE_DIM ));
+
+  if (( width != height ) ||
+      !(( width == SM_MAP ) ||
+	( width == MD_MAP ) ||
+	( width == XL_MAP ) ||
+	( width == LG_MAP )))
+    return FALSE;
+
+  map->res = width;
+  return TRUE;
+} /* end isImageDim */
+
+int
+isBlitImage ( pathfindingmap *map )
+{
+  return (( IMGTYPES( map->io.type ) == FTF_MAP ) && ( map->io.bits == 1 ) &&
+	  !( map->io.type & FTF_RAW ) && map->tile &&
+	  ( map->bytesPerRow == ROW_BYTES ));
+} /* end isBlitImage */
+
+int
+isRleImage ( pathfindingmap *map )
+{
+  /* pyramid tiles are small enough left as they are */
+  return (( map->io.type & FTF_RLE ) &&
+	  !( map->io.type & ( FTF_RAW | FTF_PYRAMID | FTF_PNG )));
+} /* end isRleImage */
 
-  /* process the file one tile row at a time */
+int
+isPngImage ( pathfindingmap *map )
+{
+  return (( map->io.type & FTF_PNG ) &&
+	  !( map->io.type & ( FTF_RAW | FTF_PYRAMID )));
+} /* end isPngImage */
+
+int
+isThumbImage ( pathfindingmap *map )
+{
+  /* thumbnails are only made of pathfinding maps */
+  return (( map->io.type & FTF_THUMB ) && ( IMGTYPES( map->io.type ) == FTF_MAP ));
+} /* end isThumbImage */
+
+int
+imageBandRow ( pathfindingmap *map, int n )
+{
+  /* png rows go top down, bitmap rows bottom up */
+  return isPngImage ( map ) ? map->win.y1 - n : map->win.y0 + n;
+} /* end imageBandRow */
+
+void
+renderBand ( pathfindingmap *map, int row )
+{
+  int bufSize;
+
+  if ( isBlitImage ( map )) {
+    blitMapRow ( map, row );
+    return;
+  }
+
+  bufSize = map->res * TILE_DIM * map->io.bits / 8;
+  bufSize *= imageScale ( map ) * imageScale ( map );
 
   /* zero the row of tiles */
-  for ( row=0; row < map->tilesPerCol; row += 1 ) {
+  memset ( map->buf, colors [ GP_DOGO ], bufSize );
+
+  plotBand ( map, row );
+} /* end renderBand */
+
+void
+renderTile ( pathfindingmap *map, int col, int row )
+{
+  int rowBytes;
+  int tileBytes;
+  int offset;
+  int i;
 
-    memset ( map->buf, colors [ GP_DOGO ], bufSize );
+  /* the band is still the width of the map, only the one tile in it is
+   * cleared and drawn */
+  map->win.x0 = map->win.x1 = col;
+  map->win.y0 = map->win.y1 = row;
 
-    if (!( map->io.type & FTF_MAP )) prepImageBuf ( map, row );
+  rowBytes  = map->res * imageScale ( map ) * map->io.bits / 8;
+  tileBytes = TILE_DIM * imageScale ( map ) * map->io.bits / 8;
+  offset    = col * tileBytes;
+  for ( i = 0; i < TILE_DIM * imageScale ( map ); i++ )
+    memset ( map->buf + i * rowBytes + offset, colors [ GP_DOGO ], tileBytes );
 
-    switch ( IMGTYPES(map->io.type))
-      {
-      case FTF_SO:
-	if ( map->io.type & FTF_PREP )
-	  plotImageRow ( map, row );
-	else
-	  plotSmallOnesRow ( map, row );
-	break;
+  plotBand ( map, row );
+  cropImageBand ( map, map->buf, rowBytes * TILE_DIM * imageScale ( map ));
+} /* end renderTile */
 
-      case FTF_INFO:
-      case FTF_MAP:
+void
+plotBand ( pathfindingmap *map, int row )
+{
+  if (!( map->io.type & FTF_MAP )) prepImageBuf ( map, row );
+
+  switch ( IMGTYPES(map->io.type))
+    {
+    case FTF_SO:
+      if ( map->io.type & FTF_PREP )
 	plotImageRow ( map, row );
+      else
+	plotSmallOnesRow ( map, row );
+      break;
+
+    case FTF_INFO:
+    case FTF_MAP:
+      plotImageRow ( map, row );
+      break;
+    case FTF_NONE:
+      if ( map->io.type & FTF_GRID ) break;
+    default:
+      shutdown ( EF_BAD_DATA, "Function writeImageFile passed bad map type\n");
+    }
+} /* end plotBand */
+
+void
+writeImageBand ( pathfindingmap *map, unsigned char *buf, int size )
+{
+  int offset;
+
+  size = cropImageBand ( map, buf, size );
+
+  if ( map->io.type & FTF_PYRAMID ) {
+    pyramidBand ( map, buf, size );
+    return;
+  }
+  if ( map->rle ) {
+    writeRleBand ( map, buf, size );
+    return;
+  }
+  if ( map->png ) {
+    /* the band is upside down to png */
+    for ( offset = size - map->png->rowBytes; offset >= 0; offset -= map->png->rowBytes )
+      pngWriteRow ( map->png, buf + offset );
+    return;
+  }
+
+  /* write this row of tiles to plot file */
+  if ( !fwrite ( buf, size, 1, map->fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing to plot image: %s\n",
+	       baseName[map->io.vehicle] );
+} /* end writeImageBand */
+
+int
+cropImageBand ( pathfindingmap *map, unsigned char *buf, int size )
+{
+  int rowBytes;
+  int winBytes;
+  int offset;
+  int i;
+
+  /* bands are drawn the width of the map, pull the window to the front */
+  rowBytes = map->res * imageScale ( map ) * map->io.bits / 8;
+  winBytes = imageWidth ( map ) * map->io.bits / 8;
+  if ( winBytes == rowBytes ) return size;
+
+  offset = map->win.x0 * TILE_DIM * imageScale ( map ) * map->io.bits / 8;
+  for ( i = 0; i < size / rowBytes; i++ )
+    memmove ( buf + i * winBytes, buf + i * rowBytes + offset, winBytes );
+
+  return ( size / rowBytes ) * winBytes;
+} /* end cropImageBand */
+
+void
+writeRleBand ( pathfindingmap *map, unsigned char *buf, int size )
+{
+  int width;
+  int rowBytes;
+  int len;
+
+  width    = imageWidth ( map );
+  rowBytes = width * map->io.bits / 8;
+
+  for ( ; size > 0; size -= rowBytes, buf += rowBytes ) {
+    len = rleEncodeRow ( buf, width, map->io.bits, map->rle );
+    if ( !fwrite ( map->rle, len, 1, map->fp ))
+      shutdown ( EF_FILE_WRITE, "Error writing to plot image: %s\n",
+		 baseName[map->io.vehicle] );
+    map->rleSize += len;
+  }
+} /* end writeRleBand */
+
+void
+finishRleImage ( pathfindingmap *map )
+{
+  unsigned char eob[2] = { 0, 1 };
+  long end;
+
+  if ( !fwrite ( eob, 2, 1, map->fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing to plot image: %s\n",
+	       baseName[map->io.vehicle] );
+  map->rleSize += 2;
+
+  /* now the size is known the header can be filled in. back to where
+   * the image ended by offset - a memory stream's end moves with a seek */
+  end = ftell ( map->fp );
+  fseek ( map->fp, 0, SEEK_SET );
+  writeBmpHeaderDim ( map, map->fp, imageWidth ( map ), imageHeight ( map ));
+  fseek ( map->fp, end, SEEK_SET );
+
+  free ( map->rle );
+  map->rle = NULL;
+} /* end finishRleImage */
+
+/* bitmap run length codes come in byte pairs - a count and a color for a
+ * run, 0 and a count for that many pixels stored as is (padded out to 2
+ * bytes), or 0 and 0 / 1 / 2 for end of line / end of image / move.
+ * 4 bit runs alternate the two nibbles of the color byte.
+ */
+#define RLE_PIX(src,bits,i) \
+  (( (bits) == 8 ) ? (src)[i] : ((i) & 1 ) ? (src)[(i) >> 1] & 0x0f : (src)[(i) >> 1] >> 4 )
+
+int
+rleEncodeRow ( unsigned char *src, int width, int bits, unsigned char *dst )
+{
+  unsigned char *p;
+  int color;
+  int i, j, len;
+
+  p = dst;
+  i = 0;
+  while ( i < width ) {
+    color = RLE_PIX ( src, bits, i );
+
+    /* 4 bit rows are run along a byte at a time where they can be */
+    len = 1;
+    if (( bits == 4 ) && !( i & 1 ) && ( src[ i >> 1 ] == color * 0x11 ))
+      for ( len = 2; ( len < 254 ) && ( i + len + 1 < width ) &&
+	      ( src[ ( i + len ) >> 1 ] == color * 0x11 ); len += 2 );
+    while (( len < 255 ) && ( i + len < width ) && ( RLE_PIX ( src, bits, i + len ) == color ))
+      len++;
+
+    if ( len > 1 ) {
+      *p++ = len;
+      *p++ = ( bits == 4 ) ? color * 0x11 : color;
+      i += len;
+      continue;
+    }
+
+    /* gather pixels up to the next run of 3 */
+    for ( j = i + 1; ( j < width ) && ( j - i < 255 ); j++ )
+      if (( j + 2 < width ) &&
+	  ( RLE_PIX ( src, bits, j ) == RLE_PIX ( src, bits, j + 1 )) &&
+	  ( RLE_PIX ( src, bits, j ) == RLE_PIX ( src, bits, j + 2 )))
+	break;
+    len = j - i;
+
+    if ( len < 3 ) {
+      /* too short to be stored as is */
+      if (( bits == 4 ) && ( len == 2 )) {
+	*p++ = 2;
+	*p++ = ( color << 4 ) | RLE_PIX ( src, bits, i + 1 );
+      } else for ( j = 0; j < len; j++ ) {
+	*p++ = 1;
+	*p++ = RLE_PIX ( src, bits, i + j ) * (( bits == 4 ) ? 0x11 : 1 );
+      }
+    } else {
+      *p++ = 0;
+      *p++ = len;
+      if ( bits == 8 ) {
+	memcpy ( p, src + i, len );
+	p += len;
+      } else {
+	for ( j = 0; j < len; j += 2 )
+	  *p++ = ( RLE_PIX ( src, bits, i + j ) << 4 ) |
+	    (( j + 1 < len ) ? RLE_PIX ( src, bits, i + j + 1 ) : 0 );
+      }
+      if (( p - dst ) & 1 ) *p++ = 0;
+    }
+    i += len;
+  }
+
+  /* end of line */
+  *p++ = 0;
+  *p++ = 0;
+  return p - dst;
+} /* end rleEncodeRow */
+
+void
+rleDecodeBand ( pathfindingmap *map, rleStream *rle, int width, int rows )
+{
+  unsigned char *src;
+  int count;
+  int code;
+  int offset;
+  int i;
+
+  memset ( map->buf, 0, ( width * rows * map->io.bits ) / 8 );
+
+  while (( rle->y < rows ) && ( rle->pos + 1 < rle->size )) {
+    count = rle->data[ rle->pos++ ];
+    code  = rle->data[ rle->pos++ ];
+    offset = rle->y * width + rle->x;
+
+    if ( count ) {
+      /* a run - clipped to the end of the row */
+      count = MIN ( count, width - rle->x );
+      if ( count <= 0 ) continue;
+      if (( map->io.bits == 8 ) || (( code >> 4 ) == ( code & 0x0f )))
+	map->fill ( map->buf, offset, count, code );
+      else for ( i = 0; i < count; i++ )
+	map->fill ( map->buf, offset + i, 1, ( i & 1 ) ? code : code >> 4 );
+      rle->x += count;
+
+    } else switch ( code )
+      {
+      case 0:
+	rle->x = 0;
+	rle->y++;
+	break;
+      case 1:
+	rle->pos = rle->size;
+	break;
+      case 2:
+	if ( rle->pos + 1 >= rle->size ) break;
+	rle->x += rle->data[ rle->pos++ ];
+	rle->y += rle->data[ rle->pos++ ];
 	break;
-      case FTF_NONE:
-	if ( map->io.type & FTF_GRID ) break;
       default:
-	shutdown ( EF_BAD_DATA, "Function writeImageFile passed bad map type\n");
+	/* pixels stored as is */
+	src = rle->data + rle->pos;
+	rle->pos += ((( map->io.bits == 8 ) ? code : ( code + 1 ) / 2 ) + 1 ) & ~1;
+	if ( rle->pos > rle->size )
+	  shutdown ( EF_BAD_DATA, "%s bitmap run length data is short\n",
+		     baseName[map->io.vehicle] );
+	for ( i = 0; ( i < code ) && ( rle->x + i < width ); i++ )
+	  map->fill ( map->buf, offset + i, 1, RLE_PIX ( src, map->io.bits, i ));
+	rle->x += code;
       }
+  }
+  /* the next band starts where this one left off */
+  rle->y -= rows;
+} /* end rleDecodeBand */
 
-    /* write this row of tiles to plot file */
-    if ( !fwrite (map->buf, bufSize, 1, map->fp ))
-      shutdown ( EF_FILE_WRITE, "Error writing to plot image: %s8bit.raw\n",
-		 baseName[map->io.vehicle] );
+#ifdef IS_UNIX
+
+void
+writeBandsThreaded ( pathfindingmap *map, int bufSize )
+{
+  bandQueue  queue;
+  /* kept over the longjmp back from renderRecover */
+  pthread_t * volatile thread;
+  volatile int started;
+  int threads;
+  int row, slot;
+  int i;
 
+  /* two buffers a thread, as long as the ring stays under the budget */
+  threads     = MIN ( data.threads, WIN_ROWS ( map ));
+  queue.slots = MAX ( 2, MIN ( threads * 2, BAND_RING_BYTES / bufSize ));
+  threads     = MIN ( threads, queue.slots );
+
+  queue.rows    = WIN_ROWS ( map );
+  queue.nextRow = 0;
+  queue.written = 0;
+  queue.err     = 0;
+
+  if ( !( queue.band   = (pathfindingmap *) malloc ( sizeof ( pathfindingmap ) * queue.slots )) ||
+       !( queue.done   = (int *) malloc ( sizeof ( int ) * queue.slots )) ||
+       !( thread       = (pthread_t *) malloc ( sizeof ( pthread_t ) * threads )))
+    shutdown ( EF_MALLOC, "Error creating image band ring\n" );
+
+  /* each slot is a copy of the map with its own output buffer */
+  for ( slot = 0; slot < queue.slots; slot++ ) {
+    queue.band[slot] = *map;
+    queue.done[slot] = -1;
+    if ( !( queue.band[slot].buf = (unsigned char *) malloc ( bufSize )))
+      shutdown ( EF_MALLOC, "Error creating output buffer\n" );
   }
-  free ( map->buf );
-  map->buf = NULL;
-}
+
+  pthread_mutex_init ( &(queue.lock), NULL );
+  pthread_cond_init  ( &(queue.cond), NULL );
+  saveRenderState ( &(queue.state) );
+
+  /* an error here or on a worker stops the queue and comes back here,
+   * to be reported once the workers are done with it */
+  started = 0;
+  if ( !setjmp ( renderTrap )) {
+    rendering = &queue;
+    for ( ; started < threads; started++ )
+      if ( pthread_create ( &(thread[started]), NULL, renderBands, &queue ))
+	shutdown ( EF_FUNCTION_ERR, "Error starting image render thread\n" );
+
+    /* write the rows out in order as they finish */
+    for ( row = 0; row < queue.rows; row++ ) {
+      slot = row % queue.slots;
+
+      pthread_mutex_lock ( &(queue.lock) );
+      while (( queue.done[slot] != row ) && !queue.err )
+	pthread_cond_wait ( &(queue.cond), &(queue.lock) );
+      pthread_mutex_unlock ( &(queue.lock) );
+      if ( queue.err ) break;
+
+      writeImageBand ( map, queue.band[slot].buf, bufSize );
+
+      /* hand the slot back */
+      pthread_mutex_lock ( &(queue.lock) );
+      queue.written = row + 1;
+      pthread_cond_broadcast ( &(queue.cond) );
+      pthread_mutex_unlock ( &(queue.lock) );
+    }
+    rendering = NULL;
+  }
+
+  for ( i = 0; i < started; i++ ) pthread_join ( thread[i], NULL );
+
+  pthread_cond_destroy  ( &(queue.cond) );
+  pthread_mutex_destroy ( &(queue.lock) );
+
+  for ( slot = 0; slot < queue.slots; slot++ ) free ( queue.band[slot].buf );
+  free ( queue.band );
+  free ( queue.done );
+  free ( thread );
+
+  if ( queue.err ) shutdown ( queue.err, "%s", queue.error );
+} /* end writeBandsThreaded */
+
+void *
+renderBands ( void *arg )
+{
+  bandQueue *queue = (bandQueue *) arg;
+  int row, slot;
+
+  loadRenderState ( &(queue->state) );
+  if ( setjmp ( renderTrap )) return NULL;
+  rendering = queue;
+
+  pthread_mutex_lock ( &(queue->lock) );
+  while (( queue->nextRow < queue->rows ) && !queue->err ) {
+    row  = queue->nextRow++;
+    slot = row % queue->slots;
+
+    /* wait for the writer to finish with this slot */
+    while (( row - queue->written >= queue->slots ) && !queue->err )
+      pthread_cond_wait ( &(queue->cond), &(queue->lock) );
+    if ( queue->err ) break;
+    pthread_mutex_unlock ( &(queue->lock) );
+
+    renderBand ( &(queue->band[slot]), imageBandRow ( &(queue->band[slot]), row ));
+
+    pthread_mutex_lock ( &(queue->lock) );
+    queue->done[slot] = row;
+    pthread_cond_broadcast ( &(queue->cond) );
+  }
+  pthread_mutex_unlock ( &(queue->lock) );
+
+  rendering = NULL;
+  return NULL;
+} /* end renderBands */
+
+void
+saveRenderState ( renderState *state )
+{
+  state->data = data;
+  memcpy ( state->colors, colors, sizeof ( colors ));
+  state->blitMult = blitMult;
+} /* end saveRenderState */
+
+void
+loadRenderState ( renderState *state )
+{
+  data = state->data;
+  memcpy ( colors, state->colors, sizeof ( colors ));
+  if ( state->blitMult ) initBlitTable ( state->blitMult );
+} /* end loadRenderState */
+
+void
+renderRecover ( int err )
+{
+  bandQueue *queue = rendering;
+
+  /* the rest of the queue stops, the thread that made it reports the
+   * error - a worker's exit would end the process */
+  if ( !queue || !err ) return;
+  rendering = NULL;
+
+  pthread_mutex_lock ( &(queue->lock) );
+  if ( !queue->err ) {
+    queue->err = err;
+    strncpy ( queue->error, errorMessage (), BUF_SIZE - 1 );
+    queue->error[ BUF_SIZE - 1 ] = '\0';
+  }
+  pthread_cond_broadcast ( &(queue->cond) );
+  pthread_mutex_unlock ( &(queue->lock) );
+  longjmp ( renderTrap, err );
+} /* end renderRecover */
+
+#else /* IS_UNIX */
+
+void
+renderRecover ( int err )
+{
+} /* end renderRecover */
+
+#endif /* IS_UNIX */
 
 void
 writeBmpHeader ( pathfindingmap *map )
+{
+  setImageColors ( map );
+  writeBmpHeaderDim ( map, map->fp, imageWidth ( map ), imageHeight ( map ));
+} /* end writeBmpHeader */
+
+void
+setImageColors ( pathfindingmap *map )
+{
+  int i;
+
+  /* whatever the last image on this thread used */
+  memcpy ( colors, grayLevels, sizeof ( colors ));
+  if ( map->io.bits == 1 ) {
+    map->io.type|= FTF_GRAY;
+    colors[0] = 0; colors[1] = 1;
+  }
+  if ( map->io.bits == 4 ) for ( i = 0; i < 16; i++ ) colors[i] = i;
+
+  /* 8 bit images are already gray levels */
+  if ( map->io.bits == 8 ) map->io.type |= FTF_GRAY;
+} /* end setImageColors */
+
+void
+writeBmpHeaderDim ( pathfindingmap *map, FILE *fp, int width, int height )
 {
 
   bidHeader      header = { 0 };
@@ -277,141 +911,279 @@ writeBmpHeader ( pathfindingmap *map )
   rgbQuad        bmpColors[256];
 
 
-  int res;
   int numColors;
-  int i;
+  int stride;
 
   numColors =  1 << map->io.bits;
 
+  /* bitmap rows are padded out to 4 bytes */
+  stride = (( width * map->io.bits + 31 ) / 32 ) * 4;
+
   header.sig = DIB_SIGNATURE;
   header.offBits = ( sizeof ( bidHeader ) +
 		     sizeof ( bidInfoHeader ) +
 		     sizeof ( rgbQuad ) * ( 1 << map->io.bits ));
 
-  res = map->res << (( map->io.type & FTF_INFO ) ? 0 : map->io.level);
-  header.fileSize = header.offBits + res * res * map->io.bits / 8;
+  header.fileSize = header.offBits + stride * height;
+
+  /* run length encoded sizes are only known once the image is written */
+  if ( map->rle ) {
+    infoHeader.biCompression = ( map->io.bits == 4 ) ? BI_RLE4 : BI_RLE8;
+    infoHeader.biSizeImage   = map->rleSize;
+    header.fileSize = header.offBits + map->rleSize;
+  }
 
 
-  if ( ! fwrite ( &header, sizeof (bidHeader), 1, map->fp ))
+  if ( ! fwrite ( &header, sizeof (bidHeader), 1, fp ))
     shutdown ( EF_FILE_WRITE,
 	       "Error writing %s bitmap header\n",
 	       baseName[ map->io.vehicle ] );
 
   infoHeader.biSize          = 40;
-  infoHeader.biWidth         = infoHeader.biHeight = res;
+  infoHeader.biWidth         = width;
+  infoHeader.biHeight        = height;
   infoHeader.biPlanes        = 1;
   infoHeader.biBitCount      = map->io.bits;
   infoHeader.biXPelsPerMeter = infoHeader.biYPelsPerMeter = DIB_PELSPERMETER;
   infoHeader.biClrUsed       = infoHeader.biClrImportant = numColors;
 
-  if ( ! fwrite ( &infoHeader, sizeof (bidInfoHeader), 1, map->fp ))
+  /* downscaled levels have bigger pixels */
+  if (( map->io.type & FTF_NATIVE ) && !( map->io.type & FTF_INFO ))
+    infoHeader.biXPelsPerMeter = infoHeader.biYPelsPerMeter =
+      DIB_PELSPERMETER >> map->io.level;
+
+  if ( ! fwrite ( &infoHeader, sizeof (bidInfoHeader), 1, fp ))
     shutdown ( EF_FILE_WRITE,
 	       "Error writing %s bitmap header\n",
 	       baseName[ map->io.vehicle ] );
 
-  if ( map->io.bits == 1 ) {
-    map->io.type|= FTF_GRAY;
-    colors[0] = 0; colors[1] = 1;
-  }
-  if ( map->io.bits == 4 ) for ( i = 0; i < 16; i++ ) colors[i] = i;
-
-  if ( map->io.type & FTF_GRAY ) for ( i = 0; i < numColors; i++ ) {
-    bmpColors[i].rgbBlue = bmpColors[i].rgbGreen = bmpColors[i].rgbRed =
-      i * 255 / ( numColors - 1 ) ;
-    bmpColors[i].rgbReserved = 0;
-  }
-
-  if ( ! fwrite ( (( map->io.type & FTF_GRAY ) ? bmpColors : defaultColors ),
-		  sizeof (rgbQuad) * numColors, 1, map->fp ))
+  if ( ! fwrite ( imagePalette ( map, bmpColors ),
+		  sizeof (rgbQuad) * numColors, 1, fp ))
     shutdown ( EF_FILE_WRITE,
 	       "Error writing %s bitmap color map\n",
 	       baseName[ map->io.vehicle ] );
-} /* end writeBmpHeader */
+} /* end writeBmpHeaderDim */
+
+rgbQuad *
+imagePalette ( pathfindingmap *map, rgbQuad *gray )
+{
+  int numColors;
+  int i;
+
+  if ( !( map->io.type & FTF_GRAY )) return defaultColors;
+
+  numColors =  1 << map->io.bits;
+  for ( i = 0; i < numColors; i++ ) {
+    gray[i].rgbBlue = gray[i].rgbGreen = gray[i].rgbRed =
+      i * 255 / ( numColors - 1 ) ;
+    gray[i].rgbReserved = 0;
+  }
+  return gray;
+} /* end imagePalette */
 
 void
 plotImageRow ( pathfindingmap *map, int row )
 {
-  int offset, byteOff;
-  int bytesPerRow, rowsPerTile;
-  int color;
+  tileData *tile = NULL;
   int col;
-  int tileRow, rowByte, bit;
-  int recX1, recX2, recY1, recY2;
-  int colorIndex;
-  int srcInc, dstInc;
+  int color;
+  int runCol, runColor;
   int tileDim;
-  int mult;
   int noGoColor;
+  int isInfo;
 
-  rowsPerTile = map->rowsPerTile;
-  bytesPerRow = map->bytesPerRow;
+  if ( !map->tile ) return;
+  if ( !map->fill ) setSpanFill ( map );
 
-  srcInc = ( map->io.type & FTF_INFO ) ? 2 : 1;
-  dstInc = 1 << map->io.level;
-  mult    = (( map->io.type & FTF_INFO ) ? 1 : ( 1 << map->io.level ));
-  tileDim = TILE_DIM * mult;
+  isInfo    = ( map->io.type & FTF_INFO ) ? TRUE : FALSE;
+  tileDim   = TILE_DIM * imageScale ( map );
   noGoColor = ( map->io.bits == 8 ) ? 15 : ( 1 << map->io.bits ) - 1;
-  for ( col = 0; col < map->tilesPerRow; col++ ) {
-    offset = row * map->tilesPerCol + col;
-
-    if ( map->tile ) {
-      switch ( map->tile[offset].flag )
-	{
-	case TDT_DOGO:
-	  if ( map->io.type & FTF_INFO )
-	    drawRectangle ( map,
-			    col, 0, 0,
-			    col, tileDim - 1, tileDim - 1,
-			    colors[ GP_INFO0 ] );
-
-	  continue;
-	case TDT_NOGO:
-	  drawRectangle ( map,
-			  col, 0, 0,
-			  col, tileDim - 1, tileDim - 1,
-			  colors[ noGoColor ] );
-	  break;
-	case TDT_MIXED:
-	  for ( tileRow = 0; tileRow < rowsPerTile; tileRow++ )
-
-	    for ( rowByte = 0; rowByte < bytesPerRow; rowByte++ ) {
-	      for ( bit = 0; bit < 8; bit += srcInc ) {
-
-		byteOff = tileRow * bytesPerRow + rowByte;
-
-		if ( map->io.type & FTF_INFO ) {
-
-		  /* set the info region color */
-		  colorIndex = (( map->tile[offset].bits[byteOff]  >> bit ) & 3 );
-		  color = colors [ (( colorIndex < 3 ) ? colorIndex + 1: noGoColor )];
-
-		} else {
-		  /* set the  region color */
-		  color = ( map->tile[offset].bits[byteOff] & ( 1 << bit )) ?
-		    colors [ noGoColor ] : colors [ GP_DOGO ];
-		}
-		if ( color ) {
-
-		  recX1 = ((rowByte * 8 + bit) * dstInc) / srcInc ;
-		  recX2 = ((rowByte * 8 + bit + srcInc) * dstInc) / srcInc - 1;
-
-		  recY1 = (tileRow*srcInc * dstInc) / srcInc;
-		  recY2 = ((tileRow*srcInc + srcInc) * dstInc / srcInc) - 1;
-
-		  if (( recX1 == recX2 ) && ( recY1 == recY2 ))
-		    plotPoint ( map, col, recX1, recY1, color );
-		  else
-		    drawRectangle ( map,
-				    col, recX1, recY1,
-				    col, recX2, recY2, color );
-		}
-	      }
-	    }
 
+  /* uniform tiles are gathered into runs of the same color, so a run of
+   * NoGo's (or DoGo's in info maps) becomes one span per image row
+   */
+  runCol   = -1;
+  runColor = 0;
+  for ( col = map->win.x0; col <= map->win.x1 + 1; col++ ) {
+    color = -1;
+    if ( col <= map->win.x1 ) {
+      tile = &(map->tile[ row * map->tilesPerRow + col ]);
+      if ( tile->flag == TDT_NOGO )
+	color = colors[ noGoColor ];
+      else if ( tile->flag == TDT_DOGO )
+	color = isInfo ? colors[ GP_INFO0 ] : colors[ GP_DOGO ];
+    }
+
+    /* flush the run when the color changes */
+    if (( runCol >= 0 ) && ( color != runColor )) {
+      if ( runColor )
+	drawRectangle ( map,
+			runCol, 0, 0,
+			col - 1, tileDim - 1, tileDim - 1,
+			runColor );
+      runCol = -1;
+    }
+    if ( color >= 0 ) {
+      if ( runCol < 0 ) {
+	runCol   = col;
+	runColor = color;
       }
+      continue;
     }
+    if ( col <= map->win.x1 ) plotMixedTile ( map, tile, col, noGoColor );
   } /* end col loop */
-} /* end plot8BitRow */
+} /* end plotImageRow */
+
+void
+plotMixedTile ( pathfindingmap *map, tileData *tile, int col, int noGoColor )
+{
+  unsigned char *src;
+  unsigned long long bits;
+  int tileRow;
+  int x, y, y0, begin, len;
+  int color, runColor;
+  int pixPerRow;
+  int dstInc;
+  int mapDim, tileOff;
+  int i;
+
+  /* info pixels cover 1 << level image pixels, map pixels are scaled */
+  dstInc    = ( map->io.type & FTF_INFO ) ? 1 << map->io.level : imageScale ( map );
+  mapDim    = map->res * imageScale ( map );
+  tileOff   = col * TILE_DIM * imageScale ( map );
+  pixPerRow = map->bytesPerRow * (( map->io.type & FTF_INFO ) ? 4 : 8 );
+
+  for ( tileRow = 0; tileRow < map->rowsPerTile; tileRow++ ) {
+    src = &(tile->bits[ tileRow * map->bytesPerRow ]);
+    y0  = tileRow * dstInc;
+
+    if ( !( map->io.type & FTF_INFO ) && ( map->bytesPerRow == ROW_BYTES )) {
+      /* map rows are 64 bits - pull out the runs of NoGo's a word at a time */
+      for ( bits = 0, i = ROW_BYTES - 1; i >= 0; i-- ) bits = ( bits << 8 ) | src[i];
+
+      while ( bits ) {
+	begin = __builtin_ctzll ( bits );
+	len   = ( ~bits >> begin ) ? __builtin_ctzll ( ~bits >> begin ) : TILE_DIM - begin;
+	for ( y = y0; y < y0 + dstInc; y++ )
+	  map->fill ( map->buf,
+		      y * mapDim + tileOff + begin * dstInc,
+		      len * dstInc, colors[ noGoColor ] );
+	bits = ( begin + len < TILE_DIM ) ? ( bits >> ( begin + len )) << ( begin + len ) : 0;
+      }
+      continue;
+    }
+
+    /* everything else is run length encoded a pixel at a time */
+    runColor = -1;
+    begin = 0;
+    for ( x = 0; x <= pixPerRow; x++ ) {
+      if ( x == pixPerRow )
+	color = -1;
+      else if ( map->io.type & FTF_INFO ) {
+	/* set the info region color */
+	color = ( src[ x >> 2 ] >> (( x & 3 ) * 2 )) & 3;
+	color = colors [ (( color < 3 ) ? color + 1 : noGoColor ) ];
+      } else
+	/* set the  region color */
+	color = ( src[ x >> 3 ] & ( 1 << ( x & 7 ))) ? colors[ noGoColor ] : colors[ GP_DOGO ];
+
+      if ( color == runColor ) continue;
+
+      if ( runColor > 0 )
+	for ( y = y0; y < y0 + dstInc; y++ )
+	  map->fill ( map->buf,
+		      y * mapDim + tileOff + begin * dstInc,
+		      ( x - begin ) * dstInc, runColor );
+      runColor = color;
+      begin    = x;
+    }
+  } /* end tileRow loop */
+} /* end plotMixedTile */
+
+void
+initBlitTable ( int mult )
+{
+  unsigned long long mask;
+  int i, k;
+
+  if ( mult == blitMult ) return;
+
+  /* bit i of a tile row byte is pixel i, bitmaps want pixel 0 in bit 7 */
+  for ( i = 0; i < 256; i++ )
+    for ( bitReverse[i] = 0, k = 0; k < 8; k++ )
+      if ( i & ( 1 << k )) bitReverse[i] |= 0x80 >> k;
+
+  /* past 8 pixels per source bit blitMapRow uses whole bytes */
+  blitMult = mult;
+  if ( mult > 8 ) return;
+
+  /* deposit each bit of the reversed byte at the bottom of a mult bit
+   * field and multiply to fill the field - that is 8 * mult bits of
+   * image row, most significant byte first
+   */
+  for ( mask = 0, k = 0; k < 8; k++ ) mask |= 1ULL << ( k * mult );
+  for ( i = 0; i < 256; i++ ) {
+#ifdef __BMI2__
+    blitTable[i] = _pdep_u64 ( bitReverse[i], mask );
+#else
+    for ( blitTable[i] = 0, k = 0; k < 8; k++ )
+      if ( bitReverse[i] & ( 1 << k )) blitTable[i] |= 1ULL << ( k * mult );
+#endif
+    blitTable[i] *= ( mult == 8 ) ? 0xff : ( 1ULL << mult ) - 1;
+  }
+} /* end initBlitTable */
+
+void
+blitMapRow ( pathfindingmap *map, int row )
+{
+  tileData      *tile;
+  unsigned char *src;
+  unsigned char *dst;
+  unsigned char *line;
+  unsigned long long word;
+  int tileBytes, rowBytes;
+  int mult;
+  int col, tileRow;
+  int i, j, k;
+
+  mult      = imageScale ( map );
+  tileBytes = ROW_BYTES * mult;
+  rowBytes  = map->tilesPerRow * tileBytes;
+
+  for ( tileRow = 0; tileRow < map->rowsPerTile; tileRow++ ) {
+    line = &(map->buf[ tileRow * mult * rowBytes ]);
+
+    for ( col = map->win.x0, dst = line + col * tileBytes;
+	  col <= map->win.x1; col++, dst += tileBytes ) {
+      tile = &(map->tile[ row * map->tilesPerRow + col ]);
+
+      /* uniform tiles are whole words of 0's or 1's */
+      if ( tile->flag != TDT_MIXED ) {
+	memset ( dst, ( tile->flag == TDT_NOGO ) ? 0xff : 0, tileBytes );
+	continue;
+      }
+
+      src = &(tile->bits[ tileRow * ROW_BYTES ]);
+      if ( mult == 1 ) {
+	for ( i = 0; i < ROW_BYTES; i++ ) dst[i] = bitReverse[ src[i] ];
+      } else if ( mult <= 8 ) {
+	for ( i = 0; i < ROW_BYTES; i++ ) {
+	  word = blitTable[ src[i] ];
+	  for ( j = 0; j < mult; j++ )
+	    dst[ i * mult + j ] = (unsigned char) ( word >> ( 8 * ( mult - j - 1 )));
+	}
+      } else {
+	for ( i = 0; i < ROW_BYTES; i++ )
+	  for ( k = 0; k < 8; k++ )
+	    memset ( &(dst[ ( i * 8 + k ) * mult / 8 ]),
+		     ( src[i] & ( 1 << k )) ? 0xff : 0, mult / 8 );
+      }
+    } /* end col loop */
+
+    /* scaled up levels repeat the row */
+    for ( i = 1; i < mult; i++ ) memcpy ( &(line[ i * rowBytes ]), line, rowBytes );
+  } /* end tileRow loop */
+} /* end blitMapRow */
 
 void
 prepImageBuf ( pathfindingmap *map, int row )
@@ -428,7 +1200,7 @@ prepImageBuf ( pathfindingmap *map, int row )
   if (!( map->io.type & ( FTF_GRID | FTF_NUMBERS )) ||
       ( map->io.type & FTF_MAP )) return;
 
-  for ( col = 0; col < map->tilesPerRow; col++ ) {
+  for ( col = map->win.x0; col <= map->win.x1; col++ ) {
     addGrid = ((( row & 1 ) && ( col & 1 )) || (!( row & 1 ) && !(col & 1 )));
 
     if ( map->io.type & FTF_GRID ) {
@@ -486,39 +1258,27 @@ void
 plotSmallOnesRow ( pathfindingmap *map, int row )
 {
   smallOnesData *small;
-  smallOnesData *target;
+  lineSegment   *seg;
   int offset;
-  int i, j;
+  int i, size;
   int col;
 
+  /* links are gathered once for the whole map */
+  if ( !map->lines ) buildSmallOnesLines ( map );
+
+  /* draw every line crossing this row of tiles */
+  for ( i = map->lines->start[row]; i < map->lines->start[row + 1]; i++ ) {
+    seg = &(map->lines->seg[ map->lines->index[i] ]);
+    drawLine ( map, row, seg->x1, seg->y1, seg->x2, seg->y2, seg->color );
+  }
 
-  /* step thru tiles */
-  for ( col=0; col < map->tilesPerRow; col++ ) {
+  /* step thru tiles - points go on top of the lines */
+  for ( col = map->win.x0; col <= map->win.x1; col++ ) {
 
     offset = row * map->tilesPerRow + col;
     small = &(map->so[offset]);
 
-    /* i have no idea what these fields are for - mark them anyway */
-    if (small->na1 > 0 ) {
-      drawLine ( map,
-		 col, 0, 0,
-		 col, TILE_DIM - 1, TILE_DIM - 1,
-		 colors[ GP_SPECIAL ] );
-      drawLine ( map,
-		 col, TILE_DIM - 1, 0,
-		 col, 0, TILE_DIM - 1,
-		 colors[ GP_SPECIAL ] );
-    }
-    if (small->na2 > 0 ) {
-      drawLine ( map,
-		 col, 31, 0,
-		 col, 31, TILE_DIM - 1,
-		 colors[ GP_SPECIAL ] );
-      drawLine ( map,
-		 col, 0, 31,
-		 col, TILE_DIM - 1, 31,
-		 colors[ GP_SPECIAL ] );
-    }
+    /* i have no idea what this field is for - mark it anyway */
     if (small->na3 > 0 ) {
       drawRectangle ( map,
 		      col, 24, 24,
@@ -531,69 +1291,149 @@ plotSmallOnesRow ( pathfindingmap *map, int row )
       /* if not set, break now */
       if (( small->active & ( 1 << ( i + 4 ))) == 0 ) continue;
 
-      if ( map->io.type & FTF_LINES ) {
-	/* connect the dots with lines */
-	if ( row > 0 ) {
-	  /* check previous row for a connection */
-	  target = &(map->so[offset-map->tilesPerRow]);
-	  for ( j = 0; j < 4; j++ ) {
-	    /* if not set, break now */
-	    if ( target->hasLower & ( 1 << ( j * 4 + i ))) {
-	      drawLine ( map,
-			 col, small->pt[i][0], small->pt[i][1],
-			 col-map->tilesPerRow, target->pt[j][0], target->pt[j][1],
-			 colors[GP_LEVEL0_LINE + j] );
-	    }
-	  }
+      size = (( small->pt[i][0] >= TILE_DIM ) && ( small->pt[i][1] >= TILE_DIM )) ? 2 : 1;
+      drawRectangle ( map,
+		      col,
+		      MAX( small->pt[i][0]%TILE_DIM - size, 0 ),
+		      MAX( small->pt[i][1]%TILE_DIM - size, 0 ),
+		      col,
+		      MIN( small->pt[i][0]%TILE_DIM + size, TILE_DIM - 1 ),
+		      MIN( small->pt[i][1]%TILE_DIM + size, TILE_DIM - 1 ),
+		      colors[ GP_LEVEL0_PT + i] );
+    }
+  }
+} /* end plotSmallOnesRow */
+
+void
+buildSmallOnesLines ( pathfindingmap *map )
+{
+  segmentBins   *bins;
+  smallOnesData *small;
+  smallOnesData *target;
+  lineSegment   *seg;
+  int pass;
+  int count;
+  int offset;
+  int row, col;
+  int x, y;
+  int i, j;
+
+  if ( !map || !map->so )
+    shutdown ( EF_DATA_MISSING, "Function buildSmallOnesLines passed bad map\n" );
+
+  if ( !( bins = (segmentBins *) calloc ( sizeof ( segmentBins ), 1 )) ||
+       !( bins->start = (int *) calloc ( sizeof ( int ), map->tilesPerCol + 1 )))
+    shutdown ( EF_MALLOC, "Error creating smallOnes line bins\n" );
+  bins->rows = map->tilesPerCol;
+
+  /* first pass counts the segments, second one fills them in. each link is
+   * only taken from the tile above or to the left of it
+   */
+  for ( pass = 0; pass < 2; pass++ ) {
+    count = 0;
+    seg   = bins->seg;
+
+    for ( row = 0; row < map->tilesPerCol; row++ ) {
+      for ( col = 0; col < map->tilesPerRow; col++ ) {
+	offset = row * map->tilesPerRow + col;
+	small  = &(map->so[offset]);
+	x = col * TILE_DIM;
+	y = row * TILE_DIM;
+
+	/* i have no idea what these fields are for - mark them anyway */
+	if ( small->na1 > 0 ) {
+	  addLineSegment ( &seg, &count, x, y, x + TILE_DIM - 1, y + TILE_DIM - 1,
+			   colors[ GP_SPECIAL ] );
+	  addLineSegment ( &seg, &count, x + TILE_DIM - 1, y, x, y + TILE_DIM - 1,
+			   colors[ GP_SPECIAL ] );
 	}
-	if ( col < map->tilesPerRow - 1 ) {
-	  /* check this row for connection */
-	  target = &(map->so[offset+1]);
-	  for ( j = 0; j < 4; j++ ) {
-	    /* if not set, break now */
-	    if ( small->hasRight & ( 1 << ( i * 4 + j ))) {
-	      drawLine ( map,
-			 col, small->pt[i][0], small->pt[i][1],
-			 col+1, target->pt[j][0], target->pt[j][1],
-			 colors[GP_LEVEL0_LINE + i] );
-	    }
-	  }
+	if ( small->na2 > 0 ) {
+	  addLineSegment ( &seg, &count, x + 31, y, x + 31, y + TILE_DIM - 1,
+			   colors[ GP_SPECIAL ] );
+	  addLineSegment ( &seg, &count, x, y + 31, x + TILE_DIM - 1, y + 31,
+			   colors[ GP_SPECIAL ] );
 	}
-	if ( row < map->tilesPerRow - 1 ) {
-	  /* check next row for a connection */
-	  target = &(map->so[offset+map->tilesPerRow]);
+
+	if ( !( map->io.type & FTF_LINES )) continue;
+
+	for ( i = 0; i < 4; i++ ) {
+	  if (( small->active & ( 1 << ( i + 4 ))) == 0 ) continue;
+
 	  for ( j = 0; j < 4; j++ ) {
-	    /* if not set, break now */
-	    if ( small->hasLower & ( 1 << ( i * 4 + j ))) {
-	      drawLine ( map,
-			 col, small->pt[i][0], small->pt[i][1],
-			 col+map->tilesPerRow, target->pt[j][0], target->pt[j][1],
-			 colors[GP_LEVEL0_LINE + i] );
+	    /* connect to the tile on the right */
+	    if (( col < map->tilesPerRow - 1 ) && ( small->hasRight & ( 1 << ( i * 4 + j )))) {
+	      target = &(map->so[offset + 1]);
+	      addLineSegment ( &seg, &count,
+			       x + small->pt[i][0] % TILE_DIM,
+			       y + small->pt[i][1] % TILE_DIM,
+			       x + TILE_DIM + target->pt[j][0] % TILE_DIM,
+			       y + target->pt[j][1] % TILE_DIM,
+			       colors[ GP_LEVEL0_LINE + i ] );
+	    }
+	    /* and the one below */
+	    if (( row < map->tilesPerCol - 1 ) && ( small->hasLower & ( 1 << ( i * 4 + j )))) {
+	      target = &(map->so[offset + map->tilesPerRow]);
+	      addLineSegment ( &seg, &count,
+			       x + small->pt[i][0] % TILE_DIM,
+			       y + small->pt[i][1] % TILE_DIM,
+			       x + target->pt[j][0] % TILE_DIM,
+			       y + TILE_DIM + target->pt[j][1] % TILE_DIM,
+			       colors[ GP_LEVEL0_LINE + i ] );
 	    }
 	  }
 	}
-      }
-      if (( small->pt[i][0] >= TILE_DIM ) && ( small->pt[i][1] >= TILE_DIM ))
-	drawRectangle ( map,
-			col,
-			MAX( small->pt[i][0]%TILE_DIM - 2, 0 ),
-			MAX( small->pt[i][1]%TILE_DIM - 2, 0 ),
-			col,
-			MIN( small->pt[i][0]%TILE_DIM + 2, TILE_DIM - 1 ),
-			MIN( small->pt[i][1]%TILE_DIM + 2, TILE_DIM - 1 ),
-			colors[ GP_LEVEL0_PT + i] );
-      else
-	drawRectangle ( map,
-			col,
-			MAX( small->pt[i][0]%TILE_DIM - 1, 0 ),
-			MAX( small->pt[i][1]%TILE_DIM - 1, 0 ),
-			col,
-			MIN( small->pt[i][0]%TILE_DIM + 1, TILE_DIM - 1 ),
-			MIN( small->pt[i][1]%TILE_DIM + 1, TILE_DIM - 1 ),
-			colors[ GP_LEVEL0_PT + i ] );
+      } /* end col loop */
+    } /* end row loop */
+
+    if ( pass ) break;
+
+    bins->segments = count;
+    if ( count && !( bins->seg = (lineSegment *) malloc ( sizeof ( lineSegment ) * count )))
+      shutdown ( EF_MALLOC, "Error creating smallOnes line segments\n" );
+  }
+
+  /* bin segments by each tile row they cross */
+  for ( i = 0; i < bins->segments; i++ ) {
+    seg = &(bins->seg[i]);
+    for ( row = MIN( seg->y1, seg->y2 ) / TILE_DIM; row <= MAX( seg->y1, seg->y2 ) / TILE_DIM; row++ )
+      bins->start[ row + 1 ]++;
+  }
+  for ( row = 0; row < bins->rows; row++ ) bins->start[ row + 1 ] += bins->start[ row ];
+
+  if ( bins->start[ bins->rows ] &&
+       !( bins->index = (int *) malloc ( sizeof ( int ) * bins->start[ bins->rows ] )))
+    shutdown ( EF_MALLOC, "Error creating smallOnes line bins\n" );
+
+  for ( i = 0; i < bins->segments; i++ ) {
+    seg = &(bins->seg[i]);
+    for ( row = MIN( seg->y1, seg->y2 ) / TILE_DIM; row <= MAX( seg->y1, seg->y2 ) / TILE_DIM; row++ )
+      bins->index[ bins->start[row]++ ] = i;
+  }
+  /* filling moved each start to the next row's - shift them back */
+  for ( row = bins->rows; row > 0; row-- ) bins->start[row] = bins->start[row - 1];
+  bins->start[0] = 0;
+
+  map->lines = bins;
+} /* end buildSmallOnesLines */
+
+void
+addLineSegment ( lineSegment **seg, int *count, int x1, int y1, int x2, int y2, int color )
+{
+  /* counting pass - no segment array yet */
+  if ( *seg ) {
+    /* keep the top end first */
+    if ( y2 < y1 ) {
+      (*seg)->x1 = x2; (*seg)->y1 = y2;
+      (*seg)->x2 = x1; (*seg)->y2 = y1;
+    } else {
+      (*seg)->x1 = x1; (*seg)->y1 = y1;
+      (*seg)->x2 = x2; (*seg)->y2 = y2;
     }
+    (*seg)->color = color;
+    (*seg)++;
   }
-}
+  (*count)++;
+} /* end addLineSegment */
 
 void
 plotPoint ( pathfindingmap *map, int tile, int col, int row, int value )
@@ -606,7 +1446,7 @@ plotPoint ( pathfindingmap *map, int tile, int col, int row, int value )
   if ( !map )
     shutdown ( EF_PASSED_NULL, "plotPoint passed NULL pointer to buffer\n" );
 
-  mult = ( 1 << map->io.level );
+  mult = imageScale ( map );
   tileDim = TILE_DIM * mult;
   mapDim = map->res * mult;
   /* calc offset into buffer */
@@ -637,7 +1477,7 @@ drawRectangle ( pathfindingmap *map,
   if ( !map || !map->buf )
     shutdown ( EF_PASSED_NULL, "plotRectangle passed NULL pointer to image\n" );
 
-  mult = ( map->io.type & FTF_INFO ) ? 1 : (1 << map->io.level);
+  mult = imageScale ( map );
   tileDim = TILE_DIM * mult;
   mapRes = map->res * mult;
   bufSize = mapRes * tileDim;
@@ -660,102 +1500,72 @@ drawRectangle ( pathfindingmap *map,
     shutdown ( EF_MEM_OVERRUN, "drawRectangle tried to write past buffer boundry\n" );
 
 
+  if ( !map->fill ) setSpanFill ( map );
+
+  /* one span per row */
+  j = (tile1 * tileDim) + col1;
   for ( i = row1; i <= row2; i++ )
-    for ( j = (tile1 * tileDim) + col1; j <= (tile2 * tileDim) + col2; j++ )
-      setRowPixel ( map, i * mapRes + j, value );
+    map->fill ( map->buf, i * mapRes + j, (tile2 * tileDim) + col2 - j + 1, value );
 
 } /* end drawRectangle */
 
 void
-drawLine ( pathfindingmap *map,
-	   int tile1, int col1, int row1,
-	   int tile2, int col2, int row2,
+drawLine ( pathfindingmap *map, int row,
+	   int x1, int y1,
+	   int x2, int y2,
 	   int value )
 {
-  int i, j;
-  int c1, c2;
-  int cb, ce;
-  int rb, re;
-  int cd, rd;
-  int rise, run;
+  int dx, dy;
+  int sx;
+  int err, e2;
+  int top, bottom;
+  int mapDim;
 
   if ( !map || !map->buf )
     shutdown ( EF_PASSED_NULL, "drawLine: passed NULL pointer to buffer\n" );
 
-  if (( tile1 < 0 ) || ( tile1 >= map->tilesPerRow ))
-    shutdown ( EF_MEM_OVERRUN, "drawLine: tile out of range\n");
+  if ( !map->fill ) setSpanFill ( map );
 
-  /* this is only a guess, but some tiles are out of range for some strange reason */
-  col1 %= TILE_DIM;
-  col2 %= TILE_DIM;
-  row1 %= TILE_DIM;
-  row2 %= TILE_DIM;
+  mapDim = map->res * imageScale ( map );
+  top    = row * TILE_DIM;
+  bottom = top + TILE_DIM - 1;
 
-  if ( tile2 < 0 ) {
-    tile2 += map->tilesPerRow;
-    row2 -= TILE_DIM;
-  } else if ( tile2 >= map->tilesPerRow ) {
-    tile2 -= map->tilesPerRow;
-    row2 += TILE_DIM;
+  /* map space points - the same pixels come out whichever row is drawn */
+  if ( y2 < y1 ) {
+    dx = x1; x1 = x2; x2 = dx;
+    dy = y1; y1 = y2; y2 = dy;
   }
+  if (( y2 < top ) || ( y1 > bottom )) return;
 
-  c1 = tile1 * TILE_DIM + col1;
-  c2 = tile2 * TILE_DIM + col2;
-  cd = ( c1 < c2 ) ? 1 : -1;
-  rd = ( row1 < row2 ) ? 1 : -1;
-
-  rise = row2 - row1;
-  run = c2 - c1;
-
-  cb = ce = rb = re = 0;
-
-  if ( ABS(run) > ABS(rise) ) {
-    for ( i = row1; i * rd <= row2 * rd; i += rd ) {
+  dx  = ABS( x2 - x1 );
+  dy  = -( y2 - y1 );
+  sx  = ( x1 < x2 ) ? 1 : -1;
+  err = dx + dy;
 
-      /* make sure we're still in the buffer */
-      if ((  i < 0 ) || ( i >= TILE_DIM )) break;
+  while ( y1 <= bottom ) {
+    /* clip to the row of tiles */
+    if (( y1 >= top ) && ( x1 >= 0 ) && ( x1 < mapDim ))
+      map->fill ( map->buf, ( y1 - top ) * mapDim + x1, 1, value );
 
-      /* FIXME: this has got to be wrong... */
-      if ( rise ) {
-	ce = ( 2 * (i - row1) + rd) * run / (2 * rise);
-	if (( 2 * ( i - row1 ) + rd ) * run > 2 * rise ) ce += cd;
-      } else ce = run;
+    if (( x1 == x2 ) && ( y1 == y2 )) break;
 
-      for ( j = cb; j*cd <= ce*cd; j += cd ) {
-	if (( j + c1 ) * cd > ( c2 * cd )) {
-	  i = row2;
-	  break;
-	}
-	setRowPixel ( map, i * map->res + c1 + j, value );
-      }
-
-      cb = ce;
+    e2 = 2 * err;
+    if ( e2 >= dy ) {
+      err += dy;
+      x1  += sx;
     }
-  } else {
-    for ( i = c1; i * cd <= c2 * cd; i += cd ) {
-
-      if ( run ) {
-	re = ( 2 * ( i - c1 ) + cd ) * rise / ( 2 * run );
-	if (( 2 * (i - c1) + cd ) * rise > 2 * run ) re += rd;
-      } else re = rise;
-
-      for ( j = rb; j*rd <= re*rd; j += rd ) {
-	/* make sure we're still in the buffer */
-	if (( row1 + j < 0 ) || ( row1 + j >= TILE_DIM )) {
-	  i = c2;
-	  break;
-	}
-	setRowPixel ( map, (row1 + j) * map->res + i, value );
-      }
-      rb = re;
+    if ( e2 <= dx ) {
+      err += dx;
+      y1++;
     }
   }
-} /*end drawLine */
+} /* end drawLine */
 
 void
-readPixels ( pathfindingmap *map, int inBits )
+readPixels ( pathfindingmap *map, int inBits, int compression )
 {
   unsigned char tileBuf[TILE_BYTES];
+  rleStream rle = { 0 };
   int i, j, k;
   int tileRow, tileCol;
   int hasNoGo, hasDoGo;
@@ -763,19 +1573,35 @@ readPixels ( pathfindingmap *map, int inBits )
   int curTile;
   int bufSize;
   int bufRowBytes;
+  int width, height;
   int curPix;
   int curByte;
   int mask;
   int *p;
 
-  /* how many TILE_DIM (64 byte) blocks per row */
-  map->tilesPerCol = map->tilesPerRow = map->res / TILE_DIM;
-  map->tiles = map->tilesPerRow * map->tilesPerCol;
-  map->rowsPerTile = TILE_DIM;
-  map->bytesPerRow = TILE_DIM / 8;
-  map->bytesPerTile = TILE_DIM * TILE_DIM / 8;
+  /* patches already have a map to go into */
+  if ( !map->tile ) {
+    /* how many TILE_DIM (64 byte) blocks per row */
+    map->tilesPerCol = map->tilesPerRow = map->res / TILE_DIM;
+    map->tiles = map->tilesPerRow * map->tilesPerCol;
+    map->rowsPerTile = TILE_DIM;
+    map->bytesPerRow = TILE_DIM / 8;
+    map->bytesPerTile = TILE_DIM * TILE_DIM / 8;
+    map->win.x0 = map->win.y0 = 0;
+    map->win.x1 = map->tilesPerRow - 1;
+    map->win.y1 = map->tilesPerCol - 1;
+
+    /* create tile data record array */
+    if ( !( map->tile = (tileData *) calloc ( sizeof (tileData) * map->tiles, 1 )))
+      shutdown ( EF_MALLOC,
+		 "Error creating %s tile data array buffer for.\n",
+		 baseName[map->io.vehicle] );
+  }
+
+  width  = WIN_COLS ( map ) * TILE_DIM;
+  height = WIN_ROWS ( map ) * TILE_DIM;
 
-  bufRowBytes = ( map->res * inBits ) >> 3;
+  bufRowBytes = ( width * inBits ) >> 3;
   bufSize = ( bufRowBytes ) * TILE_DIM;
 
   /* create input buffer - image width x tilement length */
@@ -784,16 +1610,33 @@ readPixels ( pathfindingmap *map, int inBits )
 	       "Error creating %s input image buffer for.\n",
 	       baseName[map->io.vehicle] );
 
-  /* create tile data record array */
-  if ( !( map->tile = (tileData *) calloc ( sizeof (tileData) * map->tiles, 1 )))
-    shutdown ( EF_MALLOC,
-	       "Error creating %s tile data array buffer for.\n",
-	       baseName[map->io.vehicle] );
+  /* run length encoded images are small - read them in whole and
+   * unpack a row of tiles at a time
+   */
+  if ( compression && ( compression != BI_PNG )) {
+    rle.size = fileSize ( map ) - ftell ( map->fp );
+    if ( !( rle.data = (unsigned char *) loadBuffer ( rle.size )))
+      shutdown ( EF_MALLOC,
+		 "Error creating %s input image buffer for.\n",
+		 baseName[map->io.vehicle] );
+    if (( rle.size > 0 ) && !fread ( rle.data, rle.size, 1, map->fp ))
+      shutdown ( EF_FILE_READ,
+		 "Error reading from %s input image file.\n",
+		 baseName[map->io.vehicle] );
+    setSpanFill ( map );
+  }
 
   /* loop thru each row of tiles */
-  for ( tileRow = 0; tileRow < map->tilesPerCol; tileRow++ ) {
+  for ( tileRow = 0; tileRow < WIN_ROWS ( map ); tileRow++ ) {
     /* read map->tilePerRow tiles into buf */
-    if ( !fread ( map->buf, bufSize, 1, map->fp ))
+    if ( compression == BI_PNG )
+      /* png rows are top down */
+      for ( i = 0; i < TILE_DIM; i++ )
+	memcpy ( map->buf + i * bufRowBytes,
+		 map->bmp + ( height - 1 - tileRow * TILE_DIM - i ) * ( bufRowBytes + 1 ) + 1,
+		 bufRowBytes );
+    else if ( compression ) rleDecodeBand ( map, &rle, width, TILE_DIM );
+    else if ( !fread ( map->buf, bufSize, 1, map->fp ))
       shutdown ( EF_FILE_READ,
 		 "Error reading from %s input image file.\n",
 		 baseName[map->io.vehicle] );
@@ -807,8 +1650,12 @@ readPixels ( pathfindingmap *map, int inBits )
       }
     }
     /* scan input buffer one tile at a time */
-    for ( tileCol = 0; tileCol < map->tilesPerRow; tileCol++ ) {
-      curTile = tileRow * map->tilesPerCol + tileCol;
+    for ( tileCol = 0; tileCol < WIN_COLS ( map ); tileCol++ ) {
+      curTile = ( map->win.y0 + tileRow ) * map->tilesPerRow + map->win.x0 + tileCol;
+
+      /* patched tiles replace what was there */
+      free ( map->tile[curTile].bits );
+      map->tile[curTile].bits = NULL;
 
       /* zero the buffer */
       memset ( tileBuf, 0, TILE_BYTES );
@@ -822,11 +1669,12 @@ readPixels ( pathfindingmap *map, int inBits )
 	for ( j = 0; j < ROW_BYTES; j++ ) {
 
 	  byteOff = i * map->bytesPerRow + j;
-	  curPix = i * map->res + tileCol * TILE_DIM + j * 8;
+	  curPix = i * width + tileCol * TILE_DIM + j * 8;
 
 	  for ( k = 0; k < 8; k++ ) { /* check each pixel */
 	    curByte = (( curPix + k ) * inBits ) / 8;
-	    mask = (( 1 << inBits ) - 1) << ( inBits * (( 7 - k ) / inBits ));
+	    mask = (( 1 << inBits ) - 1) <<
+	      ( inBits * ( 8 / inBits - 1 - ( curPix + k ) % ( 8 / inBits )));
 	    if ( map->buf[ curByte ] & mask ) {
 	      hasNoGo = TRUE;
 	      tileBuf[ byteOff ] |= ( 1 << k );
@@ -853,6 +1701,9 @@ readPixels ( pathfindingmap *map, int inBits )
   } /* end for tileRow loop */
 
   /* clean up a little */
+  freeLoadBuffer ( rle.data );
+  free ( map->bmp );
+  map->bmp = NULL;
   free ( map->buf );
   map->buf = NULL;
 }
@@ -860,23 +1711,82 @@ readPixels ( pathfindingmap *map, int inBits )
 void
 setRowPixel ( pathfindingmap *map, int offset, int value )
 {
-  int byteOff;
-  int bitOff;
-  int pixPerByte;
-  int mask;
+  if ( !map->fill ) setSpanFill ( map );
+  map->fill ( map->buf, offset, 1, value );
+}
 
-  if ( map->io.bits == 8 ) map->buf[offset] = value;
-  else {
-    byteOff = (offset * map->io.bits ) / 8;
-    pixPerByte = 8 / map->io.bits;
-    bitOff = ( map->io.type & FTF_RAW ) ?
-      ( offset % pixPerByte ) : pixPerByte - ( offset % pixPerByte ) - 1;
-    mask = ((( 1 << map->io.bits ) - 1) << ( bitOff * map->io.bits ));
-    map->buf[byteOff] &= ~mask;
-    map->buf[byteOff] |= ( value << ( bitOff * map->io.bits ));
-  }
+/* span fills are specialized for each bit depth and pixel order. RAW
+ * images pack the first pixel into the low bits of a byte, bitmaps into
+ * the high bits. whole bytes in the span are set with memset.
+ */
+#define SPAN_FILL(name, bits, lowFirst)					\
+static void								\
+name ( unsigned char *buf, int offset, int count, int value )		\
+{									\
+  unsigned char *p;							\
+  unsigned char full;							\
+  int pix, num;								\
+  int mask;								\
+									\
+  p    = buf + offset / ( 8 / (bits) );					\
+  pix  = offset % ( 8 / (bits) );					\
+  full = ( value & (( 1 << (bits) ) - 1 )) * ( 0xff / (( 1 << (bits) ) - 1 )); \
+									\
+  /* leading partial byte */						\
+  if ( pix ) {								\
+    num  = MIN ( count, 8 / (bits) - pix );				\
+    mask = (( 1 << ( num * (bits) )) - 1 ) <<				\
+      (( lowFirst ) ? pix * (bits) : ( 8 / (bits) - pix - num ) * (bits) ); \
+    *p   = ( *p & ~mask ) | ( full & mask );				\
+    p++;								\
+    count -= num;							\
+  }									\
+  /* whole bytes */							\
+  if ( count >= 8 / (bits) ) {						\
+    memset ( p, full, count / ( 8 / (bits) ));				\
+    p     += count / ( 8 / (bits) );					\
+    count %= 8 / (bits);						\
+  }									\
+  /* trailing partial byte */						\
+  if ( count ) {							\
+    mask = (( 1 << ( count * (bits) )) - 1 ) <<				\
+      (( lowFirst ) ? 0 : 8 - count * (bits) );				\
+    *p   = ( *p & ~mask ) | ( full & mask );				\
+  }									\
+}
+
+SPAN_FILL ( fillSpan1Raw, 1, TRUE  )
+SPAN_FILL ( fillSpan1Bmp, 1, FALSE )
+SPAN_FILL ( fillSpan4Raw, 4, TRUE  )
+SPAN_FILL ( fillSpan4Bmp, 4, FALSE )
+
+static void
+fillSpan8 ( unsigned char *buf, int offset, int count, int value )
+{
+  memset ( &(buf[offset]), value, count );
 }
 
+void
+setSpanFill ( pathfindingmap *map )
+{
+  switch ( map->io.bits )
+    {
+    case 1:
+      map->fill = ( map->io.type & FTF_RAW ) ? fillSpan1Raw : fillSpan1Bmp;
+      break;
+    case 4:
+      map->fill = ( map->io.type & FTF_RAW ) ? fillSpan4Raw : fillSpan4Bmp;
+      break;
+    case 8:
+      map->fill = fillSpan8;
+      break;
+    default:
+      shutdown ( EF_NOT_SUPPORTED,
+		 "No span fill for %d bit %s image\n",
+		 map->io.bits, baseName[map->io.vehicle] );
+    }
+} /* end setSpanFill */
+
 void
 fillColorMap ( pathfindingmap *map, rgbQuad *bmpColors )
 {
@@ -28,31 +28,123 @@
 
 /************************************  includes              ************************/
 
+#ifdef IS_UNIX
+  #include <pthread.h>
+  #include <setjmp.h>
+#endif
+
 /************************************  macros                 ***********************/
 
 #define NUM_OFF_X 2
 #define NUM_OFF_Y 2
 
+/* tiles across and down the window being worked on */
+#define WIN_COLS(m) ( (m)->win.x1 - (m)->win.x0 + 1 )
+#define WIN_ROWS(m) ( (m)->win.y1 - (m)->win.y0 + 1 )
+#define IN_WINDOW(m,col,row) \
+  ( INRANGE ( (col), (m)->win.x0, (m)->win.x1 ) && INRANGE ( (row), (m)->win.y0, (m)->win.y1 ))
+
+/* memory allowed for the ring of image bands being rendered */
+#define BAND_RING_BYTES ( 64 * 1024 * 1024 )
+
 
 /************************************  structures and enums  ************************/
+
+/* run length encoded bitmap data being read back a band at a time */
+typedef struct _rleStream
+{
+  unsigned char  *data;
+  int             size;
+  int             pos;
+  int             x;
+  int             y;
+} rleStream;
+
+#ifdef IS_UNIX
+/* what a render thread takes over from the thread that started it - the
+ * run and the image state are kept per thread
+ */
+typedef struct _renderState
+{
+  userData       data;
+  unsigned char  colors[16];
+  int            blitMult;
+} renderState;
+
+/* rows of tiles are rendered into a ring of map copies by the worker
+ * threads and written out in order by the thread that made the queue
+ */
+typedef struct _bandQueue
+{
+  renderState      state;
+  pthread_mutex_t  lock;
+  pthread_cond_t   cond;
+  pathfindingmap  *band;
+  int             *done;
+  int              slots;
+  int              rows;
+  int              nextRow;
+  int              written;
+  int              err;
+  char             error[ BUF_SIZE ];
+} bandQueue;
+#endif
+
 /************************************  prototypes             ***********************/
 
 void loadImage        ( pathfindingmap *map );
-void loadBmpHeader    ( pathfindingmap *map );
+int  loadBmpHeader    ( pathfindingmap *map );
 void writeImageFile   ( pathfindingmap *map );
 void writeBmpHeader   ( pathfindingmap *map );
+void writeBmpHeaderDim ( pathfindingmap *map, FILE *fp, int width, int height );
+void setImageColors   ( pathfindingmap *map );
+int  imageScale       ( pathfindingmap *map );
+int  imageWidth       ( pathfindingmap *map );
+int  imageHeight      ( pathfindingmap *map );
+void setImageWindow   ( pathfindingmap *map );
+int  isWindowLoad     ( pathfindingmap *map );
+int  isImageDim       ( pathfindingmap *map, int width, int height );
+int  isBlitImage      ( pathfindingmap *map );
+int  isRleImage       ( pathfindingmap *map );
+int  isPngImage       ( pathfindingmap *map );
+int  isThumbImage     ( pathfindingmap *map );
+int  imageBandRow     ( pathfindingmap *map, int n );
+rgbQuad *imagePalette ( pathfindingmap *map, rgbQuad *gray );
+void renderBand       ( pathfindingmap *map, int row );
+void renderTile       ( pathfindingmap *map, int col, int row );
+void plotBand         ( pathfindingmap *map, int row );
+void writeImageBand   ( pathfindingmap *map, unsigned char *buf, int size );
+int  cropImageBand    ( pathfindingmap *map, unsigned char *buf, int size );
+void writeRleBand     ( pathfindingmap *map, unsigned char *buf, int size );
+void finishRleImage   ( pathfindingmap *map );
+int  rleEncodeRow     ( unsigned char *src, int width, int bits, unsigned char *dst );
+void rleDecodeBand    ( pathfindingmap *map, rleStream *rle, int width, int rows );
+#ifdef IS_UNIX
+void writeBandsThreaded ( pathfindingmap *map, int bufSize );
+void *renderBands     ( void *arg );
+void saveRenderState  ( renderState *state );
+void loadRenderState  ( renderState *state );
+#endif
+void renderRecover    ( int err );
 void plotImageRow     ( pathfindingmap *map, int row );
+void plotMixedTile    ( pathfindingmap *map, tileData *tile, int col, int noGoColor );
 void prepImageBuf     ( pathfindingmap *map, int row );
+void initBlitTable    ( int mult );
+void blitMapRow       ( pathfindingmap *map, int row );
 void plotSmallOnesRow ( pathfindingmap *map, int row );
+void buildSmallOnesLines ( pathfindingmap *map );
+void addLineSegment   ( lineSegment **seg, int *count,
+			int x1, int y1, int x2, int y2, int color );
 void plotPoint        ( pathfindingmap *map, int tile, int col, int row, int value );
 void drawRectangle    ( pathfindingmap *map, 
 			int tile1, int col1, int row1,
 			int tile2, int col2, int row2, int value );
-void drawLine         ( pathfindingmap *map,
-			int tile1, int col1, int row1,
-			int tile2, int col2, int row2, int value );
-void readPixels       ( pathfindingmap *map, int inBits );
+void drawLine         ( pathfindingmap *map, int row,
+			int x1, int y1,
+			int x2, int y2, int value );
+void readPixels       ( pathfindingmap *map, int inBits, int compression );
 void setRowPixel      ( pathfindingmap *map, int offset, int value );
+void setSpanFill      ( pathfindingmap *map );
 void fillColorMap     ( pathfindingmap *map, rgbQuad *bmpColors );
 
 #endif /* __IMAGE_H__ */
@@ -0,0 +1,497 @@
+/* islands.c - smallOnes areas that connect to nothing
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* the smallOnes points of a map and the hasLower and hasRight links
+ * between them make one graph. its connected parts are found with a
+ * union-find over every point of the map - node tile * 4 + point - and
+ * numbered biggest first. those are the islands HAS_ISLANDS is about.
+ *
+ * with -k or -K the islands that are too small, or that no spawn point
+ * (-s) is in, are dropped before the smallOnes are written or used for
+ * the info map. the points left in a tile are moved down so they start at
+ * 0 again, and the links follow them.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "smallones.h"
+#include "textfile.h"
+#include "islands.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern THREAD_LOCAL userData data;
+
+/************************************  prototypes             ***********************/
+
+static int   findRoot      ( int *parent, int node );
+static void  joinNodes     ( islandData *isl, int a, int b );
+static void  linkNodes     ( pathfindingmap *soMap, islandData *isl );
+static int   cmpIslands    ( const void *a, const void *b );
+static void  numberIslands ( pathfindingmap *soMap, islandData *isl );
+static int   linkedNode    ( pathfindingmap *soMap, int *id, int node, int j );
+static int   spawnNode     ( pathfindingmap *soMap, int x, int y );
+static void  writeIslands  ( pathfindingmap *soMap, islandData *isl );
+static void  writeGraph    ( pathfindingmap *soMap, islandData *isl );
+static int   pruneIslands  ( pathfindingmap *soMap, islandData *isl );
+
+/************************************  functions             ************************/
+
+void
+findIslands ( pathfindingmap *soMap )
+{
+  islandData isl;
+  int nodes;
+  int node;
+  int i;
+  int dropped;
+
+  if ( !data.islands && !data.minIsland ) return;
+  if ( !soMap || !soMap->so )
+    shutdown ( EF_INFO_MISSING, "Function findIslands passed a map with no smallOnes\n" );
+
+  memset ( &isl, 0, sizeof ( islandData ));
+  nodes = soMap->tiles * 4;
+  if ( !( isl.parent = (int *) malloc ( sizeof ( int ) * nodes )) ||
+       !( isl.points = (int *) calloc ( sizeof ( int ), nodes )) ||
+       !( isl.number = (int *) malloc ( sizeof ( int ) * nodes )))
+    shutdown ( EF_MALLOC, "Memory allocation error finding smallOnes islands\n" );
+
+  linkNodes ( soMap, &isl );
+  numberIslands ( soMap, &isl );
+
+  /* which islands the spawn points are in */
+  for ( i = 0; i < data.spawns; i++ )
+    if (( node = spawnNode ( soMap, data.spawn[i][0], data.spawn[i][1] )) >= 0 )
+      isl.spawned[ isl.number[ findRoot ( isl.parent, node ) ]]++;
+
+  for ( i = 0; i < isl.islands; i++ )
+    isl.keep[i] = (( isl.points[i] >= data.minIsland ) &&
+		   ( !( data.islands & ISL_SPAWNS ) || isl.spawned[i] ));
+
+  if ( data.islands & ISL_REPORT ) writeIslands ( soMap, &isl );
+  if ( data.islands & ISL_GRAPH )  writeGraph ( soMap, &isl );
+  dropped = pruneIslands ( soMap, &isl );
+
+  debug ( DBG_NOTICE, "%s smallOnes have %d islands, %d points dropped\n",
+	  baseName[ soMap->io.vehicle ], isl.islands, dropped );
+
+  free ( isl.parent );
+  free ( isl.points );
+  free ( isl.number );
+  free ( isl.keep );
+  free ( isl.spawned );
+} /* end findIslands */
+
+static int
+findRoot ( int *parent, int node )
+{
+  /* halve the path on the way up */
+  while ( parent[ node ] != node ) {
+    parent[ node ] = parent[ parent[ node ]];
+    node = parent[ node ];
+  }
+  return node;
+} /* end findRoot */
+
+static void
+joinNodes ( islandData *isl, int a, int b )
+{
+  int swap;
+
+  isl->links++;
+  if (( a = findRoot ( isl->parent, a )) == ( b = findRoot ( isl->parent, b ))) return;
+
+  /* the smaller island goes under the bigger one */
+  if ( isl->points[a] < isl->points[b] ) {
+    swap = a;
+    a = b;
+    b = swap;
+  }
+  isl->parent[b]  = a;
+  isl->points[a] += isl->points[b];
+} /* end joinNodes */
+
+static void
+linkNodes ( pathfindingmap *soMap, islandData *isl )
+{
+  smallOnesData *so;
+  int tile, col, row;
+  int i, j;
+
+  so = soMap->so;
+
+  /* every active point is an island of its own ... */
+  for ( tile = 0; tile < soMap->tiles; tile++ )
+    for ( i = 0; i < 4; i++ ) {
+      isl->parent[ tile * 4 + i ] = -1;
+      if ( so[ tile ].active & ( ACT_OFF << i )) {
+	isl->parent[ tile * 4 + i ] = tile * 4 + i;
+	isl->points[ tile * 4 + i ] = 1;
+      }
+    }
+
+  /* ... until a link joins it to another. links to points that aren't
+   * there are left out */
+  for ( tile = 0; tile < soMap->tiles; tile++ ) {
+    col = tile % soMap->tilesPerRow;
+    row = tile / soMap->tilesPerRow;
+    for ( i = 0; i < 4; i++ ) {
+      if ( isl->parent[ tile * 4 + i ] < 0 ) continue;
+      for ( j = 0; j < 4; j++ ) {
+	if (( so[ tile ].hasLower & ( 1 << ( i * 4 + j ))) &&
+	    ( row < soMap->tilesPerCol - 1 ) &&
+	    ( isl->parent[ ( tile + soMap->tilesPerRow ) * 4 + j ] >= 0 ))
+	  joinNodes ( isl, tile * 4 + i, ( tile + soMap->tilesPerRow ) * 4 + j );
+	if (( so[ tile ].hasRight & ( 1 << ( i * 4 + j ))) &&
+	    ( col < soMap->tilesPerRow - 1 ) &&
+	    ( isl->parent[ ( tile + 1 ) * 4 + j ] >= 0 ))
+	  joinNodes ( isl, tile * 4 + i, ( tile + 1 ) * 4 + j );
+      }
+    }
+  }
+} /* end linkNodes */
+
+static int
+cmpIslands ( const void *a, const void *b )
+{
+  const int *ia = (const int *) a;
+  const int *ib = (const int *) b;
+
+  /* most points first, then by where they start */
+  if ( ia[0] != ib[0] ) return ib[0] - ia[0];
+  return ia[1] - ib[1];
+} /* end cmpIslands */
+
+static void
+numberIslands ( pathfindingmap *soMap, islandData *isl )
+{
+  int nodes;
+  int node;
+  int *points = NULL;
+  int (*order)[2] = NULL;
+  int i;
+
+  nodes = soMap->tiles * 4;
+  for ( node = 0; node < nodes; node++ )
+    if ( isl->parent[ node ] == node ) isl->islands++;
+
+  if ( !( points = (int *) calloc ( sizeof ( int ), isl->islands + 1 )) ||
+       !( order = calloc ( sizeof ( *order ), isl->islands + 1 )) ||
+       !( isl->keep = (unsigned char *) calloc ( isl->islands + 1, 1 )) ||
+       !( isl->spawned = (int *) calloc ( sizeof ( int ), isl->islands + 1 )))
+    shutdown ( EF_MALLOC, "Memory allocation error numbering smallOnes islands\n" );
+
+  /* roots are numbered by size, biggest first */
+  for ( i = 0, node = 0; node < nodes; node++ )
+    if ( isl->parent[ node ] == node ) {
+      order[i][0]   = isl->points[ node ];
+      order[i++][1] = node;
+    }
+  qsort ( order, isl->islands, sizeof ( *order ), cmpIslands );
+  for ( i = 0; i < isl->islands; i++ ) {
+    isl->number[ order[i][1] ] = i;
+    points[i] = order[i][0];
+  }
+
+  /* from here on points is by island, and every node knows its island */
+  for ( node = 0; node < nodes; node++ )
+    isl->number[ node ] = ( isl->parent[ node ] < 0 ) ? -1 :
+      isl->number[ findRoot ( isl->parent, node ) ];
+
+  free ( order );
+  free ( isl->points );
+  isl->points = points;
+} /* end numberIslands */
+
+/* the point whose area has pixel x, y of the level 0 map - or the nearest
+ * point in the tile, when the areas aren't known */
+static int
+spawnNode ( pathfindingmap *soMap, int x, int y )
+{
+  smallOnesData *so;
+  unsigned char *area;
+  int tile;
+  int col, row;
+  int dist, best, node;
+  int i;
+
+  if ( !INRANGE ( x, 0, soMap->tilesPerRow * TILE_DIM - 1 ) ||
+       !INRANGE ( y, 0, soMap->tilesPerCol * TILE_DIM - 1 )) {
+    debug ( DBG_WARN, "Spawn point %d,%d is off the %s map\n",
+	    x, y, baseName[ soMap->io.vehicle ] );
+    return -1;
+  }
+
+  tile = ( y / TILE_DIM ) * soMap->tilesPerRow + x / TILE_DIM;
+  col  = x % TILE_DIM;
+  row  = y % TILE_DIM;
+  so   = &(soMap->so[ tile ]);
+
+  best = -1;
+  node = -1;
+  for ( i = 0; i < 4; i++ ) {
+    if ( !( so->active & ( ACT_OFF << i ))) continue;
+    area = soMap->img ? soMap->img[ tile ].pt[i] : NULL;
+    if ( area && !( area[ row * ROW_BYTES + col / 8 ] & ( 1 << ( col % 8 ))))
+      return tile * 4 + i;
+    dist = ABS ( so->pt[i][0] - col ) + ABS ( so->pt[i][1] - row );
+    if (( best < 0 ) || ( dist < best )) {
+      best = dist;
+      node = tile * 4 + i;
+    }
+  }
+
+  if ( node < 0 )
+    debug ( DBG_WARN, "Spawn point %d,%d is in a %s tile with no smallOnes\n",
+	    x, y, baseName[ soMap->io.vehicle ] );
+  else if ( soMap->img && soMap->img[ tile ].pt[0] )
+    debug ( DBG_WARN, "Spawn point %d,%d is on NoGo, using the nearest %s smallOnes point\n",
+	    x, y, baseName[ soMap->io.vehicle ] );
+  return node;
+} /* end spawnNode */
+
+static void
+writeIslands ( pathfindingmap *soMap, islandData *isl )
+{
+  char  buffer[ BUF_SIZE ];
+  FILE *fp;
+  int  *box;
+  int   node, tile, n;
+  int   points;
+  int   i;
+
+  if ( !( box = (int *) malloc ( sizeof ( int ) * 4 * ( isl->islands + 1 ))))
+    shutdown ( EF_MALLOC, "Memory allocation error reporting smallOnes islands\n" );
+
+  /* the tiles each island covers */
+  for ( i = 0; i < isl->islands; i++ ) {
+    box[ i * 4 ]     = box[ i * 4 + 1 ] = soMap->tiles;
+    box[ i * 4 + 2 ] = box[ i * 4 + 3 ] = -1;
+  }
+  points = 0;
+  for ( node = 0; node < soMap->tiles * 4; node++ ) {
+    if (( n = isl->number[ node ] ) < 0 ) continue;
+    points++;
+    tile = node / 4;
+    box[ n * 4 ]     = MIN ( box[ n * 4 ],     tile % soMap->tilesPerRow );
+    box[ n * 4 + 1 ] = MIN ( box[ n * 4 + 1 ], tile / soMap->tilesPerRow );
+    box[ n * 4 + 2 ] = MAX ( box[ n * 4 + 2 ], tile % soMap->tilesPerRow );
+    box[ n * 4 + 3 ] = MAX ( box[ n * 4 + 3 ], tile / soMap->tilesPerRow );
+  }
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_ISLANDS,
+	     data.outpath, PATHSEP, baseName[ soMap->io.vehicle ] );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+
+  fprintf ( fp, "%s smallOnes islands%s%s", baseName[ soMap->io.vehicle ], LINEFEED, LINEFEED );
+  fprintf ( fp, "points   %d%s", points, LINEFEED );
+  fprintf ( fp, "links    %d%s", isl->links, LINEFEED );
+  fprintf ( fp, "islands  %d%s%s", isl->islands, LINEFEED, LINEFEED );
+  fprintf ( fp, "island  points  tiles                spawns  kept%s", LINEFEED );
+  for ( i = 0; i < isl->islands; i++ ) {
+    snprintf ( buffer, BUF_SIZE, "%d,%d - %d,%d",
+	       box[ i * 4 ], box[ i * 4 + 1 ], box[ i * 4 + 2 ], box[ i * 4 + 3 ] );
+    fprintf ( fp, "%6d  %6d  %-19s  %6d  %s%s", i, isl->points[i], buffer,
+	      isl->spawned[i], isl->keep[i] ? "yes" : "no", LINEFEED );
+  }
+
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing smallOnes islands\n" );
+  free ( box );
+} /* end writeIslands */
+
+static void
+writeGraph ( pathfindingmap *soMap, islandData *isl )
+{
+  char  buffer[ BUF_SIZE ];
+  FILE *fp;
+  smallOnesData *so;
+  int  *id;
+  int  *first;
+  int  *next;
+  int  *fill;
+  int   head[2];
+  int   node[3];
+  int   nodes, pass;
+  int   tile, other, n;
+  int   i, j;
+
+  so = soMap->so;
+  n  = soMap->tiles * 4;
+  if ( !( id = (int *) malloc ( sizeof ( int ) * n )))
+    shutdown ( EF_MALLOC, "Memory allocation error writing smallOnes graph\n" );
+
+  /* the points kept, in order */
+  nodes = 0;
+  for ( i = 0; i < n; i++ )
+    id[i] = (( isl->number[i] >= 0 ) && isl->keep[ isl->number[i] ] ) ? nodes++ : -1;
+
+  if ( !( first = (int *) calloc ( sizeof ( int ), nodes + 1 )) ||
+       !( fill  = (int *) calloc ( sizeof ( int ), nodes + 1 )))
+    shutdown ( EF_MALLOC, "Memory allocation error writing smallOnes graph\n" );
+
+  /* count, then place, each link both ways */
+  for ( pass = 0; pass < 2; pass++ ) {
+    for ( i = 0; i < n; i++ ) {
+      if ( id[i] < 0 ) continue;
+      for ( j = 0; j < 8; j++ ) {
+	if (( other = linkedNode ( soMap, id, i, j )) < 0 ) continue;
+	if ( !pass ) {
+	  first[ id[i] + 1 ]++;
+	  first[ other + 1 ]++;
+	} else {
+	  next[ fill[ id[i] ]++ ] = other;
+	  next[ fill[ other ]++ ] = id[i];
+	}
+      }
+    }
+    if ( pass ) break;
+    for ( i = 0; i < nodes; i++ ) first[ i + 1 ] += first[i];
+    for ( i = 0; i < nodes; i++ ) fill[i] = first[i];
+    if ( !( next = (int *) malloc ( sizeof ( int ) * ( first[ nodes ] + 1 ))))
+      shutdown ( EF_MALLOC, "Memory allocation error writing smallOnes graph\n" );
+  }
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_GRAPH,
+	     data.outpath, PATHSEP, baseName[ soMap->io.vehicle ] );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+
+  head[0] = nodes;
+  head[1] = first[ nodes ];
+  if ( !fwrite ( head, sizeof ( head ), 1, fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing smallOnes graph header\n" );
+  for ( i = 0; i < n; i++ ) {
+    if ( id[i] < 0 ) continue;
+    tile = i / 4;
+    node[0] = ( tile % soMap->tilesPerRow ) * TILE_DIM + so[ tile ].pt[ i % 4 ][0];
+    node[1] = ( tile / soMap->tilesPerRow ) * TILE_DIM + so[ tile ].pt[ i % 4 ][1];
+    node[2] = isl->number[i];
+    if ( !fwrite ( node, sizeof ( node ), 1, fp ))
+      shutdown ( EF_FILE_WRITE, "Error writing smallOnes graph nodes\n" );
+  }
+  if ( !fwrite ( first, sizeof ( int ) * ( nodes + 1 ), 1, fp ) ||
+       ( first[ nodes ] && !fwrite ( next, sizeof ( int ) * first[ nodes ], 1, fp )))
+    shutdown ( EF_FILE_WRITE, "Error writing smallOnes graph links\n" );
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing smallOnes graph\n" );
+
+  free ( id );
+  free ( first );
+  free ( fill );
+  free ( next );
+} /* end writeGraph */
+
+/* the graph id of the point that link j of a node goes to - 0 to 3 are
+ * the points of the tile below, 4 to 7 those to the right - or -1 */
+static int
+linkedNode ( pathfindingmap *soMap, int *id, int node, int j )
+{
+  smallOnesData *so;
+  int tile;
+  int i;
+
+  tile = node / 4;
+  i    = node % 4;
+  so   = &(soMap->so[ tile ]);
+
+  if ( j < 4 ) {
+    if ( !( so->hasLower & ( 1 << ( i * 4 + j ))) ||
+	 ( tile / soMap->tilesPerRow >= soMap->tilesPerCol - 1 )) return -1;
+    return id[ ( tile + soMap->tilesPerRow ) * 4 + j ];
+  }
+  if ( !( so->hasRight & ( 1 << ( i * 4 + j - 4 ))) ||
+       ( tile % soMap->tilesPerRow >= soMap->tilesPerRow - 1 )) return -1;
+  return id[ ( tile + 1 ) * 4 + j - 4 ];
+} /* end linkedNode */
+
+/* drop the points of the islands not kept, returns how many */
+static int
+pruneIslands ( pathfindingmap *soMap, islandData *isl )
+{
+  smallOnesData *so;
+  smallOnesData  old;
+  unsigned char *area[4];
+  int *moved;
+  int  dropped;
+  int  tile, node, i, j, k;
+
+  so = soMap->so;
+  if ( !( moved = (int *) malloc ( sizeof ( int ) * soMap->tiles * 4 )))
+    shutdown ( EF_MALLOC, "Memory allocation error dropping smallOnes islands\n" );
+
+  /* where each point goes - the points kept stay in order */
+  dropped = 0;
+  for ( tile = 0; tile < soMap->tiles; tile++ )
+    for ( i = 0, k = 0; i < 4; i++ ) {
+      node = tile * 4 + i;
+      moved[ node ] = -1;
+      if ( isl->number[ node ] < 0 ) continue;
+      if ( isl->keep[ isl->number[ node ]] ) moved[ node ] = k++;
+      else dropped++;
+    }
+
+  /* the links are moved with the points at both ends */
+  for ( tile = 0; dropped && ( tile < soMap->tiles ); tile++ ) {
+    old = so[ tile ];
+    so[ tile ].hasLower = so[ tile ].hasRight = 0;
+    so[ tile ].active  &= ~( 0xf * ACT_OFF );
+    memset ( so[ tile ].pt, 0, sizeof ( old.pt ));
+    for ( i = 0; i < 4; i++ ) {
+      area[i] = soMap->img ? soMap->img[ tile ].pt[i] : NULL;
+      if ( soMap->img ) soMap->img[ tile ].pt[i] = NULL;
+    }
+
+    for ( i = 0; i < 4; i++ ) {
+      if (( k = moved[ tile * 4 + i ] ) < 0 ) {
+	if ( area[i] ) free ( area[i] );
+	continue;
+      }
+      so[ tile ].active  |= ACT_OFF << k;
+      so[ tile ].pt[k][0] = old.pt[i][0];
+      so[ tile ].pt[k][1] = old.pt[i][1];
+      if ( soMap->img ) soMap->img[ tile ].pt[k] = area[i];
+
+      for ( j = 0; j < 4; j++ ) {
+	if (( old.hasLower & ( 1 << ( i * 4 + j ))) &&
+	    ( tile / soMap->tilesPerRow < soMap->tilesPerCol - 1 ) &&
+	    ( moved[ ( tile + soMap->tilesPerRow ) * 4 + j ] >= 0 ))
+	  so[ tile ].hasLower |= 1 << ( k * 4 + moved[ ( tile + soMap->tilesPerRow ) * 4 + j ] );
+	if (( old.hasRight & ( 1 << ( i * 4 + j ))) &&
+	    ( tile % soMap->tilesPerRow < soMap->tilesPerRow - 1 ) &&
+	    ( moved[ ( tile + 1 ) * 4 + j ] >= 0 ))
+	  so[ tile ].hasRight |= 1 << ( k * 4 + moved[ ( tile + 1 ) * 4 + j ] );
+      }
+    }
+  }
+
+  free ( moved );
+  return dropped;
+} /* end pruneIslands */
@@ -0,0 +1,65 @@
+/* islands.h - smallOnes areas that connect to nothing
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __ISLANDS_H__
+#define __ISLANDS_H__
+
+
+/************************************  macros                 ***********************/
+
+/* data.islands */
+#define ISL_REPORT   ( 1 << 0 )  /* write VehicleIslands.txt */
+#define ISL_SPAWNS   ( 1 << 1 )  /* drop the islands no spawn point is in */
+#define ISL_GRAPH    ( 1 << 2 )  /* write VehicleGraph.csr */
+
+/* the graph file, every value a 4 byte int:
+ *
+ *     nodes, links
+ *     x, y, island      for each node - x, y in level 0 pixels
+ *     first             nodes + 1 of them, node n links to
+ *                       next[ first[n] ] to next[ first[n+1] - 1 ]
+ *     next              links of them
+ *
+ * nodes are the active smallOnes points left, by tile then point. a link
+ * is in the file both ways.
+ */
+
+/************************************  structures and enums  ************************/
+
+typedef struct _islandData
+{
+  int            *parent;   /* tile * 4 + point, itself at the root */
+  int            *points;   /* points in the island, at the root */
+  int            *number;   /* island of each root, biggest first */
+  int             islands;
+  int             links;
+  unsigned char  *keep;     /* by island number */
+  int            *spawned;  /* spawn points in each island */
+} islandData;
+
+/************************************  prototypes             ***********************/
+
+void             findIslands      ( pathfindingmap *soMap );
+
+#endif /* __ISLANDS_H__ */
@@ -0,0 +1,342 @@
+/* levelcheck.c - checking compressed levels against level 0
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -x dir, the Level1 to Level5 map files in dir are checked against
+ * the level 0 map they should have been made from - a pixel is NoGo when
+ * any of the 2 x 2 pixels under it on the level below is. the game uses
+ * the levels it's given without a word.
+ *
+ * the levels expected are made from level 0 a word at a time: a row of a
+ * tile is one 64 bit word, two rows are ORed, each pair of bits is ORed,
+ * and the even bits are packed into half a word. tiles with four uniform
+ * tiles of the same kind under them are not looked at, and tiles are
+ * compared on their flags before their bits.
+ *
+ * the tiles that differ are listed in VehicleLevels.txt with how many of
+ * their pixels do. with -X, VehicleNLevelNCheck.bmp shows where.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "memory.h"
+#include "image.h"
+#include "reach.h"
+#include "levelcheck.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern THREAD_LOCAL userData data;
+
+/************************************  prototypes             ***********************/
+
+static void       allocWords   ( levelWords *lw, int tilesPerRow );
+static void       freeWords    ( levelWords *lw );
+static void       mapWords     ( levelWords *lw, pathfindingmap *map );
+static void       reduceWords  ( levelWords *dst, levelWords *src );
+static reachWord  packEven     ( reachWord word );
+static int        checkLevel   ( levelWords *want, levelWords *have, int level, FILE *fp );
+static char      *flagName     ( tileDataType flag );
+static void       writeCheck   ( levelWords *want, levelWords *have, int vehicle, int level );
+
+/************************************  functions             ************************/
+
+void
+checkLevels ( mapIOData *in )
+{
+  mapIOData out = {0};
+  pathfindingmap *map;
+  pathfindingmap *file;
+  levelWords want, next, have;
+  char buffer[ BUF_SIZE ];
+  char path[ BUF_SIZE ];
+  FILE *fp;
+  int level;
+  int problems = 0;
+
+  if ( !( in->type & FTF_MAP ) || in->level ) {
+    debug ( DBG_WARN, "Levels are only checked against a level 0 search map, not %s\n",
+	    in->path );
+    return;
+  }
+
+  out.path    = data.outpath;
+  out.vehicle = in->vehicle;
+  out.type    = FTF_MAP;
+  if ( !( map = getMap ( &(data.maps), in, &out )))
+    shutdown ( EF_FILE_READ, "Error loading %s\n", in->path );
+  if (( map->rowsPerTile != TILE_DIM ) || ( map->bytesPerRow != ROW_BYTES ))
+    shutdown ( EF_NOT_SUPPORTED, "The levels of %s can't be checked\n", in->path );
+
+  allocWords ( &want, map->tilesPerRow );
+  mapWords ( &want, map );
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_LEVELS,
+	     data.outpath, PATHSEP, baseName[ in->vehicle ] );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+
+  /* small maps run out of tiles before the last level */
+  for ( level = 1; ( level <= ( ISSEA ( in->vehicle ) ? 5 : 2 )) && ( want.tilesPerRow > 1 ); level++ ) {
+    allocWords ( &next, want.tilesPerRow / 2 );
+    reduceWords ( &next, &want );
+    freeWords ( &want );
+    want = next;
+
+    snprintf ( path, BUF_SIZE, FILENAME_MAP_RAW,
+	       data.checkPath, PATHSEP, baseName[ in->vehicle ], in->vehicle, level );
+    if ( !( file = readMapFile ( path, FTF_MAP, in->vehicle, level ))) {
+      fprintf ( fp, "level %d: %s is missing%s", level, path, LINEFEED );
+      problems++;
+      continue;
+    }
+
+    if (( file->tilesPerRow != want.tilesPerRow ) || ( file->rowsPerTile != TILE_DIM ) ||
+	( file->bytesPerRow != ROW_BYTES )) {
+      fprintf ( fp, "level %d: %s is %d tiles of %d rows across, not %d of %d%s", level, path,
+		file->tilesPerRow, file->rowsPerTile, want.tilesPerRow, TILE_DIM, LINEFEED );
+      problems++;
+    } else {
+      allocWords ( &have, file->tilesPerRow );
+      mapWords ( &have, file );
+      problems += checkLevel ( &want, &have, level, fp );
+      if ( data.checkImage ) writeCheck ( &want, &have, in->vehicle, level );
+      freeWords ( &have );
+    }
+    freeMap ( &file );
+  }
+  freeWords ( &want );
+
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing %s\n", buffer );
+
+  debug ( problems ? DBG_WARN : DBG_NOTICE, "%s levels: %d problems, see %s\n",
+	  baseName[ in->vehicle ], problems, buffer );
+  data.problems += problems;
+} /* end checkLevels */
+
+static void
+allocWords ( levelWords *lw, int tilesPerRow )
+{
+  lw->tilesPerRow = tilesPerRow;
+  lw->tiles       = tilesPerRow * tilesPerRow;
+  if ( !( lw->flag = (tileDataType *) malloc ( sizeof ( tileDataType ) * lw->tiles )) ||
+       !( lw->row  = (reachWord *) malloc ( sizeof ( reachWord ) * lw->tiles * TILE_DIM )))
+    shutdown ( EF_MALLOC, "Memory allocation error checking levels\n" );
+} /* end allocWords */
+
+static void
+freeWords ( levelWords *lw )
+{
+  free ( lw->flag );
+  free ( lw->row );
+  lw->flag = NULL;
+  lw->row  = NULL;
+} /* end freeWords */
+
+static void
+mapWords ( levelWords *lw, pathfindingmap *map )
+{
+  reachWord word;
+  int tile, r;
+  int i;
+
+  for ( tile = 0; tile < lw->tiles; tile++ ) {
+    lw->flag[ tile ] = map->tile[ tile ].flag;
+    for ( r = 0; r < TILE_DIM; r++ ) {
+      if ( map->tile[ tile ].flag != TDT_MIXED ) {
+	lw->row[ tile * TILE_DIM + r ] = ( map->tile[ tile ].flag == TDT_NOGO ) ? ~0ULL : 0;
+	continue;
+      }
+      for ( word = 0, i = ROW_BYTES - 1; i >= 0; i-- )
+	word = ( word << 8 ) | map->tile[ tile ].bits[ r * ROW_BYTES + i ];
+      lw->row[ tile * TILE_DIM + r ] = word;
+    }
+  }
+} /* end mapWords */
+
+/* the level above src. a tile's top half comes from the two tiles under
+ * it in the row of tiles before, as compressTile makes it */
+static void
+reduceWords ( levelWords *dst, levelWords *src )
+{
+  reachWord *left, *right;
+  reachWord  word, half, all, any;
+  int tile, under;
+  int r;
+
+  for ( tile = 0; tile < dst->tiles; tile++ ) {
+    under = ( tile / dst->tilesPerRow ) * 2 * src->tilesPerRow + ( tile % dst->tilesPerRow ) * 2;
+
+    if (( src->flag[ under ] != TDT_MIXED ) &&
+	( src->flag[ under + 1 ] == src->flag[ under ] ) &&
+	( src->flag[ under + src->tilesPerRow ] == src->flag[ under ] ) &&
+	( src->flag[ under + src->tilesPerRow + 1 ] == src->flag[ under ] )) {
+      dst->flag[ tile ] = src->flag[ under ];
+      for ( r = 0; r < TILE_DIM; r++ )
+	dst->row[ tile * TILE_DIM + r ] = ( dst->flag[ tile ] == TDT_NOGO ) ? ~0ULL : 0;
+      continue;
+    }
+
+    all = ~0ULL;
+    any = 0;
+    for ( r = 0; r < TILE_DIM; r++ ) {
+      if ( r == TILE_DIM / 2 ) under += src->tilesPerRow;
+      left  = src->row + under * TILE_DIM + ( r * 2 ) % TILE_DIM;
+      right = left + TILE_DIM;
+      word  = left[0] | left[1];
+      half  = packEven ( word | ( word >> 1 ));
+      word  = right[0] | right[1];
+      word  = half | ( packEven ( word | ( word >> 1 )) << 32 );
+      dst->row[ tile * TILE_DIM + r ] = word;
+      all  &= word;
+      any  |= word;
+    }
+    dst->flag[ tile ] = ( all == ~0ULL ) ? TDT_NOGO : ( any ? TDT_MIXED : TDT_DOGO );
+  }
+} /* end reduceWords */
+
+/* bits 0, 2, 4 ... 62 of word as bits 0 to 31 */
+static reachWord
+packEven ( reachWord word )
+{
+  word &= 0x5555555555555555ULL;
+  word  = ( word | ( word >> 1 ))  & 0x3333333333333333ULL;
+  word  = ( word | ( word >> 2 ))  & 0x0f0f0f0f0f0f0f0fULL;
+  word  = ( word | ( word >> 4 ))  & 0x00ff00ff00ff00ffULL;
+  word  = ( word | ( word >> 8 ))  & 0x0000ffff0000ffffULL;
+  word  = ( word | ( word >> 16 )) & 0x00000000ffffffffULL;
+  return word;
+} /* end packEven */
+
+/* list the tiles that differ, returns how many. a tile whose pixels all
+ * agree but whose flag does not is listed, but passes - it goes the same
+ * way either way */
+static int
+checkLevel ( levelWords *want, levelWords *have, int level, FILE *fp )
+{
+  int tile, r;
+  int pixels, total = 0;
+  int differ = 0;
+  int flagOnly = 0;
+
+  for ( tile = 0; tile < want->tiles; tile++ ) {
+    /* uniform tiles that agree have nothing more to look at */
+    if (( want->flag[ tile ] == have->flag[ tile ] ) && ( want->flag[ tile ] != TDT_MIXED ))
+      continue;
+
+    for ( pixels = r = 0; r < TILE_DIM; r++ )
+      pixels += __builtin_popcountll ( want->row[ tile * TILE_DIM + r ] ^
+				       have->row[ tile * TILE_DIM + r ] );
+    if ( !pixels ) {
+      if ( want->flag[ tile ] != have->flag[ tile ] ) {
+	fprintf ( fp, "level %d tile: %02dx%02d is %s, level 0 makes it %s, flag only%s",
+		  level, tile % want->tilesPerRow, tile / want->tilesPerRow,
+		  flagName ( have->flag[ tile ] ), flagName ( want->flag[ tile ] ), LINEFEED );
+	flagOnly++;
+      }
+      continue;
+    }
+
+    fprintf ( fp, "level %d tile: %02dx%02d is %s, level 0 makes it %s, %d pixels differ%s",
+	      level, tile % want->tilesPerRow, tile / want->tilesPerRow,
+	      flagName ( have->flag[ tile ] ), flagName ( want->flag[ tile ] ), pixels, LINEFEED );
+    total += pixels;
+    differ++;
+  }
+
+  fprintf ( fp, "# level %d: %d tiles, %d differ, %d pixels, %d flag only%s",
+	    level, want->tiles, differ, total, flagOnly, LINEFEED );
+  return differ;
+} /* end checkLevel */
+
+static char *
+flagName ( tileDataType flag )
+{
+  switch ( flag )
+    {
+    case TDT_DOGO:
+      return "DoGo";
+    case TDT_NOGO:
+      return "NoGo";
+    default:
+      return "mixed";
+    }
+} /* end flagName */
+
+/* a 4 bit bitmap of the level as the file has it, with the pixels that
+ * differ in their own colors */
+static void
+writeCheck ( levelWords *want, levelWords *have, int vehicle, int level )
+{
+  pathfindingmap image;
+  char buffer[ BUF_SIZE ];
+  unsigned char *line;
+  reachWord w, h;
+  FILE *fp;
+  int width;
+  int x, y;
+  int color;
+
+  memset ( &image, 0, sizeof ( pathfindingmap ));
+  image.io.type    = FTF_IMG | FTF_MAP;
+  image.io.vehicle = vehicle;
+  image.io.level   = level;
+  image.io.bits    = 4;
+
+  width = want->tilesPerRow * TILE_DIM;
+  if ( !( line = (unsigned char *) malloc ( width / 2 )))
+    shutdown ( EF_MALLOC, "Memory allocation error drawing the %s level %d check\n",
+	       baseName[ vehicle ], level );
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_CHECK, data.outpath, PATHSEP,
+	     baseName[ vehicle ], vehicle, level, FILE_BMP_EXT );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+  writeBmpHeaderDim ( &image, fp, width, width );
+
+  for ( y = 0; y < width; y++ ) {
+    for ( x = 0; x < width; x++ ) {
+      w = want->row[ (( y / TILE_DIM ) * want->tilesPerRow + x / TILE_DIM ) * TILE_DIM + y % TILE_DIM ];
+      h = have->row[ (( y / TILE_DIM ) * have->tilesPerRow + x / TILE_DIM ) * TILE_DIM + y % TILE_DIM ];
+      w = ( w >> ( x % TILE_DIM )) & 1;
+      h = ( h >> ( x % TILE_DIM )) & 1;
+      if ( w == h ) color = h ? LVL_NOGO : LVL_DOGO;
+      else color = h ? LVL_EXTRA : LVL_LOST;
+      if ( x % 2 ) line[ x / 2 ] |= color;
+      else line[ x / 2 ] = color << 4;
+    }
+    if ( !fwrite ( line, width / 2, 1, fp ))
+      shutdown ( EF_FILE_WRITE, "Error writing the %s level %d check\n",
+		 baseName[ vehicle ], level );
+  }
+
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing the %s level %d check\n",
+	       baseName[ vehicle ], level );
+  free ( line );
+} /* end writeCheck */
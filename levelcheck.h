@@ -0,0 +1,53 @@
+/* levelcheck.h - checking compressed levels against level 0
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __LEVELCHECK_H__
+#define __LEVELCHECK_H__
+
+
+/************************************  macros                 ***********************/
+
+/* colors of the check images, from the default palette */
+#define LVL_DOGO        0
+#define LVL_NOGO        15
+#define LVL_EXTRA       11    /* NoGo that level 0 doesn't have */
+#define LVL_LOST        12    /* DoGo where level 0 has NoGo */
+
+/************************************  structures and enums  ************************/
+
+/* a level as a word for each row of each tile, NoGo bits set, in the
+ * bit order of the map files */
+typedef struct _levelWords
+{
+  int             tilesPerRow;
+  int             tiles;
+  tileDataType   *flag;
+  reachWord      *row;      /* tile * TILE_DIM + row */
+} levelWords;
+
+/************************************  prototypes             ***********************/
+
+void             checkLevels      ( mapIOData *in );
+
+#endif /* __LEVELCHECK_H__ */
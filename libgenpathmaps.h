@@ -0,0 +1,138 @@
+/* libgenpathmaps.h - the genPathmaps library
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* the library makes the game files and images in memory, without the
+ * program around it. a context holds a level 0 search map - read from a
+ * file or handed over in a buffer - and the maps made from it:
+ *
+ *     gplContext *ctx = gplCreate ( 1 );
+ *     gplLoadBuffer ( ctx, "Tank0Level0Map.bmp", bmp, bmpSize );
+ *     gplGetFile ( ctx, GPL_MAP, 1, NULL, 0, &size );
+ *     buf = malloc ( size );
+ *     gplGetFile ( ctx, GPL_MAP, 1, buf, size, &size );
+ *     gplDestroy ( ctx );
+ *
+ * the name passed with a buffer tells the vehicle and the file type, as
+ * it does for the program. everything returns 0 or one of the GPL_E
+ * codes, gplError has the message. after an error in a build the maps of
+ * the context are let go, and are made again when they are next asked for.
+ *
+ * contexts can be used from any thread. calls on different contexts run
+ * at the same time, calls on the same context wait their turn.
+ */
+
+#ifndef __LIBGENPATHMAPS_H__
+#define __LIBGENPATHMAPS_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************  macros                 ***********************/
+
+#if defined ( __GNUC__ ) && ( __GNUC__ >= 4 )
+  #define GPL_API __attribute__ (( visibility ( "default" )))
+#else
+  #define GPL_API
+#endif
+
+/* what to make */
+#define GPL_MAP          1     /* search map, levels 0 to 2 or 5 for boats */
+#define GPL_INFO         2     /* info map, level is ignored */
+#define GPL_SO           4     /* smallOnes, level is ignored */
+
+/* how images are drawn */
+#define GPL_IMG_RAW      1     /* 8 bit raw instead of a bitmap */
+#define GPL_IMG_PREP     2     /* 4 bit preprocessed map */
+#define GPL_IMG_NATIVE   4     /* compressed levels at their own resolution */
+#define GPL_IMG_RLE      8     /* run length encoded bitmap */
+#define GPL_IMG_PNG      16    /* png instead of a bitmap */
+#define GPL_IMG_GRID     32    /* checkerboard grid */
+#define GPL_IMG_NUMBERS  64    /* tile numbers */
+#define GPL_IMG_LINES    128   /* smallOnes links */
+
+/************************************  structures and enums  ************************/
+
+typedef struct _gplContext gplContext;
+
+/* in the same order as the program's exit codes */
+typedef enum _gplErr
+  {
+    GPL_OK = 0,
+    GPL_E_USAGE,
+    GPL_E_NO_JOBS,
+    GPL_E_MALLOC,
+    GPL_E_FILE_OPEN,
+    GPL_E_FILE_SIZE,
+    GPL_E_FILE_SEEK,
+    GPL_E_FILE_READ,
+    GPL_E_FILE_WRITE,
+    GPL_E_FILE_NAME,
+    GPL_E_NOT_FOUND,
+    GPL_E_DATA_MISSING,
+    GPL_E_INFO_MISSING,
+    GPL_E_MEM_OVERRUN,    /* also: the buffer passed is too small */
+    GPL_E_LOOP_TIMEOUT,
+    GPL_E_PASSED_NULL,
+    GPL_E_BAD_FILE,
+    GPL_E_BAD_DATA,
+    GPL_E_NOT_SUPPORTED,
+    GPL_E_FUNCTION_ERR,
+    GPL_E_UNKNOWN
+  } gplErr;
+
+/************************************  prototypes             ***********************/
+
+/* threads is how many render images, 0 for one a processor. without a
+ * unix build there is no context and every call is GPL_E_NOT_SUPPORTED
+ */
+GPL_API gplContext *gplCreate     ( int threads );
+GPL_API void        gplDestroy    ( gplContext *ctx );
+
+/* the level 0 search map - a bmp, png, 8 bit raw or game file */
+GPL_API int         gplLoadFile   ( gplContext *ctx, const char *path );
+GPL_API int         gplLoadBuffer ( gplContext *ctx, const char *name,
+				    const void *buf, size_t size );
+
+/* make every level, the info map and smallOnes now rather than as asked */
+GPL_API int         gplBuild      ( gplContext *ctx );
+
+/* the game file or an image of it. size is the space in buf, needed gets
+ * the size of the file - pass a NULL buf to find it out
+ */
+GPL_API int         gplGetFile    ( gplContext *ctx, int what, int level,
+				    void *buf, size_t size, size_t *needed );
+GPL_API int         gplGetImage   ( gplContext *ctx, int what, int level, int flags,
+				    void *buf, size_t size, size_t *needed );
+
+/* the message of the last error, empty if there wasn't one */
+GPL_API const char *gplError      ( gplContext *ctx );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LIBGENPATHMAPS_H__ */
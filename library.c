@@ -0,0 +1,553 @@
+/* library.c - the genPathmaps library
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* the library runs the same code as the program, so a context is the
+ * program's state - userData and the map registry - swapped in for the
+ * length of a call. that state is kept per thread, so calls on different
+ * contexts run at the same time; calls on one context are taken one at
+ * a time under its lock.
+ *
+ * files are never written to disk: data.opener hands the jobs memory
+ * streams, and the input can be a buffer the caller passed in. errors
+ * still go through shutdown, which jumps back to the call that was made
+ * rather than ending the process.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "registry.h"
+#include "library.h"
+#include "libgenpathmaps.h"
+
+#ifdef IS_UNIX
+  #include <pthread.h>
+  #include <setjmp.h>
+  #include <unistd.h>
+#endif
+
+/************************************  global variables      ************************/
+
+extern THREAD_LOCAL userData data;
+extern char *baseName[];
+
+#ifdef IS_UNIX
+
+struct _gplContext
+{
+  pthread_mutex_t   lock;
+  userData          data;
+  mapRegistry       reg;
+  mapIOData         in;
+  memFile          *input;
+  memFile          *files;
+  memFile          *written;
+  int               lastWhat;
+  int               lastLevel;
+  int               lastFlags;
+  int               status;
+  char              error[ BUF_SIZE ];
+};
+
+/* the library's error codes are the program's exit codes */
+_Static_assert ( (int) GPL_E_UNKNOWN == (int) EF_UNKNOWN_ERROR,
+		 "GPL_E codes are not the exit codes" );
+
+static struct
+{
+  int gpl;
+  int ftf;
+} imageFlags[] = {
+  { GPL_IMG_RAW,     FTF_RAW     },
+  { GPL_IMG_PREP,    FTF_PREP    },
+  { GPL_IMG_NATIVE,  FTF_NATIVE  },
+  { GPL_IMG_RLE,     FTF_RLE     },
+  { GPL_IMG_PNG,     FTF_PNG     },
+  { GPL_IMG_GRID,    FTF_GRID    },
+  { GPL_IMG_NUMBERS, FTF_NUMBERS },
+  { GPL_IMG_LINES,   FTF_LINES   },
+  { 0,               0           }
+};
+
+/* the call being made on this thread */
+static THREAD_LOCAL gplContext *active = NULL;
+static THREAD_LOCAL jmp_buf     trap;
+static THREAD_LOCAL int         armed = FALSE;
+/* the error that came back to trap - setjmp's value can only be tested */
+static THREAD_LOCAL int         caught = EF_NONE;
+
+/************************************  prototypes             ***********************/
+
+static void  enterContext ( gplContext *ctx );
+static int   leaveContext ( gplContext *ctx );
+static void  dropMaps     ( gplContext *ctx );
+static void  dropInput    ( gplContext *ctx );
+static void  freeFiles    ( memFile **files );
+static FILE *memOpen      ( char *path, const char *mode );
+static void  loadInput    ( gplContext *ctx, const char *path, const void *buf, size_t size );
+static pathfindingmap *makeMap ( gplContext *ctx, int type, int level );
+static void  getOutput    ( gplContext *ctx, int what, int level, int flags,
+			    void *buf, size_t size, size_t *needed );
+
+/************************************  functions             ************************/
+
+gplContext *
+gplCreate ( int threads )
+{
+  gplContext *ctx;
+
+  if ( !( ctx = (gplContext *) calloc ( sizeof ( gplContext ), 1 )))
+    return NULL;
+  if ( !( ctx->data.outpath = (char *) malloc ( strlen ( LIBRARY_DIR ) + 1 ))) {
+    free ( ctx );
+    return NULL;
+  }
+  strcpy ( ctx->data.outpath, LIBRARY_DIR );
+
+  ctx->data.debug   = DBG_QUIET;
+  ctx->data.threads = ( threads > 0 ) ? threads : (int) sysconf ( _SC_NPROCESSORS_ONLN );
+  ctx->data.opener  = memOpen;
+  pthread_mutex_init ( &(ctx->lock), NULL );
+  return ctx;
+} /* end gplCreate */
+
+void
+gplDestroy ( gplContext *ctx )
+{
+  if ( !ctx ) return;
+
+  enterContext ( ctx );
+  dropMaps ( ctx );
+  dropInput ( ctx );
+  free ( data.outpath );
+  data.outpath = NULL;
+  leaveContext ( ctx );
+
+  pthread_mutex_destroy ( &(ctx->lock) );
+  free ( ctx );
+} /* end gplDestroy */
+
+int
+gplLoadFile ( gplContext *ctx, const char *path )
+{
+  if ( !ctx || !path ) return EF_PASSED_NULL;
+
+  enterContext ( ctx );
+  if ( !setjmp ( trap )) {
+    armed = TRUE;
+    loadInput ( ctx, path, NULL, 0 );
+  } else dropInput ( ctx );
+  return leaveContext ( ctx );
+} /* end gplLoadFile */
+
+int
+gplLoadBuffer ( gplContext *ctx, const char *name, const void *buf, size_t size )
+{
+  if ( !ctx || !name || !buf ) return EF_PASSED_NULL;
+  if ( !size ) return EF_FILE_SIZE;
+
+  enterContext ( ctx );
+  if ( !setjmp ( trap )) {
+    armed = TRUE;
+    loadInput ( ctx, name, buf, size );
+  } else dropInput ( ctx );
+  return leaveContext ( ctx );
+} /* end gplLoadBuffer */
+
+int
+gplBuild ( gplContext *ctx )
+{
+  pathfindingmap *set[ SET_MAPS ];
+
+  if ( !ctx ) return EF_PASSED_NULL;
+
+  enterContext ( ctx );
+  if ( !setjmp ( trap )) {
+    armed = TRUE;
+    if ( !ctx->in.path )
+      shutdown ( EF_DATA_MISSING, "No search map has been loaded\n" );
+    getMapSet ( &(ctx->in), set );
+  }
+  return leaveContext ( ctx );
+} /* end gplBuild */
+
+int
+gplGetFile ( gplContext *ctx, int what, int level,
+	     void *buf, size_t size, size_t *needed )
+{
+  if ( !ctx || !needed ) return EF_PASSED_NULL;
+
+  enterContext ( ctx );
+  if ( !setjmp ( trap )) {
+    armed = TRUE;
+    getOutput ( ctx, what, level, FTF_WRITE, buf, size, needed );
+  }
+  return leaveContext ( ctx );
+} /* end gplGetFile */
+
+int
+gplGetImage ( gplContext *ctx, int what, int level, int flags,
+	      void *buf, size_t size, size_t *needed )
+{
+  volatile int type;
+  int i;
+
+  if ( !ctx || !needed ) return EF_PASSED_NULL;
+
+  type = FTF_WRITE | FTF_IMG;
+  for ( i = 0; imageFlags[i].gpl; i++ )
+    if ( flags & imageFlags[i].gpl ) type |= imageFlags[i].ftf;
+
+  enterContext ( ctx );
+  if ( !setjmp ( trap )) {
+    armed = TRUE;
+    getOutput ( ctx, what, level, type, buf, size, needed );
+  }
+  return leaveContext ( ctx );
+} /* end gplGetImage */
+
+const char *
+gplError ( gplContext *ctx )
+{
+  return ctx ? ctx->error : "No context";
+} /* end gplError */
+
+void
+libraryRecover ( int err )
+{
+  /* back to the call that was made, if it was made on this thread */
+  if ( !armed || !err ) return;
+  armed  = FALSE;
+  caught = err;
+  /* a map that failed to load is not in the registry dropMaps empties */
+  dropLoad ();
+  longjmp ( trap, err );
+} /* end libraryRecover */
+
+/************************************  context               ************************/
+
+static void
+enterContext ( gplContext *ctx )
+{
+  userData tmp;
+
+  pthread_mutex_lock ( &(ctx->lock) );
+
+  tmp       = data;
+  data      = ctx->data;
+  ctx->data = tmp;
+  swapRegistry ( &(ctx->reg) );
+
+  active = ctx;
+  caught = EF_NONE;
+  ctx->status   = EF_NONE;
+  ctx->error[0] = '\0';
+} /* end enterContext */
+
+static int
+leaveContext ( gplContext *ctx )
+{
+  userData tmp;
+  int err = caught;
+
+  armed = FALSE;
+
+  /* whatever was being made is in an unknown state - start over */
+  if ( err ) {
+    strncpy ( ctx->error, errorMessage (), BUF_SIZE - 1 );
+    ctx->error[ BUF_SIZE - 1 ] = '\0';
+    dropMaps ( ctx );
+  } else err = ctx->status;
+
+  swapRegistry ( &(ctx->reg) );
+  tmp       = data;
+  data      = ctx->data;
+  ctx->data = tmp;
+
+  active = NULL;
+  pthread_mutex_unlock ( &(ctx->lock) );
+  return err;
+} /* end leaveContext */
+
+static void
+dropMaps ( gplContext *ctx )
+{
+  /* maps made for other maps can be linked in ahead of the list head */
+  while ( data.maps && data.maps->prev ) data.maps = data.maps->prev;
+  while ( data.maps )
+    data.maps = freeMap ( &(data.maps) );
+  freeRegistry ();
+  freeFiles ( &(ctx->files) );
+  ctx->written = NULL;
+
+  /* the input is read again when it is next needed */
+  if ( ctx->in.path ) ctx->in.type |= FTF_READ;
+} /* end dropMaps */
+
+static void
+dropInput ( gplContext *ctx )
+{
+  freeFiles ( &(ctx->input) );
+  free ( ctx->in.path );
+  memset ( &(ctx->in), 0, sizeof ( mapIOData ));
+} /* end dropInput */
+
+static void
+freeFiles ( memFile **files )
+{
+  memFile *f;
+
+  while (( f = *files )) {
+    *files = f->next;
+    free ( f->path );
+    free ( f->buf );
+    free ( f );
+  }
+} /* end freeFiles */
+
+static FILE *
+memOpen ( char *path, const char *mode )
+{
+  memFile *f;
+
+  /* a job writing - catch it in memory */
+  if ( mode[0] == 'w' ) {
+    if ( !( f = (memFile *) calloc ( sizeof ( memFile ), 1 )))
+      shutdown ( EF_MALLOC, "Error creating memory file\n" );
+    f->path = dupString ( path );
+    f->next = active->files;
+    active->files   = f;
+    active->written = f;
+    return open_memstream ( &(f->buf), &(f->size) );
+  }
+
+  /* the input, if it was passed in a buffer, otherwise a real file */
+  if (( f = active->input ) && !strcmp ( f->path, path ))
+    return fmemopen ( f->buf, f->size, mode );
+  return fopen ( path, mode );
+} /* end memOpen */
+
+/************************************  building              ************************/
+
+static void
+loadInput ( gplContext *ctx, const char *path, const void *buf, size_t size )
+{
+  int vtype;
+  int level;
+
+  /* the maps of the last input go */
+  dropMaps ( ctx );
+  dropInput ( ctx );
+
+  if ( buf ) {
+    if ( !( ctx->input = (memFile *) calloc ( sizeof ( memFile ), 1 )) ||
+	 !( ctx->input->buf = (char *) malloc ( size )))
+      shutdown ( EF_MALLOC, "Error copying %s\n", path );
+    ctx->input->path = dupString ( (char *) path );
+    ctx->input->size = size;
+    memcpy ( ctx->input->buf, buf, size );
+  }
+  else {
+    FILE *fp;
+
+    /* a file that is not there is not a bad name */
+    if ( !( fp = fopen ( path, "rb" )))
+      shutdown ( EF_FILE_OPEN, "Error opening %s\n", path );
+    fclose ( fp );
+  }
+
+  /* the name says what it is, as it does for the program */
+  data.readflag = RF_NONE;
+  if ( !isPathmapFile ( (char *) path, &vtype, &level ))
+    shutdown ( EF_FILE_NAME, "Not a search map: %s\n", path );
+
+  switch ( data.readflag )
+    {
+    case RF_BMP:
+      ctx->in.type = FTF_IMG | FTF_MAP;
+      break;
+    case RF_RAW:
+      ctx->in.type = FTF_IMG | FTF_RAW | FTF_MAP;
+      break;
+    case RF_MAP:
+      ctx->in.type = FTF_MAP;
+      break;
+    default:
+      level = -1;
+    }
+  if ( level )
+    shutdown ( EF_NOT_SUPPORTED, "Only level 0 search maps can be loaded: %s\n", path );
+
+  ctx->in.path    = dupString ( (char *) path );
+  ctx->in.type   |= FTF_READ;
+  ctx->in.vehicle = vtype;
+  ctx->in.level   = 0;
+
+  /* read it now, so a bad file is found here */
+  setMapSource ( &(ctx->in) );
+  if ( !getMap ( &(data.maps), &(ctx->in), NULL ))
+    shutdown ( EF_FILE_OPEN, "Error opening %s\n", path );
+} /* end loadInput */
+
+static pathfindingmap *
+makeMap ( gplContext *ctx, int type, int level )
+{
+  mapIOData out;
+  pathfindingmap *map;
+  int i;
+
+  memset ( &out, 0, sizeof ( out ));
+  out.path    = data.outpath;
+  out.vehicle = ctx->in.vehicle;
+  setMapSource ( &(ctx->in) );
+
+  /* a level is compressed from the one below - the program makes them in
+   * order, here they can be asked for in any order */
+  out.type = FTF_MAP;
+  for ( i = 1; i < level; i++ ) {
+    out.level = i;
+    if ( !getMap ( &(data.maps), &(ctx->in), &out ))
+      shutdown ( EF_FILE_OPEN, "Error opening %s\n", ctx->in.path );
+  }
+
+  out.type  = type;
+  out.level = level;
+  if ( !( map = getMap ( &(data.maps), &(ctx->in), &out )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s\n", ctx->in.path );
+  return map;
+} /* end makeMap */
+
+static void
+getOutput ( gplContext *ctx, int what, int level, int flags,
+	    void *buf, size_t size, size_t *needed )
+{
+  *needed = 0;
+  if ( !ctx->in.path )
+    shutdown ( EF_DATA_MISSING, "No search map has been loaded\n" );
+
+  switch ( what )
+    {
+    case FTF_MAP:
+      if ( !INRANGE ( level, 0, ISSEA ( ctx->in.vehicle ) ? 5 : 2 )) {
+	ctx->status = EF_NOT_FOUND;
+	sprintf ( ctx->error, "There is no level %d %s map\n",
+		  level, baseName[ ctx->in.vehicle ] );
+	return;
+      }
+      break;
+    case FTF_INFO:
+      level = ISSEA ( ctx->in.vehicle ) ? 3 : 1;
+      break;
+    case FTF_SO:
+      level = 0;
+      break;
+    default:
+      ctx->status = EF_USAGE;
+      sprintf ( ctx->error, "Ask for one of GPL_MAP, GPL_INFO or GPL_SO\n" );
+      return;
+    }
+
+  /* asking for the size first, then the file, only makes it once */
+  if ( !ctx->written || ( ctx->lastWhat != what ) ||
+       ( ctx->lastLevel != level ) || ( ctx->lastFlags != flags )) {
+    freeFiles ( &(ctx->files) );
+    ctx->written = NULL;
+    makeMap ( ctx, what | flags, level );
+    if ( !ctx->written )
+      shutdown ( EF_FILE_WRITE, "Nothing was written for %s\n", ctx->in.path );
+    ctx->lastWhat  = what;
+    ctx->lastLevel = level;
+    ctx->lastFlags = flags;
+  }
+
+  *needed = ctx->written->size;
+  if ( !buf ) return;
+  if ( size < ctx->written->size ) {
+    ctx->status = EF_MEM_OVERRUN;
+    sprintf ( ctx->error, "%lu bytes are needed\n", (unsigned long) ctx->written->size );
+    return;
+  }
+  memcpy ( buf, ctx->written->buf, ctx->written->size );
+} /* end getOutput */
+
+#else /* IS_UNIX */
+
+gplContext *
+gplCreate ( int threads )
+{
+  return NULL;
+} /* end gplCreate */
+
+/* there is never a context, but a caller that doesn't check gets told */
+void
+gplDestroy ( gplContext *ctx )
+{
+} /* end gplDestroy */
+
+int
+gplLoadFile ( gplContext *ctx, const char *path )
+{
+  return EF_NOT_SUPPORTED;
+} /* end gplLoadFile */
+
+int
+gplLoadBuffer ( gplContext *ctx, const char *name, const void *buf, size_t size )
+{
+  return EF_NOT_SUPPORTED;
+} /* end gplLoadBuffer */
+
+int
+gplBuild ( gplContext *ctx )
+{
+  return EF_NOT_SUPPORTED;
+} /* end gplBuild */
+
+int
+gplGetFile ( gplContext *ctx, int what, int level,
+	     void *buf, size_t size, size_t *needed )
+{
+  return EF_NOT_SUPPORTED;
+} /* end gplGetFile */
+
+int
+gplGetImage ( gplContext *ctx, int what, int level, int flags,
+	      void *buf, size_t size, size_t *needed )
+{
+  return EF_NOT_SUPPORTED;
+} /* end gplGetImage */
+
+const char *
+gplError ( gplContext *ctx )
+{
+  return "The library needs a unix build";
+} /* end gplError */
+
+void
+libraryRecover ( int err )
+{
+} /* end libraryRecover */
+
+#endif /* IS_UNIX */
@@ -0,0 +1,49 @@
+/* library.h - the library context
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __LIBRARY_H__
+#define __LIBRARY_H__
+
+
+/************************************  macros                 ***********************/
+
+/* where the library's files are written - they never reach the disk */
+#define LIBRARY_DIR "memory"
+
+/************************************  structures and enums  ************************/
+
+/* a file kept in memory, handed over by the caller or written by a job */
+typedef struct _memFile
+{
+  char             *path;
+  char             *buf;
+  size_t            size;
+  struct _memFile  *next;
+} memFile;
+
+/************************************  prototypes             ***********************/
+
+void            libraryRecover  ( int err );
+
+#endif /* __LIBRARY_H__ */
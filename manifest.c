@@ -0,0 +1,537 @@
+/* manifest.c - sizes and checksums of the files written
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -o, Manifest.txt in the output directory lists each map, smallOnes,
+ * info, text and image file the run wrote with its size and CRC32C, so a
+ * deploy can tell which files changed and a server which ones arrived
+ * broken. files listed by an earlier run into the same directory stay
+ * listed. -O manifest checks the files in the input directory against one.
+ *
+ * files are opened through data.opener, which on glibc wraps them with
+ * fopencookie: the checksum is worked out as the bytes are written, not by
+ * reading the file again. a bitmap's header is written a second time once
+ * its run length data is done, so the first MANIFEST_HEAD bytes are kept
+ * aside until the file closes and the checksum of the rest is joined on.
+ * files linked from the cache (-c), or written where there is no
+ * fopencookie, are read once when the manifest is written.
+ *
+ * the CRC uses the sse4.2 crc32 instruction where the cpu has it, and
+ * slice-by-8 tables where it doesn't. pyramid tiles and the reports are
+ * not listed.
+ */
+
+/* fopencookie is a GNU extension */
+#define _GNU_SOURCE
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "manifest.h"
+
+/************************************  global variables      ************************/
+
+extern THREAD_LOCAL userData data;
+
+static manifestEntry *entries = NULL;
+static unsigned int   crcTable[8][256];
+static int            crcTableMade = FALSE;
+
+/************************************  prototypes             ***********************/
+
+static manifestEntry *findEntry    ( char *path );
+static manifestEntry *addEntry     ( char *path );
+static void           keepOld      ( void );
+static int            parseLine    ( char *line, unsigned int *crc, long long *size, char *name );
+static long long      sizeOf       ( char *path );
+static int            crcFile      ( char *path, unsigned int *crc, long long *size );
+static int            byName       ( const void *a, const void *b );
+static void           makeTable    ( void );
+#ifdef HAS_SSE42_CRC
+static unsigned int   crcSse42     ( unsigned int crc, const unsigned char *buf, size_t len );
+#endif
+#ifdef HAS_COOKIE_FILES
+static ssize_t        streamWrite  ( void *cookie, const char *buf, size_t size );
+static int            streamSeek   ( void *cookie, off64_t *offset, int whence );
+static int            streamClose  ( void *cookie );
+static unsigned int   crcCombine   ( unsigned int crc1, unsigned int crc2, long long len2 );
+static unsigned int   multModP     ( unsigned int a, unsigned int b );
+static unsigned int   zeroBytes    ( long long len );
+
+static cookie_io_functions_t streamFuncs = { NULL, streamWrite, streamSeek, streamClose };
+#endif
+
+/************************************  functions             ************************/
+
+FILE *
+manifestOpen ( char *path, const char *mode )
+{
+#ifdef HAS_COOKIE_FILES
+  manifestStream *s;
+  FILE *fp;
+#endif
+
+  if ( mode[0] != 'w' ) return fopen ( path, mode );
+
+  /* openFile leaves this to the opener - the old file may be a link into
+   * the cache */
+  remove ( path );
+
+#ifdef HAS_COOKIE_FILES
+  if ( !( s = (manifestStream *) calloc ( sizeof ( manifestStream ), 1 )))
+    shutdown ( EF_MALLOC, "Error creating manifest stream\n" );
+  if ( !( s->fp = fopen ( path, mode ))) {
+    free ( s );
+    return NULL;
+  }
+  if ( !( fp = fopencookie ( s, mode, streamFuncs ))) {
+    fclose ( s->fp );
+    free ( s );
+    return NULL;
+  }
+  s->path = dupString ( path );
+  return fp;
+#else
+  manifestAdd ( path );
+  return fopen ( path, mode );
+#endif
+} /* end manifestOpen */
+
+/* a file that got to the output directory without being written - it is
+ * read when the manifest is */
+void
+manifestAdd ( char *path )
+{
+  addEntry ( path )->known = FALSE;
+} /* end manifestAdd */
+
+static manifestEntry *
+findEntry ( char *path )
+{
+  manifestEntry *entry;
+
+  for ( entry = entries; entry; entry = entry->next )
+    if ( !strcmp ( entry->path, path )) return entry;
+  return NULL;
+} /* end findEntry */
+
+static manifestEntry *
+addEntry ( char *path )
+{
+  manifestEntry *entry;
+
+  /* written again - a watched input, or -U */
+  if (( entry = findEntry ( path ))) return entry;
+
+  if ( !( entry = (manifestEntry *) calloc ( sizeof ( manifestEntry ), 1 )))
+    shutdown ( EF_MALLOC, "Error creating manifest entry\n" );
+  entry->path = dupString ( path );
+  entry->next = entries;
+  entries     = entry;
+  return entry;
+} /* end addEntry */
+
+void
+writeManifest ( void )
+{
+  char buffer[ BUF_SIZE ];
+  manifestEntry **list;
+  manifestEntry *entry;
+  FILE *fp;
+  int count = 0;
+  int i;
+
+  if ( !entries ) return;
+  keepOld ();
+
+  for ( entry = entries; entry; entry = entry->next ) count++;
+
+  if ( !( list = (manifestEntry **) malloc ( sizeof ( manifestEntry * ) * count )))
+    shutdown ( EF_MALLOC, "Error sorting the manifest\n" );
+  for ( i = 0, entry = entries; entry; entry = entry->next ) list[ i++ ] = entry;
+  qsort ( list, count, sizeof ( manifestEntry * ), byName );
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_MANIFEST, data.outpath, PATHSEP );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+  fprintf ( fp, "# crc32c size file%s", LINEFEED );
+
+  for ( i = 0; i < count; i++ ) {
+    entry = list[i];
+    if ( !entry->known ) {
+      if ( !crcFile ( entry->path, &(entry->crc), &(entry->size) )) {
+	debug ( DBG_WARN, "Error reading %s for the manifest\n", entry->path );
+	continue;
+      }
+      entry->known = TRUE;
+    }
+    fprintf ( fp, "%08x %lld %s%s", entry->crc, entry->size, fileName ( entry->path ), LINEFEED );
+  }
+
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing %s\n", buffer );
+  free ( list );
+
+  debug ( DBG_NOTICE, "%d files listed in %s\n", count, buffer );
+} /* end writeManifest */
+
+/* a mod is often built one input at a time into the same directory - the
+ * files an earlier run listed stay listed, as long as they are still there
+ * at the same size */
+static void
+keepOld ( void )
+{
+  char line[ BUF_SIZE ];
+  char name[ BUF_SIZE ];
+  char path[ BUF_SIZE ];
+  manifestEntry *entry;
+  unsigned int crc;
+  long long size;
+  FILE *fp;
+
+  snprintf ( path, BUF_SIZE, FILENAME_MANIFEST, data.outpath, PATHSEP );
+  if ( !( fp = fopen ( path, "r" ))) return;
+
+  while ( fgets ( line, BUF_SIZE, fp )) {
+    if ( parseLine ( line, &crc, &size, name ) != TRUE ) continue;
+    if ( snprintf ( path, BUF_SIZE, "%s%c%s", data.outpath, PATHSEP, name ) >= BUF_SIZE ) {
+      debug ( DBG_WARN, "%s: path too long, dropped from the manifest\n", name );
+      continue;
+    }
+    if ( findEntry ( path ) || ( sizeOf ( path ) != size )) continue;
+
+    entry        = addEntry ( path );
+    entry->crc   = crc;
+    entry->size  = size;
+    entry->known = TRUE;
+  }
+  fclose ( fp );
+} /* end keepOld */
+
+/* TRUE for a file, FALSE for a comment or blank line, -1 if it can't be read */
+static int
+parseLine ( char *line, unsigned int *crc, long long *size, char *name )
+{
+  if (( line[0] == '#' ) || ( line[0] == '\r' ) || ( line[0] == '\n' )) return FALSE;
+  if ( sscanf ( line, "%8x %lld %255[^\r\n]", crc, size, name ) != 3 ) return -1;
+  return TRUE;
+} /* end parseLine */
+
+static long long
+sizeOf ( char *path )
+{
+  long long size = -1;
+  FILE *fp;
+
+  if ( !( fp = fopen ( path, READ_MODE ))) return -1;
+  if ( !fseek ( fp, 0, SEEK_END )) size = ftell ( fp );
+  fclose ( fp );
+  return size;
+} /* end sizeOf */
+
+static int
+byName ( const void *a, const void *b )
+{
+  return strcmp ( (*(manifestEntry **) a)->path, (*(manifestEntry **) b)->path );
+} /* end byName */
+
+/* reads each file listed in the manifest once, and doesn't come back */
+void
+checkManifest ( void )
+{
+  char line[ BUF_SIZE ];
+  char name[ BUF_SIZE ];
+  char path[ BUF_SIZE ];
+  unsigned int want, crc;
+  long long wantSize, size;
+  int files = 0;
+  int bad = 0;
+  int ok;
+  FILE *fp;
+
+  if ( !data.inpath || !isDir ( data.inpath ))
+    shutdown ( EF_DATA_MISSING, "%cO checks the files in a directory\n", COMSEP );
+  if ( !( fp = fopen ( data.manifestPath, "r" )))
+    shutdown ( EF_FILE_OPEN, "Error opening manifest %s\n", data.manifestPath );
+
+  while ( fgets ( line, BUF_SIZE, fp )) {
+    if ( !( ok = parseLine ( line, &want, &wantSize, name ))) continue;
+    if ( ok < 0 ) {
+      debug ( DBG_WARN, "Bad manifest line: %s", line );
+      bad++;
+      continue;
+    }
+    files++;
+
+    /* a cut short path would check some other file */
+    if ( snprintf ( path, BUF_SIZE, "%s%c%s", data.inpath, PATHSEP, name ) >= BUF_SIZE )
+      debug ( DBG_WARN, "%s: path too long\n", name );
+    else if ( !crcFile ( path, &crc, &size ))
+      debug ( DBG_WARN, "%s: missing\n", name );
+    else if ( size != wantSize )
+      debug ( DBG_WARN, "%s: %lld bytes, the manifest has %lld\n", name, size, wantSize );
+    else if ( crc != want )
+      debug ( DBG_WARN, "%s: crc32c %08x, the manifest has %08x\n", name, crc, want );
+    else {
+      debug ( DBG_INFO, "%s: ok\n", name );
+      continue;
+    }
+    bad++;
+  }
+  fclose ( fp );
+
+  if ( bad )
+    shutdown ( EF_BAD_DATA, "%d of %d files don't match %s\n", bad, files, data.manifestPath );
+  debug ( DBG_NOTICE, "%d files match %s\n", files, data.manifestPath );
+  shutdown ( EF_NONE, "" );
+} /* end checkManifest */
+
+static int
+crcFile ( char *path, unsigned int *crc, long long *size )
+{
+  unsigned char *buf;
+  FILE *fp;
+  size_t len;
+
+  if ( !( fp = fopen ( path, READ_MODE ))) return FALSE;
+  if ( !( buf = (unsigned char *) malloc ( MANIFEST_BUF )))
+    shutdown ( EF_MALLOC, "Error creating manifest read buffer\n" );
+
+  *crc  = 0;
+  *size = 0;
+  while (( len = fread ( buf, 1, MANIFEST_BUF, fp ))) {
+    *crc   = crc32c ( *crc, buf, len );
+    *size += len;
+  }
+
+  fclose ( fp );
+  free ( buf );
+  return TRUE;
+} /* end crcFile */
+
+void
+freeManifest ( void )
+{
+  manifestEntry *entry;
+
+  while (( entry = entries )) {
+    entries = entry->next;
+    free ( entry->path );
+    free ( entry );
+  }
+} /* end freeManifest */
+
+/************************************  crc32c                ************************/
+
+unsigned int
+crc32c ( unsigned int crc, const unsigned char *buf, size_t len )
+{
+  unsigned long long word;
+  unsigned int lo, hi;
+#ifdef HAS_SSE42_CRC
+  static int sse42 = -1;
+
+  if ( sse42 < 0 ) sse42 = __builtin_cpu_supports ( "sse4.2" ) ? TRUE : FALSE;
+  if ( sse42 ) return ~crcSse42 ( ~crc, buf, len );
+#endif
+
+  if ( !crcTableMade ) makeTable ();
+
+  /* slice-by-8: eight table lookups a word. the files are little endian
+   * and so is the word */
+  crc = ~crc;
+  for ( ; len >= 8; len -= 8, buf += 8 ) {
+    memcpy ( &word, buf, 8 );
+    lo  = crc ^ (unsigned int) word;
+    hi  = (unsigned int) ( word >> 32 );
+    crc = crcTable[7][ lo & 0xff ] ^ crcTable[6][ ( lo >> 8 ) & 0xff ] ^
+	  crcTable[5][ ( lo >> 16 ) & 0xff ] ^ crcTable[4][ lo >> 24 ] ^
+	  crcTable[3][ hi & 0xff ] ^ crcTable[2][ ( hi >> 8 ) & 0xff ] ^
+	  crcTable[1][ ( hi >> 16 ) & 0xff ] ^ crcTable[0][ hi >> 24 ];
+  }
+  for ( ; len; len--, buf++ )
+    crc = crcTable[0][ ( crc ^ *buf ) & 0xff ] ^ ( crc >> 8 );
+  return ~crc;
+} /* end crc32c */
+
+static void
+makeTable ( void )
+{
+  unsigned int crc;
+  int n, k;
+
+  for ( n = 0; n < 256; n++ ) {
+    crc = n;
+    for ( k = 0; k < 8; k++ )
+      crc = ( crc & 1 ) ? ( crc >> 1 ) ^ CRC32C_POLY : crc >> 1;
+    crcTable[0][n] = crc;
+  }
+  /* table k moves a byte through k more zero bytes */
+  for ( n = 0; n < 256; n++ )
+    for ( k = 1; k < 8; k++ )
+      crcTable[k][n] = ( crcTable[k - 1][n] >> 8 ) ^ crcTable[0][ crcTable[k - 1][n] & 0xff ];
+  crcTableMade = TRUE;
+} /* end makeTable */
+
+#ifdef HAS_SSE42_CRC
+
+__attribute__ (( target ( "sse4.2" )))
+static unsigned int
+crcSse42 ( unsigned int crc, const unsigned char *buf, size_t len )
+{
+  unsigned long long c = crc;
+  unsigned long long word;
+
+  for ( ; len >= 8; len -= 8, buf += 8 ) {
+    memcpy ( &word, buf, 8 );
+    c = __builtin_ia32_crc32di ( c, word );
+  }
+  crc = (unsigned int) c;
+  for ( ; len; len--, buf++ )
+    crc = __builtin_ia32_crc32qi ( crc, *buf );
+  return crc;
+} /* end crcSse42 */
+
+#endif /* HAS_SSE42_CRC */
+
+/************************************  cookie streams        ************************/
+
+#ifdef HAS_COOKIE_FILES
+
+static ssize_t
+streamWrite ( void *cookie, const char *buf, size_t size )
+{
+  manifestStream *s = (manifestStream *) cookie;
+  const unsigned char *p = (const unsigned char *) buf;
+  size_t len;
+
+  if ( !size ) return 0;
+  if ( fwrite ( buf, size, 1, s->fp ) != 1 ) return 0;
+
+  /* the head is kept as it is written */
+  if ( s->pos < MANIFEST_HEAD ) {
+    if ( s->pos > s->headLen ) s->broken = TRUE;
+    len = MIN ( size, (size_t) ( MANIFEST_HEAD - s->pos ));
+    memcpy ( s->head + s->pos, p, len );
+    s->headLen = MAX ( s->headLen, s->pos + (long long) len );
+    s->pos += len;
+    p      += len;
+    size   -= len;
+  }
+
+  /* the rest is checksummed, as long as it comes in order */
+  if ( size ) {
+    if ( s->pos != MANIFEST_HEAD + s->tailLen ) s->broken = TRUE;
+    else {
+      s->tailCrc  = crc32c ( s->tailCrc, p, size );
+      s->tailLen += size;
+    }
+    s->pos += size;
+  }
+
+  s->end = MAX ( s->end, s->pos );
+  return ( p - (const unsigned char *) buf ) + size;
+} /* end streamWrite */
+
+static int
+streamSeek ( void *cookie, off64_t *offset, int whence )
+{
+  manifestStream *s = (manifestStream *) cookie;
+  long long pos;
+
+  switch ( whence )
+    {
+    case SEEK_SET:
+      pos = *offset;
+      break;
+    case SEEK_CUR:
+      pos = s->pos + *offset;
+      break;
+    default:
+      pos = s->end + *offset;
+    }
+  if (( pos < 0 ) || fseeko ( s->fp, pos, SEEK_SET )) return -1;
+
+  s->pos  = pos;
+  *offset = pos;
+  return 0;
+} /* end streamSeek */
+
+static int
+streamClose ( void *cookie )
+{
+  manifestStream *s = (manifestStream *) cookie;
+  manifestEntry *entry;
+  int ret;
+
+  ret = fclose ( s->fp );
+
+  entry = addEntry ( s->path );
+  entry->size  = s->end;
+  entry->crc   = crc32c ( 0, s->head, s->headLen );
+  if ( s->tailLen ) entry->crc = crcCombine ( entry->crc, s->tailCrc, s->tailLen );
+  /* written out of order - read it back */
+  entry->known = !s->broken;
+
+  free ( s->path );
+  free ( s );
+  return ret ? EOF : 0;
+} /* end streamClose */
+
+/* the crc of two blocks one after the other, from the crc of each */
+static unsigned int
+crcCombine ( unsigned int crc1, unsigned int crc2, long long len2 )
+{
+  return multModP ( zeroBytes ( len2 ), crc1 ) ^ crc2;
+} /* end crcCombine */
+
+/* a times b modulo the polynomial, both bit reversed */
+static unsigned int
+multModP ( unsigned int a, unsigned int b )
+{
+  unsigned int m;
+  unsigned int p = 0;
+
+  for ( m = 1U << 31; m; m >>= 1 ) {
+    if ( a & m ) p ^= b;
+    b = ( b & 1 ) ? ( b >> 1 ) ^ CRC32C_POLY : b >> 1;
+  }
+  return p;
+} /* end multModP */
+
+/* x to the 8 * len modulo the polynomial - what len zero bytes do to a crc */
+static unsigned int
+zeroBytes ( long long len )
+{
+  unsigned int p  = 1U << 31;     /* x^0 */
+  unsigned int sq = 1U << 23;     /* x^8 */
+
+  for ( ; len; len >>= 1 ) {
+    if ( len & 1 ) p = multModP ( sq, p );
+    sq = multModP ( sq, sq );
+  }
+  return p;
+} /* end zeroBytes */
+
+#endif /* HAS_COOKIE_FILES */
@@ -0,0 +1,88 @@
+/* manifest.h - sizes and checksums of the files written
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __MANIFEST_H__
+#define __MANIFEST_H__
+
+
+/************************************  macros                 ***********************/
+
+/* fopencookie is glibc only - elsewhere the files are read back to be
+ * checksummed */
+#if defined ( IS_UNIX ) && defined ( __linux__ )
+  #define HAS_COOKIE_FILES
+#endif
+
+/* the crc32 instruction came with sse4.2 - it is used if the cpu has it */
+#if defined ( __GNUC__ ) && defined ( __x86_64__ )
+  #define HAS_SSE42_CRC
+#endif
+
+/* the castagnoli polynomial, bit reversed */
+#define CRC32C_POLY     0x82f63b78
+
+/* the first bytes of a file may be written again - a bitmap header filled
+ * in once the run length data is done. they are kept until the file is
+ * closed, the rest is checksummed as it goes by */
+#define MANIFEST_HEAD   4096
+
+/* read this much at a time when a file has to be read */
+#define MANIFEST_BUF    65536
+
+/************************************  structures and enums  ************************/
+
+/* one file written */
+typedef struct _manifestEntry
+{
+  char                   *path;
+  long long               size;
+  unsigned int            crc;
+  int                     known;     /* crc and size were worked out as it was written */
+  struct _manifestEntry  *next;
+} manifestEntry;
+
+/* a file being written through fopencookie */
+typedef struct _manifestStream
+{
+  FILE           *fp;
+  char           *path;
+  unsigned char   head[ MANIFEST_HEAD ];
+  long long       headLen;
+  long long       pos;
+  long long       end;
+  unsigned int    tailCrc;
+  long long       tailLen;
+  int             broken;    /* written out of order past the head */
+} manifestStream;
+
+/************************************  prototypes             ***********************/
+
+FILE           *manifestOpen     ( char *path, const char *mode );
+void            manifestAdd      ( char *path );
+void            writeManifest    ( void );
+void            checkManifest    ( void );
+void            freeManifest     ( void );
+unsigned int    crc32c           ( unsigned int crc, const unsigned char *buf, size_t len );
+
+#endif /* __MANIFEST_H__ */
@@ -26,10 +26,14 @@
 
 #include "common.h"
 #include "commonutils.h"
+#include "registry.h"
+#include "update.h"
+#include "manifest.h"
+#include "pyramid.h"
 
-extern int freeInpath;
+extern THREAD_LOCAL int freeInpath;
 extern int freeOutpath;
-extern userData data;
+extern THREAD_LOCAL userData data;
 extern char *baseName[];
 
 /************************************  functions             ************************/
@@ -48,9 +52,40 @@ freeAll ( void )
     free ( data.outpath );
     data.outpath = NULL;
   }
+  if ( data.cachepath ) {
+    free ( data.cachepath );
+    data.cachepath = NULL;
+  }
+  if ( data.shmName ) {
+    free ( data.shmName );
+    data.shmName = NULL;
+  }
+  if ( data.queryPath ) {
+    free ( data.queryPath );
+    data.queryPath = NULL;
+  }
+  if ( data.verifyPath ) {
+    free ( data.verifyPath );
+    data.verifyPath = NULL;
+  }
+  if ( data.checkPath ) {
+    free ( data.checkPath );
+    data.checkPath = NULL;
+  }
+  if ( data.diffPath ) {
+    free ( data.diffPath );
+    data.diffPath = NULL;
+  }
+  if ( data.manifestPath ) {
+    free ( data.manifestPath );
+    data.manifestPath = NULL;
+  }
   if ( data.maps )
     while ( data.maps )
       data.maps = freeMap ( &(data.maps) );
+  freeRegistry ();
+  freeUpdate ();
+  freeManifest ();
 
   if ( data.jobs )
     while ( data.jobs ) {
@@ -110,12 +145,13 @@ pathfindingmap *
 freeMap ( pathfindingmap **map )
 {
   int i, j;
+  int isHead;
   pathfindingmap *retMap = NULL;
 
   if ( !map || !*map ) return NULL;
   /* set return area, if there is one */
-  if ( (*map)->next ) retMap = (*map)->next;
-  else if ( (*map)->prev ) retMap = (*map)->prev;
+  retMap = (*map)->next;
+  unregisterMap ( *map );
 
 
   /* close file if open */
@@ -130,12 +166,14 @@ freeMap ( pathfindingmap **map )
   }
   /* free smallOnes buffer, if needed */
   if ( (*map)->so ) free ( (*map)->so );
+  /* free tiles changed since the last run */
+  if ( (*map)->dirty ) free ( (*map)->dirty );
   /* tile image data could have buffers attached
    * - free them, then the image data buffer */
   if ( (*map)->img ) {
     for ( i = 0; i < (*map)->tiles; i++ ) {
       for ( j = 0; j < 4; j++ ) {
-	if ( (*map)->img->pt[j] ) free ( (*map)->img->pt[j] );
+	if ( (*map)->img[i].pt[j] ) free ( (*map)->img[i].pt[j] );
       }
     }
     free ( (*map)->img );
@@ -144,17 +182,24 @@ freeMap ( pathfindingmap **map )
   if ( (*map)->buf ) free ( (*map)->buf );
   /* free 8 bit in/out buffer */
   if ( (*map)->bmp ) free ( (*map)->bmp );
+  /* free smallOnes image lines */
+  freeSegmentBins ( &((*map)->lines) );
+  /* an image that was being written when the build failed */
+  if ( (*map)->rle ) free ( (*map)->rle );
+  if ( (*map)->png ) free ( (*map)->png );
+  freePyramid ( *map );
 
   /* unlink and free map */
   if ( (*map)->prev ) (*map)->prev->next = (*map)->next;
   if ( (*map)->next ) (*map)->next->prev = (*map)->prev;
+  isHead = ( data.maps == *map );
 
   /* free map */
   free ( (*map) );
-/*  (*map) = retMap; */
+  if ( isHead ) data.maps = retMap;
 
-  /* return map list, if there is one */
-  return (NULL);
+  /* return the rest of the map list, if there is one */
+  return ( retMap );
 }
 
 tileArea *
@@ -233,6 +278,18 @@ freeLineList ( lineList **lines )
   }
 }
 
+void
+freeSegmentBins ( segmentBins **bins )
+{
+  if ( !*bins ) return;
+
+  if ( (*bins)->start ) free ( (*bins)->start );
+  if ( (*bins)->index ) free ( (*bins)->index );
+  if ( (*bins)->seg   ) free ( (*bins)->seg );
+  free ( *bins );
+  *bins = NULL;
+}
+
 void
 freeTiles ( pathfindingmap *map, tileData **tile )
 {
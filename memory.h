@@ -39,6 +39,7 @@ tileArea        *newArea      ( int dimX, int dimY );
 lineList        *newLine      ( int row, int begin, int end );
 void             freeAreaList ( tileArea **area );
 void             freeLineList ( lineList **lines );
+void             freeSegmentBins ( segmentBins **bins );
 void             freeTiles    ( pathfindingmap *map, tileData **tile );
 tileData        *copyTiles    ( pathfindingmap *map );
 char            *dupString    ( char *str );
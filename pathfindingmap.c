@@ -30,11 +30,22 @@
 #include "smallones.h"
 #include "image.h"
 #include "textfile.h"
+#include "thumbnail.h"
+#include "registry.h"
+#include "update.h"
+#include "islands.h"
 
 /************************************  global variables      ************************/
 
 extern char *baseName[];
 extern char *inputType[];
+extern THREAD_LOCAL userData data;
+
+/* the map being read, and the buffers its loader is holding. when a read
+ * fails and shutdown goes back to the watcher rather than exiting, they
+ * are let go of by dropLoad - the map was never linked to the others */
+static THREAD_LOCAL pathfindingmap *loading = NULL;
+static THREAD_LOCAL void           *scratch[ LOAD_SCRATCH ];
 
 /************************************  functions             ************************/
 
@@ -52,7 +63,7 @@ getMap ( pathfindingmap **maps, mapIOData *src, mapIOData *dst )
   /* search list first - might already be open */
   if ( *maps ) {
     /* if the destination image exists return it */
-    if ( dst && ( map = findMap ( *maps, *dst ))) {
+    if ( dst && ( map = findMap ( *dst ))) {
       type = findLn2 ( IMGTYPES(dst->type));
       debug ( DBG_NOTICE,
 	      "Retrieving %s %s level %d map\n",
@@ -60,9 +71,13 @@ getMap ( pathfindingmap **maps, mapIOData *src, mapIOData *dst )
       if ( !dst ) return map;
     }
     /* if the source image exists, use it */
-    map = findMap ( *maps, *src );
+    map = findMap ( *src );
   }
 
+  /* a map freed to stay under the memory budget is made again */
+  if ( !map && !( src->type & FTF_READ ))
+    map = rebuildMap ( src );
+
   /* if map doesn't exist, create one */
   if ( !map ) {
     type = findLn2 ( IMGTYPES(src->type));
@@ -84,13 +99,18 @@ getMap ( pathfindingmap **maps, mapIOData *src, mapIOData *dst )
 	      "Loading %s %s level %01d file from: %s\n",
 	      baseName[src->vehicle], inputType[type], src->level, src->path );
       /* try to load the map */
+      loading = map;
       if ( loadFile ( map )) {
 	/* that worked, link it to the others */
+	loading = NULL;
 	linkMaps ( maps, map );
 	src->type    &= ~FTF_READ;
 	map->io.type &= ~FTF_READ;
+	/* find what changed since the last run */
+	markDirtyTiles ( map );
       } else {
 	/* map didn't load - free map structure and return empty handed */
+	loading = NULL;
 	free ( map );
 	return NULL;
       }
@@ -158,9 +178,44 @@ getMap ( pathfindingmap **maps, mapIOData *src, mapIOData *dst )
     }
   }
 
+  if ( map ) touchMap ( map );
   return map;
 } /* end getMap */
 
+void
+getMapSet ( mapIOData *in, pathfindingmap **set )
+{
+  mapIOData out = {0};
+  int level;
+
+  if ( !( in->type & FTF_MAP ) || in->level )
+    shutdown ( EF_NOT_SUPPORTED, "Only a level 0 search map makes a set of maps\n" );
+
+  /* made the way the jobs make them, but nothing is written */
+  setMapSource ( in );
+  out.path    = data.outpath;
+  out.vehicle = in->vehicle;
+
+  for ( level = 0; level <= MAX_LEVEL; level++ ) {
+    set[level] = NULL;
+    if ( level > ( ISSEA ( in->vehicle ) ? 5 : 2 )) continue;
+    out.type  = FTF_MAP;
+    out.level = level;
+    if ( !( set[level] = getMap ( &(data.maps), in, &out )))
+      shutdown ( EF_FILE_READ, "Error loading %s\n", in->path );
+    /* small maps run out of tiles before the last level */
+    if ( !set[level]->tiles ) set[level] = NULL;
+  }
+
+  out.type  = FTF_INFO;
+  out.level = ISSEA ( in->vehicle ) ? 3 : 1;
+  set[ SET_INFO ] = getMap ( &(data.maps), in, &out );
+
+  out.type  = FTF_SO;
+  out.level = 0;
+  set[ SET_SO ] = getMap ( &(data.maps), in, &out );
+} /* end getMapSet */
+
 void
 writeMap ( pathfindingmap *map )
 {
@@ -172,11 +227,19 @@ writeMap ( pathfindingmap *map )
   /* make sure there is a place to write too */
   if ( ! map || ! map->io.path ) return;
 
+  /* pyramids are a directory of tiles rather than one file */
+  if (( map->io.type & FTF_IMG ) && ( map->io.type & FTF_PYRAMID ) &&
+      !isThumbImage ( map )) {
+    writeImageFile ( map );
+    return;
+  }
+
   /* open the file for writing */
   if ( !( openFile ( map, WRITE_MODE ))) return;
 
   /* output either an 8 bit or compressed map */
-  if ( map->io.type & FTF_IMG ) writeImageFile ( map );
+  if ( isThumbImage ( map )) writeThumbnail ( map );
+  else if ( map->io.type & FTF_IMG ) writeImageFile ( map );
   else {
     switch ( IMGTYPES(map->io.type))
       {
@@ -267,9 +330,11 @@ loadFile ( pathfindingmap *map )
 	break;
       case FTF_SO:
 	loadSmallOnes ( map );
+	findIslands ( map );
 	break;
       case FTF_TXT:
 	loadSmallOnesText ( map );
+	findIslands ( map );
 	break;
       }
   }
@@ -285,6 +350,7 @@ void
 loadMapFile ( pathfindingmap *map )
 {
   char *filename;
+  int window;
   int i;
   mapFileHeader header;
 
@@ -333,6 +399,9 @@ loadMapFile ( pathfindingmap *map )
     shutdown ( EF_MALLOC,
 	       "Error creating tile data buffer for: %s\n", filename );
 
+  /* only a piece of the map might be wanted */
+  if (( window = isWindowLoad ( map ))) setImageWindow ( map );
+
   /* load file information into the array */
   for ( i = 0; i < map->tiles; i++ ) {
     if ( !fread ( &( map->tile[i].flag ), 4, 1, map->fp ))
@@ -344,6 +413,13 @@ loadMapFile ( pathfindingmap *map )
       case TDT_NOGO:
 	break;
       case TDT_MIXED:
+	/* tiles outside the window are passed over */
+	if ( window && !IN_WINDOW ( map, i % map->tilesPerRow, i / map->tilesPerRow )) {
+	  if ( fseek ( map->fp, map->bytesPerTile, SEEK_CUR ) == -1 )
+	    shutdown ( EF_FILE_READ,
+		       "Error seeking data in file: %s\n", filename );
+	  break;
+	}
 	/* data to follow - create record and fill it from file */
 	if ( !( map->tile[i].bits = ( unsigned char *) calloc ( map->bytesPerTile, 1 )))
 	  shutdown ( EF_MALLOC,
@@ -360,25 +436,131 @@ loadMapFile ( pathfindingmap *map )
   free ( filename );
 } /* end loadMapFile */
 
+void
+loadPatchBase ( pathfindingmap *map )
+{
+  mapIOData  io = {0};
+  FILE      *fp;
+  char      *filename;
+
+  /* the map being patched is the one already in the output directory */
+  copyIO ( &io, map->io );
+  fp = map->fp;
+  map->io.path = data.outpath;
+  map->io.type = FTF_MAP;
+  filename = fullPath ( map );
+
+  debug ( DBG_NOTICE, "Patching %s tiles %d,%d to %d,%d into: %s\n",
+	  baseName[map->io.vehicle],
+	  data.region.x0, data.region.y0, data.region.x1, data.region.y1,
+	  filename );
+
+  if ( !( map->fp = fopen ( filename, READ_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening map to patch: %s\n", filename );
+  loadMapFile ( map );
+  fclose ( map->fp );
+  free ( filename );
+
+  map->fp = fp;
+  copyIO ( &(map->io), io );
+  setImageWindow ( map );
+} /* end loadPatchBase */
+
+/* a map, smallOnes or text file read on its own, not one of the maps -
+ * for checking or comparing. NULL if there is no such file, or no tiles */
+pathfindingmap *
+readMapFile ( char *path, fileTypeFlag type, vehicleType vehicle, int level )
+{
+  pathfindingmap *map;
+
+  if ( !isFile ( path )) return NULL;
+  if ( !( map = (pathfindingmap *) calloc ( sizeof ( pathfindingmap ), 1 )))
+    shutdown ( EF_MALLOC, "Memory allocation error reading %s\n", path );
+  map->io.path    = path;
+  map->io.type    = type;
+  map->io.vehicle = vehicle;
+  map->io.level   = level;
+
+  loading = map;
+  if ( !openFile ( map, READ_MODE ))
+    shutdown ( EF_FILE_OPEN, "Error opening %s\n", path );
+
+  /* the last levels of small maps are written with no tiles */
+  if (( IMGTYPES ( type ) & ( FTF_MAP | FTF_INFO )) &&
+      ( fileSize ( map ) <= (int) sizeof ( mapFileHeader ) + 8 )) {
+    loading = NULL;
+    fclose ( map->fp );
+    free ( map );
+    return NULL;
+  }
+
+  switch ( IMGTYPES ( type ))
+    {
+    case FTF_SO:
+      loadSmallOnes ( map );
+      break;
+    case FTF_TXT:
+      loadSmallOnesText ( map );
+      break;
+    default:
+      loadMapFile ( map );
+    }
+  fclose ( map->fp );
+  map->fp      = NULL;
+  map->io.path = NULL;
+
+  if (( IMGTYPES ( type ) & ( FTF_SO | FTF_TXT )) && !map->so )
+    shutdown ( EF_BAD_FILE, "No smallOnes were read from %s\n", path );
+  loading = NULL;
+  return map;
+} /* end readMapFile */
+
+/* a buffer for the length of a load, let go of if the load fails */
+void *
+loadBuffer ( size_t size )
+{
+  int i;
+
+  for ( i = 0; ( i < LOAD_SCRATCH ) && scratch[i]; i++ );
+  if ( i == LOAD_SCRATCH )
+    shutdown ( EF_FUNCTION_ERR, "Too many load buffers held at once\n" );
+  return ( scratch[i] = malloc ( size ));
+} /* end loadBuffer */
+
+void
+freeLoadBuffer ( void *buf )
+{
+  int i;
+
+  for ( i = 0; i < LOAD_SCRATCH; i++ )
+    if ( scratch[i] == buf ) scratch[i] = NULL;
+  free ( buf );
+} /* end freeLoadBuffer */
+
+/* a load went wrong - its file, map and buffers go */
+void
+dropLoad ( void )
+{
+  int i;
+
+  for ( i = 0; i < LOAD_SCRATCH; i++ ) {
+    if ( scratch[i] ) free ( scratch[i] );
+    scratch[i] = NULL;
+  }
+  if ( loading ) freeMap ( &loading );
+  loading = NULL;
+} /* end dropLoad */
+
 pathfindingmap *
 findInfo ( pathfindingmap *map )
 {
   pathfindingmap *soMap;
   pathfindingmap *infoMap;
   pathfindingmap *srcMap;
-  tileImageData  *img   = NULL;
-  tileData       *actTile = NULL;
-  tileData       *srcTile = NULL;
 
   mapIOData       io    = {0};
 
-  int tile, row, bits, level;
-  int srcByteOff, srcBitOff;
-  int byteOff, bitOff;
-  int pixSize;
-  int i, j, k, l;
-  int isDoGo;
-  int sum;
+  int tile;
 
   copyIO ( &io, map->io );
 
@@ -400,86 +582,110 @@ findInfo ( pathfindingmap *map )
   infoMap->bytesPerRow = ( srcMap->bytesPerRow >> ( io.level - 1 ));
   infoMap->bytesPerTile = infoMap->rowsPerTile * infoMap->bytesPerRow;
   infoMap->res = srcMap->res;
-  pixSize = 1 << infoMap->io.level;
+
+  /* only the changed tiles are needed when updating */
+  if ( updateInfo ( infoMap, soMap, srcMap->dirty )) return infoMap;
+  /* already made for another job */
+  if ( infoMap->tile ) return infoMap;
 
   if ( !( infoMap->tile = (tileData *) calloc ( sizeof ( tileData ) * infoMap->tiles, 1 )))
     shutdown ( EF_MALLOC,
 	       "Error allocating info tile buffer array in function findInfo\n" );
-  for ( tile = 0; tile < infoMap->tiles; tile++ ) {
-    actTile = &(infoMap->tile[tile]);
-    srcTile = &(soMap->tile[tile]);
-    if ( srcTile->flag != TDT_MIXED ) {
-      actTile->flag = srcTile->flag;
-      continue;
-    }
+  for ( tile = 0; tile < infoMap->tiles; tile++ )
+    infoTile ( infoMap, soMap, tile );
+
+  return infoMap;
+} /* end findInfo */
 
-    actTile->flag = TDT_MIXED;
-    img = &(soMap->img[tile]);
+void
+infoTile ( pathfindingmap *infoMap, pathfindingmap *soMap, int tile )
+{
+  tileImageData  *img   = NULL;
+  tileData       *actTile = NULL;
+  tileData       *srcTile = NULL;
 
-    if ( ! ( actTile->bits = (unsigned char *) malloc ( infoMap->bytesPerTile )))
-      shutdown ( EF_MALLOC,
-		 "Error allocating info tile buffer in function findInfo\n" );
-
-    memset ( actTile->bits, 0xff, infoMap->bytesPerTile );
-
-    for ( row = 0;
-	  row < TILE_DIM;
-	  row += pixSize ) {
-      for ( bits = 0;
-	    bits < soMap->bytesPerRow * 8;
-	    bits += pixSize ) {
-	for ( level = 0; level < 4; level++ ) {
-
-	  if ( ! img->pt[level] ) break;
-	  
-	  for ( i = 0; i < 2; i++ ) {
-	    for ( j = 0; j < 2; j++ ) {
-	      for ( k = 0; k < pixSize / 2; k++ ) {
-		isDoGo = TRUE;
-		for ( l = 0; l < pixSize / 2; l++ ) {
-		  srcByteOff = (( row + i * pixSize / 2 + k ) * soMap->bytesPerRow + 
-				( bits + j * pixSize / 2 + l ) / 8 );
-		  srcBitOff = ( bits + j * pixSize / 2 + l ) % 8;
-		  if ( img->pt[ level ][ srcByteOff ] & ( 1 << srcBitOff )) {
-		    isDoGo = FALSE;
-		    break;
-		  }
+  int row, bits, level;
+  int srcByteOff, srcBitOff;
+  int byteOff, bitOff;
+  int pixSize;
+  int i, j, k, l;
+  int isDoGo;
+  int sum;
+
+  pixSize = 1 << infoMap->io.level;
+
+  actTile = &(infoMap->tile[tile]);
+  srcTile = &(soMap->tile[tile]);
+  if ( srcTile->flag != TDT_MIXED ) {
+    actTile->flag = srcTile->flag;
+    return;
+  }
+
+  actTile->flag = TDT_MIXED;
+  img = &(soMap->img[tile]);
+
+  if ( ! ( actTile->bits = (unsigned char *) malloc ( infoMap->bytesPerTile )))
+    shutdown ( EF_MALLOC,
+	       "Error allocating info tile buffer in function findInfo\n" );
+
+  memset ( actTile->bits, 0xff, infoMap->bytesPerTile );
+
+  for ( row = 0;
+	row < TILE_DIM;
+	row += pixSize ) {
+    for ( bits = 0;
+	  bits < soMap->bytesPerRow * 8;
+	  bits += pixSize ) {
+      for ( level = 0; level < 4; level++ ) {
+
+	if ( ! img->pt[level] ) break;
+
+	for ( i = 0; i < 2; i++ ) {
+	  for ( j = 0; j < 2; j++ ) {
+	    for ( k = 0; k < pixSize / 2; k++ ) {
+	      isDoGo = TRUE;
+	      for ( l = 0; l < pixSize / 2; l++ ) {
+		srcByteOff = (( row + i * pixSize / 2 + k ) * soMap->bytesPerRow + 
+			      ( bits + j * pixSize / 2 + l ) / 8 );
+		srcBitOff = ( bits + j * pixSize / 2 + l ) % 8;
+		if ( img->pt[ level ][ srcByteOff ] & ( 1 << srcBitOff )) {
+		  isDoGo = FALSE;
+		  break;
 		}
-		if ( !isDoGo ) break;
-
-	      } /* end k loop */
-	      if ( isDoGo ) {
-		byteOff = (( row / ( pixSize )) * infoMap->bytesPerRow +
-			   ( bits / ( 1 << (infoMap->io.level ))) / 4 );
-		
-		bitOff  = ( bits / ( 1 << ( infoMap->io.level ))) % 4;
-		actTile->bits[byteOff] &= ~ (( 3 - level ) << ( bitOff * 2 ));
-		break;
 	      }
+	      if ( !isDoGo ) break;
+
+	    } /* end k loop */
+	    if ( isDoGo ) {
+	      byteOff = (( row / ( pixSize )) * infoMap->bytesPerRow +
+			 ( bits / ( 1 << (infoMap->io.level ))) / 4 );
+
+	      bitOff  = ( bits / ( 1 << ( infoMap->io.level ))) % 4;
+	      actTile->bits[byteOff] &= ~ (( 3 - level ) << ( bitOff * 2 ));
+	      break;
+	    }
 
-	      if ( isDoGo ) break;
-	    } /* end j loop */
 	    if ( isDoGo ) break;
-	  } /* end i loop */
-	} /* end level loop */
-      } /* end bit loop */
-    } /* end row loop */
-    sum = 0;
-    for ( i = 0; i < infoMap->bytesPerTile; i++ ) {
-      sum += actTile->bits[i];
-    }
-    if ( !sum ) {
-      actTile->flag = TDT_DOGO;
-      free ( actTile->bits );
-      actTile->bits = NULL;
-    } else if ( sum == infoMap->bytesPerTile * 255 ) {
-      actTile->flag = TDT_NOGO;
-      free ( actTile->bits );
-      actTile->bits = NULL;
-    }
-  } /* end tile loop */
-  return infoMap;
-} /* end findInfo */
+	  } /* end j loop */
+	  if ( isDoGo ) break;
+	} /* end i loop */
+      } /* end level loop */
+    } /* end bit loop */
+  } /* end row loop */
+  sum = 0;
+  for ( i = 0; i < infoMap->bytesPerTile; i++ ) {
+    sum += actTile->bits[i];
+  }
+  if ( !sum ) {
+    actTile->flag = TDT_DOGO;
+    free ( actTile->bits );
+    actTile->bits = NULL;
+  } else if ( sum == infoMap->bytesPerTile * 255 ) {
+    actTile->flag = TDT_NOGO;
+    free ( actTile->bits );
+    actTile->bits = NULL;
+  }
+} /* end infoTile */
 
 void
 initGridMap8Bit ( pathfindingmap *map )
@@ -543,6 +749,9 @@ compressMap ( pathfindingmap *map )
   if ( !src )
     shutdown ( EF_INFO_MISSING, "Failed to locate previos map in compressMap\n" );
 
+  /* a rebuilt map may already have tiles */
+  if ( map->tile ) freeTiles ( map, &(map->tile) );
+
   /* set maps vars */
   map->tilesPerCol  = map->tilesPerRow = src->tilesPerRow / 2;
   map->tiles        = map->tilesPerCol * map->tilesPerRow;
@@ -551,6 +760,9 @@ compressMap ( pathfindingmap *map )
   map->bytesPerTile = TILE_BYTES;
   map->res          = map->tilesPerRow * TILE_DIM;
 
+  /* only the changed tiles are needed when updating */
+  if ( updateCompressed ( map, src )) return map;
+
   /* create tile data buffer array */
   if ( !( map->tile = (tileData *) calloc ( sizeof ( tileData ) * map->tiles, 1 )))
     shutdown ( EF_MALLOC,
@@ -564,9 +776,25 @@ void
 compressTiles ( pathfindingmap *map, tileData *tile )
 {
   unsigned char *tileBuf = NULL;
+  int row, col;
+
+  /* compress data one level
+   *
+   */
+  for ( row = 0; row < map->tilesPerCol; row++ )
+    for ( col = 0; col < map->tilesPerRow; col++ )
+      compressTile ( map, tile, col, row, &tileBuf );
+
+  if ( tileBuf ) free ( tileBuf );
+} /* end compressTiles */
+
+void
+compressTile ( pathfindingmap *map, tileData *tile, int col, int row,
+	       unsigned char **tileBuf )
+{
   tileData      *oldTile = NULL;
 
-  int bit, tileRow, col, row;
+  int bit, tileRow;
   int curTile;
   int rowByte;
   int compRow, compCol;
@@ -576,87 +804,84 @@ compressTiles ( pathfindingmap *map, tileData *tile )
   int oldTileOff;
   int oldByteOff;
 
-  /* compress data one level
-   *
-   */
-  for ( row = 0; row < map->tilesPerCol; row++ ) {
-    for ( col = 0; col < map->tilesPerRow; col++ ) {
+  /* set current tile */
+  curTile = row * map->tilesPerRow + col;
+  oldTileOff = row * 2 * map->tilesPerRow * 2 + col * 2;
 
-      /* set current tile */
-      curTile = row * map->tilesPerRow + col;
-      oldTileOff = row * 2 * map->tilesPerRow * 2 + col * 2;
+  /* do we really need to scan the bits? */
+  if (( tile[ oldTileOff     ].flag == TDT_DOGO ) &&
+      ( tile[ oldTileOff + 1 ].flag == TDT_DOGO ) &&
+      ( tile[ oldTileOff + map->tilesPerRow * 2     ].flag == TDT_DOGO ) &&
+      ( tile[ oldTileOff + map->tilesPerRow * 2 + 1 ].flag == TDT_DOGO )) {
 
-      /* do we really need to scan the bits? */
-      if (( tile[ oldTileOff     ].flag == TDT_DOGO ) &&
-	  ( tile[ oldTileOff + 1 ].flag == TDT_DOGO ) &&
-	  ( tile[ oldTileOff + map->tilesPerRow * 2     ].flag == TDT_DOGO ) &&
-	  ( tile[ oldTileOff + map->tilesPerRow * 2 + 1 ].flag == TDT_DOGO )) {
+    map->tile[curTile].flag = TDT_DOGO;
 
-	map->tile[curTile].flag = TDT_DOGO;
+  } else if (( tile[ oldTileOff     ].flag == TDT_NOGO ) &&
+	     ( tile[ oldTileOff + 1 ].flag == TDT_NOGO ) &&
+	     ( tile[ oldTileOff + map->tilesPerRow * 2     ].flag == TDT_NOGO ) &&
+	     ( tile[ oldTileOff + map->tilesPerRow * 2 + 1 ].flag == TDT_NOGO )) {
 
-      } else if (( tile[ oldTileOff     ].flag == TDT_NOGO ) &&
-		 ( tile[ oldTileOff + 1 ].flag == TDT_NOGO ) &&
-		 ( tile[ oldTileOff + map->tilesPerRow * 2     ].flag == TDT_NOGO ) &&
-		 ( tile[ oldTileOff + map->tilesPerRow * 2 + 1 ].flag == TDT_NOGO )) {
+    map->tile[curTile].flag = TDT_NOGO;
 
-	map->tile[curTile].flag = TDT_NOGO;
+  } else {
 
-      } else {
+    /* looks like we do */
+    if ( *tileBuf )
+      memset ( *tileBuf, 0, TILE_BYTES );
+    else  	/* create buffer and set bytes to 0 */
+      if ( !( *tileBuf = (unsigned char *) calloc ( TILE_BYTES, 1 )))
+      shutdown ( EF_MALLOC,
+		 "Error creating local tile data buffer in function compressMap\n" );
 
-	/* looks like we do */
-	if ( tileBuf )
-	  memset ( tileBuf, 0, TILE_BYTES );
-	else  	/* create buffer and set bytes to 0 */
-	  if ( !( tileBuf = (unsigned char *) calloc ( TILE_BYTES, 1 )))
-	  shutdown ( EF_MALLOC,
-		     "Error creating local tile data buffer in function compressMap\n" );
+    /* assume nothing */
+    hasNoGo = hasDoGo = FALSE;
 
-	/* assume nothing */
-	hasNoGo = hasDoGo = FALSE;
+    /* check and set every bit in the new tile */
+    for ( tileRow = 0; tileRow < TILE_DIM; tileRow++ ) {
+      for ( rowByte = 0; rowByte < ROW_BYTES; rowByte++ ) {
 
-	/* check and set every bit in the new tile */
-	for ( tileRow = 0; tileRow < TILE_DIM; tileRow++ ) {
-	  for ( rowByte = 0; rowByte < ROW_BYTES; rowByte++ ) {
+	oldTileOff = (( row * map->tilesPerRow * 2 + col ) * 2 +
+		       ( tileRow * 2 / TILE_DIM ) * map->tilesPerRow * 2 +
+		       ( rowByte * 2 / 8 ));
 
-	    oldTileOff = (( row * map->tilesPerRow * 2 + col ) * 2 +
-			   ( tileRow * 2 / TILE_DIM ) * map->tilesPerRow * 2 +
-			   ( rowByte * 2 / 8 ));
+	oldTile = &( tile[ oldTileOff ]);
 
-	    oldTile = &( tile[ oldTileOff ]);
+	if ( oldTile->flag != TDT_MIXED ) {
+	  if ( oldTile->flag == TDT_NOGO ) (*tileBuf)[tileRow * ROW_BYTES + rowByte] = 0xff;
+	  continue;
+	}
 
-	    if ( oldTile->flag != TDT_MIXED ) {
-	      if ( oldTile->flag == TDT_NOGO ) tileBuf[tileRow * ROW_BYTES + rowByte] = 0xff;
-	      continue;
-	    }
+	oldRowOff = ( tileRow * 2 )%TILE_DIM * ROW_BYTES;
 
-	    oldRowOff = ( tileRow * 2 )%TILE_DIM * ROW_BYTES;
-
-	    for ( bit = 0; bit < 8; bit++ ) {
-	      oldByteOff = oldRowOff + ( rowByte * 2 )%ROW_BYTES + bit/4;
-
-	      for ( compRow = 0; compRow < 2; compRow++ )
-		for (compCol = 0; compCol < 2; compCol++ )
-
-		  if ( oldTile->bits[ oldByteOff + compRow * ROW_BYTES ] &
-			 ( 1 << ((bit*2 + compCol)%8 ) )) {
-		    tileBuf[ tileRow * ROW_BYTES + rowByte ] |= ( 1 << bit );
-		    hasNoGo = TRUE;
-		  } else hasDoGo = TRUE;
-
-	    } /* end bit loop */
-	  } /* end rowByte loop */
-	} /* end tileRow loop */
-	/* attach to map */
-	if ( hasDoGo && hasNoGo ) {
-	  map->tile[ curTile ].flag = TDT_MIXED;
-	  map->tile[ curTile ].bits = tileBuf;
-	  tileBuf = NULL;
-	} else
-	  map->tile[ curTile ].flag = ( hasDoGo ) ? TDT_DOGO : TDT_NOGO;
-      }
-    } /* end col loop  */
-  } /* end row loop    */
-} /* end compressTiles */
+	for ( bit = 0; bit < 8; bit++ ) {
+	  oldByteOff = oldRowOff + ( rowByte * 2 )%ROW_BYTES + bit/4;
+
+	  for ( compRow = 0; compRow < 2; compRow++ )
+	    for (compCol = 0; compCol < 2; compCol++ )
+
+	      if ( oldTile->bits[ oldByteOff + compRow * ROW_BYTES ] &
+		     ( 1 << ((bit*2 + compCol)%8 ) ))
+		(*tileBuf)[ tileRow * ROW_BYTES + rowByte ] |= ( 1 << bit );
+
+	} /* end bit loop */
+      } /* end rowByte loop */
+    } /* end tileRow loop */
+
+    /* uniform tiles under it count too, and a pixel is NoGo if any of the
+     * four under it is - so look at what was made */
+    for ( rowByte = 0; rowByte < TILE_BYTES; rowByte++ ) {
+      if ( (*tileBuf)[ rowByte ] ) hasNoGo = TRUE;
+      if ( (*tileBuf)[ rowByte ] != 0xff ) hasDoGo = TRUE;
+    }
+    /* attach to map */
+    if ( hasDoGo && hasNoGo ) {
+      map->tile[ curTile ].flag = TDT_MIXED;
+      map->tile[ curTile ].bits = *tileBuf;
+      *tileBuf = NULL;
+    } else
+      map->tile[ curTile ].flag = ( hasDoGo ) ? TDT_DOGO : TDT_NOGO;
+  }
+} /* end compressTile */
 
 void
 fillHeader ( pathfindingmap *map, mapFileHeader *header )
@@ -681,37 +906,19 @@ findLn2 ( int p )
 void
 linkMaps ( pathfindingmap **maps, pathfindingmap *map )
 {
-  /* empty map structure requested */
-  if ( !(*maps) )
-    *maps = map;
-  else {
-    while ( (*maps)->next ) *maps = (*maps)->next;
-    (*maps)->next = map;
-    map->prev   = *maps;
-  }
+  /* new maps go to the front of the list, the registry finds them */
+  map->prev = NULL;
+  map->next = data.maps;
+  if ( data.maps ) data.maps->prev = map;
+  data.maps = map;
+  if ( !(*maps) ) *maps = map;
+  registerMap ( map );
 } /* end linkMaps */
 
 pathfindingmap *
-findMap ( pathfindingmap *maps, mapIOData src )
+findMap ( mapIOData src )
 {
-  pathfindingmap *map;
-  map = maps;
-  int dstType, srcType;
-
-  while ( map->prev ) map = map->prev;
-  while ( map ) {
-    dstType = ( map->io.type & (FTF_IMG-1) );
-    srcType = ( src.type & (FTF_IMG-1) );
-
-    if (( dstType         == srcType     ) &&
-	( map->io.vehicle == src.vehicle ) &&
-	( map->io.level   == src.level   )) {
-      return map;
-    }
-
-    map = map->next;
-  }
-  return NULL;
+  return lookupMap ( src );
 } /* end findMap */
 
 
@@ -28,20 +28,39 @@
 
 /************************************  includes              ************************/
 
+/************************************  macros                 ***********************/
+
+/* a set of maps from getMapSet - the levels, then info and smallOnes */
+#define SET_INFO ( MAX_LEVEL + 1 )
+#define SET_SO   ( MAX_LEVEL + 2 )
+#define SET_MAPS ( MAX_LEVEL + 3 )
+
+/* buffers a loader can hold at once through loadBuffer */
+#define LOAD_SCRATCH 4
+
 /************************************  prototypes             **************************/
 
 pathfindingmap *getMap          ( pathfindingmap **maps, mapIOData *src, mapIOData *dst );
+void            getMapSet       ( mapIOData *in, pathfindingmap **set );
 void            writeMap        ( pathfindingmap *map ) ;
 int             loadFile        ( pathfindingmap *map );
 void            loadMapFile     ( pathfindingmap *map );
+void            loadPatchBase   ( pathfindingmap *map );
+pathfindingmap *readMapFile     ( char *path, fileTypeFlag type, vehicleType vehicle, int level );
+void           *loadBuffer      ( size_t size );
+void            freeLoadBuffer  ( void *buf );
+void            dropLoad        ( void );
 pathfindingmap *findInfo        ( pathfindingmap *map );
+void            infoTile        ( pathfindingmap *infoMap, pathfindingmap *soMap, int tile );
 void            initGridMap8Bit ( pathfindingmap *map );
 pathfindingmap *compressMap     ( pathfindingmap *map );
 void            compressTiles   ( pathfindingmap *map, tileData *tile );
+void            compressTile    ( pathfindingmap *map, tileData *tile, int col, int row,
+				  unsigned char **tileBuf );
 void            fillHeader      ( pathfindingmap *map, mapFileHeader *header );
 int             findLn2         ( int p );
 void            linkMaps        ( pathfindingmap **maps, pathfindingmap *map );
-pathfindingmap *findMap         ( pathfindingmap *maps, mapIOData src );
+pathfindingmap *findMap         ( mapIOData src );
 void            copyIO          ( mapIOData *dst, mapIOData src );
 
 #endif /* __PATHFINDINGMAP_H__ */
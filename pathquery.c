@@ -0,0 +1,730 @@
+/* pathquery.c - paths found on the maps made
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -q, paths are found between pairs of points on the maps made, the
+ * way the game's bots find them: first over the smallOnes points and the
+ * links between them, then pixel by pixel on the level 0 map from one
+ * point to the next, kept to the two areas the points stand for. it shows
+ * how well the smallOnes serve the bots without loading the map in game.
+ *
+ * with -b each pair is also searched on the level 0 map alone - a plain
+ * A* over every pixel - and the two are timed and their lengths compared.
+ *
+ * moves are to the 8 pixels around, as the smallOnes areas are made, and
+ * cost STEP_COST or DIAG_COST. the estimate to the goal is the same
+ * distance with nothing in the way, so the paths are the shortest there
+ * are.
+ */
+
+/************************************  includes              ************************/
+
+#include <time.h>
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "textfile.h"
+#include "pathquery.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern THREAD_LOCAL userData data;
+
+static int stepX[8] = { 1, -1, 0,  0, 1,  1, -1, -1 };
+static int stepY[8] = { 0,  0, 1, -1, 1, -1,  1, -1 };
+
+/************************************  prototypes             ***********************/
+
+static int            readQueries  ( char *path, int **query );
+static void           initEngine   ( queryEngine *eng, pathfindingmap *map, pathfindingmap *soMap );
+static void           freeEngine   ( queryEngine *eng );
+static void           pathQuery    ( queryEngine *eng, int *q, queryResult *res );
+static void           flatQuery    ( queryEngine *eng, int *q, queryResult *res );
+static int            routeNodes   ( queryEngine *eng, int from, int to, queryResult *res );
+static int            nodeLinks    ( pathfindingmap *soMap, int node, int *links );
+static int            findNode     ( queryEngine *eng, int x, int y );
+static unsigned char *nodeArea     ( queryEngine *eng, int node );
+static void           setWindow    ( searchGrid *grid, int tileA, int tileB,
+				     unsigned char *maskA, unsigned char *maskB );
+static int            gridSearch   ( searchGrid *grid, searchHeap *heap,
+				     int sx, int sy, int gx, int gy, int *expanded );
+static int            gridPass     ( searchGrid *grid, int x, int y );
+static void           touchCell    ( searchGrid *grid, int cell );
+static int            isDoGo       ( pathfindingmap *map, int x, int y );
+static int            distance     ( int x0, int y0, int x1, int y1 );
+static void           heapPush     ( searchHeap *heap, unsigned int cost, int cell );
+static int            heapPop      ( searchHeap *heap );
+
+/************************************  functions             ************************/
+
+void
+runQueries ( mapIOData *in )
+{
+  char   buffer[ BUF_SIZE ];
+  mapIOData out = {0};
+  pathfindingmap *map;
+  pathfindingmap *soMap;
+  queryEngine eng;
+  queryResult *path;
+  queryResult *flat = NULL;
+  FILE   *fp;
+  int    *query;
+  int     queries;
+  int     i;
+  int     found = 0, foundFlat = 0, both = 0, onlyFlat = 0;
+  double  coarse = 0, expanded = 0, expandedFlat = 0;
+  double  length = 0, lengthFlat = 0;
+  double  secs, secsFlat = 0;
+  clock_t start;
+
+  if ( !( in->type & FTF_MAP ) || in->level ) {
+    debug ( DBG_WARN, "Paths are only found on maps made from a level 0 search map, not %s\n",
+	    in->path );
+    return;
+  }
+
+  /* the maps the jobs made, or made now without writing them */
+  out.path    = data.outpath;
+  out.vehicle = in->vehicle;
+  out.type    = FTF_MAP;
+  if ( !( map = getMap ( &(data.maps), in, &out )))
+    shutdown ( EF_FILE_READ, "Error loading %s\n", in->path );
+  out.type    = FTF_SO;
+  soMap = getMap ( &(data.maps), in, &out );
+
+  queries = readQueries ( data.queryPath, &query );
+  if ( !( path = (queryResult *) calloc ( sizeof ( queryResult ), queries + 1 )) ||
+       ( data.bench &&
+	 !( flat = (queryResult *) calloc ( sizeof ( queryResult ), queries + 1 ))))
+    shutdown ( EF_MALLOC, "Memory allocation error finding paths\n" );
+
+  initEngine ( &eng, map, soMap );
+
+  start = clock ();
+  for ( i = 0; i < queries; i++ ) pathQuery ( &eng, &(query[ i * 4 ]), &(path[i]) );
+  secs = (double) ( clock () - start ) / CLOCKS_PER_SEC;
+
+  if ( data.bench ) {
+    start = clock ();
+    for ( i = 0; i < queries; i++ ) flatQuery ( &eng, &(query[ i * 4 ]), &(flat[i]) );
+    secsFlat = (double) ( clock () - start ) / CLOCKS_PER_SEC;
+  }
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_PATHS,
+	     data.outpath, PATHSEP, baseName[ in->vehicle ] );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+
+  fprintf ( fp, "# from      to          length   points  searched  pixels" );
+  if ( data.bench ) fprintf ( fp, "    level 0  pixels    ratio" );
+  fprintf ( fp, "%s", LINEFEED );
+
+  for ( i = 0; i < queries; i++ ) {
+    snprintf ( buffer, BUF_SIZE, "%d,%d", query[ i * 4 ], query[ i * 4 + 1 ] );
+    fprintf ( fp, "%-11s ", buffer );
+    snprintf ( buffer, BUF_SIZE, "%d,%d", query[ i * 4 + 2 ], query[ i * 4 + 3 ] );
+    fprintf ( fp, "%-11s ", buffer );
+    if ( path[i].cost < 0 ) fprintf ( fp, "%8s", "-" );
+    else fprintf ( fp, "%8.1f", (double) path[i].cost / STEP_COST );
+    fprintf ( fp, "  %6d  %8d  %6d", path[i].nodes, path[i].coarse, path[i].expanded );
+
+    if ( path[i].cost >= 0 ) {
+      found++;
+      coarse   += path[i].coarse;
+      expanded += path[i].expanded;
+    }
+
+    if ( data.bench ) {
+      if ( flat[i].cost < 0 ) fprintf ( fp, "  %9s", "-" );
+      else fprintf ( fp, "  %9.1f", (double) flat[i].cost / STEP_COST );
+      fprintf ( fp, "  %6d", flat[i].expanded );
+      if (( path[i].cost >= 0 ) && ( flat[i].cost > 0 ))
+	fprintf ( fp, "  %7.3f", (double) path[i].cost / flat[i].cost );
+
+      if ( flat[i].cost >= 0 ) {
+	foundFlat++;
+	expandedFlat += flat[i].expanded;
+	if ( path[i].cost >= 0 ) {
+	  both++;
+	  length     += path[i].cost;
+	  lengthFlat += flat[i].cost;
+	} else onlyFlat++;
+      }
+    }
+    fprintf ( fp, "%s", LINEFEED );
+  }
+
+  /* the same summary goes in the file and on the screen */
+  for ( i = 0; i < 2; i++ ) {
+    snprintf ( buffer, BUF_SIZE, "%s%s paths: %d queries, %d found over the smallOnes",
+	       i ? "" : "# ", baseName[ in->vehicle ], queries, found );
+    if ( i ) {
+      if ( data.debug == DBG_QUIET ) break;
+      printf ( "%s\n", buffer );
+    } else fprintf ( fp, "%s%s", LINEFEED, buffer );
+    if ( data.bench ) {
+      snprintf ( buffer, BUF_SIZE, "%s  %d on level 0 alone, %d only there",
+		 i ? "" : "# ", foundFlat, onlyFlat );
+      if ( i ) printf ( "%s\n", buffer );
+      else fprintf ( fp, "%s%s", LINEFEED, buffer );
+    }
+    snprintf ( buffer, BUF_SIZE, "%s  smallOnes: %.0f queries/s, %.1f points and %.0f pixels searched a path",
+	       i ? "" : "# ", secs > 0 ? queries / secs : 0,
+	       found ? coarse / found : 0, found ? expanded / found : 0 );
+    if ( i ) printf ( "%s\n", buffer );
+    else fprintf ( fp, "%s%s", LINEFEED, buffer );
+    if ( !data.bench ) continue;
+    snprintf ( buffer, BUF_SIZE, "%s  level 0:   %.0f queries/s, %.0f pixels searched a path",
+	       i ? "" : "# ", secsFlat > 0 ? queries / secsFlat : 0,
+	       foundFlat ? expandedFlat / foundFlat : 0 );
+    if ( i ) printf ( "%s\n", buffer );
+    else fprintf ( fp, "%s%s", LINEFEED, buffer );
+    snprintf ( buffer, BUF_SIZE, "%s  paths are %.3f times as long as on level 0",
+	       i ? "" : "# ", lengthFlat > 0 ? length / lengthFlat : 1.0 );
+    if ( i ) printf ( "%s\n", buffer );
+    else fprintf ( fp, "%s%s", LINEFEED, buffer );
+  }
+  fprintf ( fp, "%s", LINEFEED );
+
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing paths\n" );
+
+  freeEngine ( &eng );
+  free ( query );
+  free ( path );
+  if ( flat ) free ( flat );
+} /* end runQueries */
+
+/* pairs of x0,y0 x1,y1, one to a line, # starts a comment */
+static int
+readQueries ( char *path, int **query )
+{
+  char  buffer[ BUF_SIZE ];
+  char *bp;
+  FILE *fp;
+  int   queries = 0;
+  int   max = 64;
+  int   line = 0;
+
+  if ( !( fp = fopen ( path, "r" )))
+    shutdown ( EF_FILE_OPEN, "Error opening query file %s\n", path );
+  if ( !( *query = (int *) malloc ( sizeof ( int ) * 4 * max )))
+    shutdown ( EF_MALLOC, "Memory allocation error reading queries\n" );
+
+  while ( fgets ( buffer, BUF_SIZE, fp )) {
+    line++;
+    if (( bp = strchr ( buffer, '#' ))) *bp = 0;
+    for ( bp = buffer; *bp && isspace ( *bp ); bp++ );
+    if ( !*bp ) continue;
+
+    if ( queries == max ) {
+      max *= 2;
+      if ( !( *query = (int *) realloc ( *query, sizeof ( int ) * 4 * max )))
+	shutdown ( EF_MALLOC, "Memory allocation error reading queries\n" );
+    }
+    if ( sscanf ( bp, "%d,%d %d,%d",
+		  &((*query)[ queries * 4 ]), &((*query)[ queries * 4 + 1 ]),
+		  &((*query)[ queries * 4 + 2 ]), &((*query)[ queries * 4 + 3 ]) ) != 4 )
+      shutdown ( EF_BAD_DATA, "Bad query on line %d of %s\n", line, path );
+    queries++;
+  }
+  fclose ( fp );
+
+  return queries;
+} /* end readQueries */
+
+static void
+initEngine ( queryEngine *eng, pathfindingmap *map, pathfindingmap *soMap )
+{
+  int nodes;
+
+  memset ( eng, 0, sizeof ( queryEngine ));
+  eng->map   = map;
+  eng->soMap = soMap;
+  nodes = soMap->tiles * 4;
+
+  if ( !( eng->area     = (unsigned char **) calloc ( sizeof ( unsigned char * ), nodes )) ||
+       !( eng->nodeCost = (unsigned int *) calloc ( sizeof ( unsigned int ), nodes )) ||
+       !( eng->nodeFrom = (int *) calloc ( sizeof ( int ), nodes )) ||
+       !( eng->nodeSeen = (int *) calloc ( sizeof ( int ), nodes )) ||
+       !( eng->route    = (int *) calloc ( sizeof ( int ), nodes + 1 )))
+    shutdown ( EF_MALLOC, "Memory allocation error finding paths\n" );
+
+  /* the local window is two tiles at most, level 0 is the whole map */
+  eng->local.map = map;
+  if ( !( eng->local.cost = (unsigned int *)
+	  calloc ( sizeof ( unsigned int ), 2 * TILE_DIM * TILE_DIM )))
+    shutdown ( EF_MALLOC, "Memory allocation error finding paths\n" );
+
+  if ( data.bench ) {
+    eng->flat.map = map;
+    eng->flat.w   = map->tilesPerRow * TILE_DIM;
+    eng->flat.h   = map->tilesPerCol * TILE_DIM;
+    if ( !( eng->flat.cost = (unsigned int *)
+	    calloc ( sizeof ( unsigned int ), (size_t) eng->flat.w * eng->flat.h )))
+      shutdown ( EF_MALLOC, "Memory allocation error finding paths\n" );
+  }
+} /* end initEngine */
+
+static void
+freeEngine ( queryEngine *eng )
+{
+  int i;
+
+  for ( i = 0; i < eng->soMap->tiles * 4; i++ )
+    if ( eng->area[i] ) free ( eng->area[i] );
+  free ( eng->area );
+  free ( eng->nodeCost );
+  free ( eng->nodeFrom );
+  free ( eng->nodeSeen );
+  free ( eng->route );
+  free ( eng->local.cost );
+  if ( eng->local.touched ) free ( eng->local.touched );
+  if ( eng->flat.cost ) free ( eng->flat.cost );
+  if ( eng->flat.touched ) free ( eng->flat.touched );
+  if ( eng->heap.cost ) free ( eng->heap.cost );
+  if ( eng->heap.cell ) free ( eng->heap.cell );
+} /* end freeEngine */
+
+/* over the smallOnes, then from point to point on level 0 */
+static void
+pathQuery ( queryEngine *eng, int *q, queryResult *res )
+{
+  pathfindingmap *soMap;
+  int from, to;
+  int nodes;
+  int x0, y0, x1, y1;
+  int a, b;
+  int cost;
+  int i;
+
+  memset ( res, 0, sizeof ( queryResult ));
+  res->cost = -1;
+  soMap = eng->soMap;
+
+  if ((( from = findNode ( eng, q[0], q[1] )) < 0 ) ||
+      (( to   = findNode ( eng, q[2], q[3] )) < 0 ) ||
+      !( nodes = routeNodes ( eng, from, to, res )))
+    return;
+  res->nodes = nodes;
+
+  /* the start, the points in between, then the goal */
+  x0 = q[0];
+  y0 = q[1];
+  res->cost = 0;
+  for ( i = 0; i < nodes; i++ ) {
+    a = eng->route[i];
+    b = eng->route[ i + 1 < nodes ? i + 1 : i ];
+    if ( i + 2 < nodes ) {
+      x1 = ( b / 4 % soMap->tilesPerRow ) * TILE_DIM + soMap->so[ b / 4 ].pt[ b % 4 ][0];
+      y1 = ( b / 4 / soMap->tilesPerRow ) * TILE_DIM + soMap->so[ b / 4 ].pt[ b % 4 ][1];
+    } else {
+      x1 = q[2];
+      y1 = q[3];
+    }
+
+    /* in the two areas - or anywhere in the two tiles if they don't meet */
+    setWindow ( &(eng->local), a / 4, b / 4, nodeArea ( eng, a ), nodeArea ( eng, b ));
+    if (( cost = gridSearch ( &(eng->local), &(eng->heap), x0, y0, x1, y1,
+			      &(res->expanded) )) < 0 ) {
+      setWindow ( &(eng->local), a / 4, b / 4, NULL, NULL );
+      if (( cost = gridSearch ( &(eng->local), &(eng->heap), x0, y0, x1, y1,
+				&(res->expanded) )) < 0 ) {
+	res->cost = -1;
+	return;
+      }
+    }
+    res->cost += cost;
+
+    if (( x1 == q[2] ) && ( y1 == q[3] )) break;
+    x0 = x1;
+    y0 = y1;
+  }
+} /* end pathQuery */
+
+/* every pixel of the level 0 map */
+static void
+flatQuery ( queryEngine *eng, int *q, queryResult *res )
+{
+  memset ( res, 0, sizeof ( queryResult ));
+  res->cost = gridSearch ( &(eng->flat), &(eng->heap), q[0], q[1], q[2], q[3],
+			   &(res->expanded) );
+} /* end flatQuery */
+
+/* A* over the smallOnes points, the route is left in eng->route.
+ * returns the points on it, 0 for none */
+static int
+routeNodes ( queryEngine *eng, int from, int to, queryResult *res )
+{
+  pathfindingmap *soMap;
+  unsigned int cost, next;
+  int links[16];
+  int count;
+  int node, link;
+  int x, y, gx, gy, lx, ly;
+  int nodes;
+  int i;
+
+  soMap = eng->soMap;
+  eng->query++;
+  eng->heap.size = 0;
+
+#define NODE_X(n) (( (n) / 4 % soMap->tilesPerRow ) * TILE_DIM + soMap->so[ (n) / 4 ].pt[ (n) % 4 ][0] )
+#define NODE_Y(n) (( (n) / 4 / soMap->tilesPerRow ) * TILE_DIM + soMap->so[ (n) / 4 ].pt[ (n) % 4 ][1] )
+
+  gx = NODE_X ( to );
+  gy = NODE_Y ( to );
+
+  eng->nodeSeen[ from ] = eng->query;
+  eng->nodeCost[ from ] = 1;
+  eng->nodeFrom[ from ] = -1;
+  heapPush ( &(eng->heap), distance ( NODE_X ( from ), NODE_Y ( from ), gx, gy ), from );
+
+  while ( eng->heap.size ) {
+    node = heapPop ( &(eng->heap) );
+    if ( eng->nodeCost[ node ] & COST_CLOSED ) continue;
+    cost = eng->nodeCost[ node ] |= COST_CLOSED;
+    cost &= ~COST_CLOSED;
+    res->coarse++;
+
+    if ( node == to ) {
+      /* walk back, then turn it around */
+      for ( nodes = 0; node >= 0; node = eng->nodeFrom[ node ] )
+	eng->route[ nodes++ ] = node;
+      for ( i = 0; i < nodes / 2; i++ ) {
+	link = eng->route[i];
+	eng->route[i] = eng->route[ nodes - 1 - i ];
+	eng->route[ nodes - 1 - i ] = link;
+      }
+      return nodes;
+    }
+
+    x = NODE_X ( node );
+    y = NODE_Y ( node );
+    count = nodeLinks ( soMap, node, links );
+    for ( i = 0; i < count; i++ ) {
+      link = links[i];
+      lx = NODE_X ( link );
+      ly = NODE_Y ( link );
+      next = cost + distance ( x, y, lx, ly );
+      if ( eng->nodeSeen[ link ] == eng->query ) {
+	if (( eng->nodeCost[ link ] & COST_CLOSED ) || ( eng->nodeCost[ link ] <= next ))
+	  continue;
+      }
+      eng->nodeSeen[ link ] = eng->query;
+      eng->nodeCost[ link ] = next;
+      eng->nodeFrom[ link ] = node;
+      heapPush ( &(eng->heap), next - 1 + distance ( lx, ly, gx, gy ), link );
+    }
+  }
+
+#undef NODE_X
+#undef NODE_Y
+
+  return 0;
+} /* end routeNodes */
+
+/* the points a point links to - below and right are its own links, above
+ * and left are those of the tiles there */
+static int
+nodeLinks ( pathfindingmap *soMap, int node, int *links )
+{
+  smallOnesData *so;
+  int tile, col, row;
+  int count = 0;
+  int i, j;
+
+  so   = soMap->so;
+  tile = node / 4;
+  i    = node % 4;
+  col  = tile % soMap->tilesPerRow;
+  row  = tile / soMap->tilesPerRow;
+
+  for ( j = 0; j < 4; j++ ) {
+    if (( row < soMap->tilesPerCol - 1 ) &&
+	( so[ tile ].hasLower & ( 1 << ( i * 4 + j ))) &&
+	( so[ tile + soMap->tilesPerRow ].active & ( ACT_OFF << j )))
+      links[ count++ ] = ( tile + soMap->tilesPerRow ) * 4 + j;
+    if (( row > 0 ) &&
+	( so[ tile - soMap->tilesPerRow ].hasLower & ( 1 << ( j * 4 + i ))) &&
+	( so[ tile - soMap->tilesPerRow ].active & ( ACT_OFF << j )))
+      links[ count++ ] = ( tile - soMap->tilesPerRow ) * 4 + j;
+    if (( col < soMap->tilesPerRow - 1 ) &&
+	( so[ tile ].hasRight & ( 1 << ( i * 4 + j ))) &&
+	( so[ tile + 1 ].active & ( ACT_OFF << j )))
+      links[ count++ ] = ( tile + 1 ) * 4 + j;
+    if (( col > 0 ) &&
+	( so[ tile - 1 ].hasRight & ( 1 << ( j * 4 + i ))) &&
+	( so[ tile - 1 ].active & ( ACT_OFF << j )))
+      links[ count++ ] = ( tile - 1 ) * 4 + j;
+  }
+  return count;
+} /* end nodeLinks */
+
+/* the point whose area pixel x, y is in, -1 if none */
+static int
+findNode ( queryEngine *eng, int x, int y )
+{
+  pathfindingmap *soMap;
+  unsigned char *area;
+  int tile;
+  int col, row;
+  int i;
+
+  soMap = eng->soMap;
+  if ( !INRANGE ( x, 0, soMap->tilesPerRow * TILE_DIM - 1 ) ||
+       !INRANGE ( y, 0, soMap->tilesPerCol * TILE_DIM - 1 ))
+    return -1;
+
+  tile = ( y / TILE_DIM ) * soMap->tilesPerRow + x / TILE_DIM;
+  col  = x % TILE_DIM;
+  row  = y % TILE_DIM;
+  for ( i = 0; i < 4; i++ ) {
+    if ( !( soMap->so[ tile ].active & ( ACT_OFF << i ))) continue;
+    area = nodeArea ( eng, tile * 4 + i );
+    if ( area[ row * ROW_BYTES + col / 8 ] & ( 1 << ( col % 8 ))) return tile * 4 + i;
+  }
+  return -1;
+} /* end findNode */
+
+/* the DoGo pixels of a tile joined to its point - set bits are in the area */
+static unsigned char *
+nodeArea ( queryEngine *eng, int node )
+{
+  unsigned char *area;
+  short stack[ TILE_DIM * TILE_DIM ][2];
+  int top = 0;
+  int tile;
+  int x0, y0;
+  int col, row, c, r;
+  int i;
+
+  if ( eng->area[ node ] ) return eng->area[ node ];
+  if ( !( area = eng->area[ node ] = (unsigned char *) calloc ( TILE_BYTES, 1 )))
+    shutdown ( EF_MALLOC, "Memory allocation error finding paths\n" );
+
+  tile = node / 4;
+  x0   = ( tile % eng->map->tilesPerRow ) * TILE_DIM;
+  y0   = ( tile / eng->map->tilesPerRow ) * TILE_DIM;
+  col  = eng->soMap->so[ tile ].pt[ node % 4 ][0];
+  row  = eng->soMap->so[ tile ].pt[ node % 4 ][1];
+  if (( col >= TILE_DIM ) || ( row >= TILE_DIM ) || !isDoGo ( eng->map, x0 + col, y0 + row ))
+    return area;
+
+  area[ row * ROW_BYTES + col / 8 ] |= 1 << ( col % 8 );
+  stack[ top ][0]   = col;
+  stack[ top++ ][1] = row;
+  while ( top ) {
+    top--;
+    col = stack[ top ][0];
+    row = stack[ top ][1];
+    for ( i = 0; i < 8; i++ ) {
+      c = col + stepX[i];
+      r = row + stepY[i];
+      if ( !INRANGE ( c, 0, TILE_DIM - 1 ) || !INRANGE ( r, 0, TILE_DIM - 1 ) ||
+	   ( area[ r * ROW_BYTES + c / 8 ] & ( 1 << ( c % 8 ))) ||
+	   !isDoGo ( eng->map, x0 + c, y0 + r ))
+	continue;
+      area[ r * ROW_BYTES + c / 8 ] |= 1 << ( c % 8 );
+      stack[ top ][0]   = c;
+      stack[ top++ ][1] = r;
+    }
+  }
+  return area;
+} /* end nodeArea */
+
+static void
+setWindow ( searchGrid *grid, int tileA, int tileB,
+	    unsigned char *maskA, unsigned char *maskB )
+{
+  int tpr;
+
+  tpr = grid->map->tilesPerRow;
+  grid->x0 = MIN ( tileA % tpr, tileB % tpr ) * TILE_DIM;
+  grid->y0 = MIN ( tileA / tpr, tileB / tpr ) * TILE_DIM;
+  grid->w  = ( ABS ( tileA % tpr - tileB % tpr ) + 1 ) * TILE_DIM;
+  grid->h  = ( ABS ( tileA / tpr - tileB / tpr ) + 1 ) * TILE_DIM;
+  grid->tile[0] = tileA;
+  grid->tile[1] = tileB;
+  grid->mask[0] = maskA;
+  grid->mask[1] = maskB;
+} /* end setWindow */
+
+/* A* between two pixels of a window, returns the cost or -1 */
+static int
+gridSearch ( searchGrid *grid, searchHeap *heap, int sx, int sy, int gx, int gy,
+	     int *expanded )
+{
+  unsigned int cost, next, old;
+  int cell, goal, link;
+  int x, y, nx, ny;
+  int ret = -1;
+  int i;
+
+  if ( !INRANGE ( sx - grid->x0, 0, grid->w - 1 ) || !INRANGE ( sy - grid->y0, 0, grid->h - 1 ) ||
+       !INRANGE ( gx - grid->x0, 0, grid->w - 1 ) || !INRANGE ( gy - grid->y0, 0, grid->h - 1 ) ||
+       !gridPass ( grid, sx, sy ) || !gridPass ( grid, gx, gy ))
+    return -1;
+
+  heap->size = 0;
+  cell = ( sy - grid->y0 ) * grid->w + sx - grid->x0;
+  goal = ( gy - grid->y0 ) * grid->w + gx - grid->x0;
+  touchCell ( grid, cell );
+  grid->cost[ cell ] = 1;
+  heapPush ( heap, distance ( sx, sy, gx, gy ), cell );
+
+  while ( heap->size ) {
+    cell = heapPop ( heap );
+    if ( grid->cost[ cell ] & COST_CLOSED ) continue;
+    cost = grid->cost[ cell ];
+    grid->cost[ cell ] |= COST_CLOSED;
+    (*expanded)++;
+
+    if ( cell == goal ) {
+      ret = cost - 1;
+      break;
+    }
+
+    x = cell % grid->w + grid->x0;
+    y = cell / grid->w + grid->y0;
+    for ( i = 0; i < 8; i++ ) {
+      nx = x + stepX[i];
+      ny = y + stepY[i];
+      if ( !INRANGE ( nx - grid->x0, 0, grid->w - 1 ) ||
+	   !INRANGE ( ny - grid->y0, 0, grid->h - 1 ) || !gridPass ( grid, nx, ny ))
+	continue;
+      link = ( ny - grid->y0 ) * grid->w + nx - grid->x0;
+      next = cost + (( i < 4 ) ? STEP_COST : DIAG_COST );
+      if (( old = grid->cost[ link ] )) {
+	if (( old & COST_CLOSED ) || ( old <= next )) continue;
+      } else touchCell ( grid, link );
+      grid->cost[ link ] = next;
+      heapPush ( heap, next - 1 + distance ( nx, ny, gx, gy ), link );
+    }
+  }
+
+  /* only what was reached is cleared, level 0 is too big to clear it all */
+  for ( i = 0; i < grid->touches; i++ ) grid->cost[ grid->touched[i] ] = 0;
+  grid->touches = 0;
+
+  return ret;
+} /* end gridSearch */
+
+static int
+gridPass ( searchGrid *grid, int x, int y )
+{
+  int tile;
+  int col, row;
+  int i;
+
+  if ( !grid->mask[0] && !grid->mask[1] ) return isDoGo ( grid->map, x, y );
+
+  tile = ( y / TILE_DIM ) * grid->map->tilesPerRow + x / TILE_DIM;
+  col  = x % TILE_DIM;
+  row  = y % TILE_DIM;
+  for ( i = 0; i < 2; i++ )
+    if (( tile == grid->tile[i] ) && grid->mask[i] &&
+	( grid->mask[i][ row * ROW_BYTES + col / 8 ] & ( 1 << ( col % 8 ))))
+      return TRUE;
+  return FALSE;
+} /* end gridPass */
+
+static void
+touchCell ( searchGrid *grid, int cell )
+{
+  if ( grid->touches == grid->maxTouches ) {
+    grid->maxTouches = grid->maxTouches ? grid->maxTouches * 2 : 4096;
+    if ( !( grid->touched = (int *) realloc ( grid->touched, sizeof ( int ) * grid->maxTouches )))
+      shutdown ( EF_MALLOC, "Memory allocation error finding paths\n" );
+  }
+  grid->touched[ grid->touches++ ] = cell;
+} /* end touchCell */
+
+static int
+isDoGo ( pathfindingmap *map, int x, int y )
+{
+  tileData *tile;
+
+  tile = &(map->tile[ ( y / TILE_DIM ) * map->tilesPerRow + x / TILE_DIM ]);
+  if ( tile->flag != TDT_MIXED ) return ( tile->flag == TDT_DOGO );
+  x %= TILE_DIM;
+  return !( tile->bits[ ( y % TILE_DIM ) * ROW_BYTES + x / 8 ] & ( 1 << ( x % 8 )));
+} /* end isDoGo */
+
+/* the cost with nothing in the way */
+static int
+distance ( int x0, int y0, int x1, int y1 )
+{
+  int dx, dy;
+
+  dx = ABS ( x1 - x0 );
+  dy = ABS ( y1 - y0 );
+  return DIAG_COST * MIN ( dx, dy ) + STEP_COST * ( MAX ( dx, dy ) - MIN ( dx, dy ));
+} /* end distance */
+
+static void
+heapPush ( searchHeap *heap, unsigned int cost, int cell )
+{
+  int i, up;
+
+  if ( heap->size == heap->max ) {
+    heap->max = heap->max ? heap->max * 2 : 1024;
+    if ( !( heap->cost = (unsigned int *) realloc ( heap->cost, sizeof ( unsigned int ) * heap->max )) ||
+	 !( heap->cell = (int *) realloc ( heap->cell, sizeof ( int ) * heap->max )))
+      shutdown ( EF_MALLOC, "Memory allocation error finding paths\n" );
+  }
+
+  for ( i = heap->size++; i > 0; i = up ) {
+    up = ( i - 1 ) / 2;
+    if ( heap->cost[ up ] <= cost ) break;
+    heap->cost[i] = heap->cost[ up ];
+    heap->cell[i] = heap->cell[ up ];
+  }
+  heap->cost[i] = cost;
+  heap->cell[i] = cell;
+} /* end heapPush */
+
+static int
+heapPop ( searchHeap *heap )
+{
+  unsigned int cost;
+  int cell, top;
+  int i, down;
+
+  top  = heap->cell[0];
+  cost = heap->cost[ --heap->size ];
+  cell = heap->cell[ heap->size ];
+
+  for ( i = 0; ( down = i * 2 + 1 ) < heap->size; i = down ) {
+    if (( down + 1 < heap->size ) && ( heap->cost[ down + 1 ] < heap->cost[ down ] )) down++;
+    if ( cost <= heap->cost[ down ] ) break;
+    heap->cost[i] = heap->cost[ down ];
+    heap->cell[i] = heap->cell[ down ];
+  }
+  heap->cost[i] = cost;
+  heap->cell[i] = cell;
+
+  return top;
+} /* end heapPop */
@@ -0,0 +1,96 @@
+/* pathquery.h - paths found on the maps made
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __PATHQUERY_H__
+#define __PATHQUERY_H__
+
+
+/************************************  macros                 ***********************/
+
+/* step costs, a diagonal is about 14 / 10 of a straight step */
+#define STEP_COST   10
+#define DIAG_COST   14
+
+/* a cost reached - the high bit is set once it is final */
+#define COST_CLOSED 0x80000000u
+
+/************************************  structures and enums  ************************/
+
+/* a binary heap of cells, cheapest first */
+typedef struct _searchHeap
+{
+  unsigned int   *cost;
+  int            *cell;
+  int             size;
+  int             max;
+} searchHeap;
+
+/* a window of level 0 pixels searched for a path. with masks the path
+ * stays in the two smallOnes areas, without them any DoGo pixel will do
+ */
+typedef struct _searchGrid
+{
+  pathfindingmap *map;
+  int             x0;
+  int             y0;
+  int             w;
+  int             h;
+  int             tile[2];
+  unsigned char  *mask[2];
+  unsigned int   *cost;     /* w * h, 0 for a pixel not reached yet */
+  int            *touched;  /* the pixels reached, to clear after */
+  int             touches;
+  int             maxTouches;
+} searchGrid;
+
+/* what is kept between the queries of a batch */
+typedef struct _queryEngine
+{
+  pathfindingmap *map;      /* level 0 search map */
+  pathfindingmap *soMap;
+  unsigned char **area;     /* tile * 4 + point, made when first needed */
+  unsigned int   *nodeCost;
+  int            *nodeFrom;
+  int            *nodeSeen; /* the query that set nodeCost */
+  int            *route;
+  int             query;
+  searchHeap      heap;
+  searchGrid      local;
+  searchGrid      flat;
+} queryEngine;
+
+/* how one query went */
+typedef struct _queryResult
+{
+  int             cost;     /* -1 for no path */
+  int             nodes;    /* smallOnes points on the path */
+  int             coarse;   /* points searched */
+  int             expanded; /* pixels searched */
+} queryResult;
+
+/************************************  prototypes             ***********************/
+
+void             runQueries       ( mapIOData *in );
+
+#endif /* __PATHQUERY_H__ */
@@ -0,0 +1,723 @@
+/* png.c - png image input and output
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* png images are written with a palette at 1, 4 or 8 bits, top row first,
+ * so bands go in from the bottom of the bitmap up. the compressor is
+ * plain LZ77 with the fixed deflate codes - pathmaps are long runs of the
+ * same few colors and the fixed codes cost little against dynamic ones.
+ * reading takes any non interlaced palette or gray png up to 8 bits and
+ * inflates all 3 block types.
+ */
+
+/************************************  includes              ************************/
+#include "common.h"
+#include "commonutils.h"
+#include "image.h"
+#include "pathfindingmap.h"
+#include "png.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+
+unsigned char pngSignature[ PNG_SIG_LEN ] = {
+  0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+};
+
+THREAD_LOCAL unsigned int crcTable[256];
+THREAD_LOCAL int crcTableDone = FALSE;
+
+/* deflate length and distance codes */
+short lenBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+short lenExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+short distBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+  8193, 12289, 16385, 24577
+};
+short distExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/************************************  functions             ************************/
+
+unsigned int
+pngCrc ( unsigned int crc, unsigned char *buf, int len )
+{
+  unsigned int c;
+  int i, k;
+
+  if ( !crcTableDone ) {
+    for ( i = 0; i < 256; i++ ) {
+      c = i;
+      for ( k = 0; k < 8; k++ ) c = ( c & 1 ) ? 0xedb88320 ^ ( c >> 1 ) : c >> 1;
+      crcTable[i] = c;
+    }
+    crcTableDone = TRUE;
+  }
+
+  crc = ~crc;
+  while ( len-- ) crc = crcTable[ ( crc ^ *buf++ ) & 0xff ] ^ ( crc >> 8 );
+  return ~crc;
+} /* end pngCrc */
+
+unsigned int
+pngAdler ( unsigned int adler, unsigned char *buf, int len )
+{
+  unsigned int a, b;
+  int n;
+
+  a = adler & 0xffff;
+  b = adler >> 16;
+  while ( len > 0 ) {
+    /* 5552 bytes is as far as the sums go before they overflow */
+    n = MIN ( len, 5552 );
+    len -= n;
+    while ( n-- ) {
+      a += *buf++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return ( b << 16 ) | a;
+} /* end pngAdler */
+
+static void
+putInt ( unsigned char *p, unsigned int value )
+{
+  /* png numbers are big endian */
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+static unsigned int
+getInt ( unsigned char *p )
+{
+  return ((unsigned int) p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+}
+
+void
+pngWriteChunk ( FILE *fp, char *type, unsigned char *buf, int len )
+{
+  unsigned char head[8];
+  unsigned char tail[4];
+  unsigned int crc;
+
+  putInt ( head, len );
+  memcpy ( head + 4, type, 4 );
+  crc = pngCrc ( pngCrc ( 0, head + 4, 4 ), buf, len );
+  putInt ( tail, crc );
+
+  if ( !fwrite ( head, 8, 1, fp ) ||
+       ( len && !fwrite ( buf, len, 1, fp )) ||
+       !fwrite ( tail, 4, 1, fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing png %s chunk\n", type );
+} /* end pngWriteChunk */
+
+/* output bits go in low bit first, whole bytes are moved to the chunk
+ * buffer and the buffer goes out as an IDAT chunk when it fills
+ */
+static void
+putByte ( pngStream *png, int value )
+{
+  png->out[ png->outLen++ ] = value;
+  if ( png->outLen == PNG_IDAT_SIZE ) {
+    pngWriteChunk ( png->fp, "IDAT", png->out, png->outLen );
+    png->outLen = 0;
+  }
+}
+
+static void
+putBits ( pngStream *png, unsigned int value, int count )
+{
+  png->bits |= value << png->bitCount;
+  png->bitCount += count;
+  while ( png->bitCount >= 8 ) {
+    putByte ( png, png->bits & 0xff );
+    png->bits >>= 8;
+    png->bitCount -= 8;
+  }
+}
+
+static void
+putCode ( pngStream *png, int code, int len )
+{
+  int rev = 0;
+  int i;
+
+  /* huffman codes go out high bit first */
+  for ( i = 0; i < len; i++ ) rev |= (( code >> i ) & 1 ) << ( len - 1 - i );
+  putBits ( png, rev, len );
+}
+
+static void
+putLiteral ( pngStream *png, int lit )
+{
+  /* the fixed literal / length code */
+  if ( lit < 144 )      putCode ( png, 0x30 + lit, 8 );
+  else if ( lit < 256 ) putCode ( png, 0x190 + lit - 144, 9 );
+  else if ( lit < 280 ) putCode ( png, lit - 256, 7 );
+  else                  putCode ( png, 0xc0 + lit - 280, 8 );
+}
+
+static void
+putMatch ( pngStream *png, int len, int dist )
+{
+  int i;
+
+  for ( i = 28; lenBase[i] > len; i-- );
+  putLiteral ( png, 257 + i );
+  if ( lenExtra[i] ) putBits ( png, len - lenBase[i], lenExtra[i] );
+
+  for ( i = 29; distBase[i] > dist; i-- );
+  putCode ( png, i, 5 );
+  if ( distExtra[i] ) putBits ( png, dist - distBase[i], distExtra[i] );
+}
+
+pngStream *
+pngOpen ( pathfindingmap *map, FILE *fp, int width, int height )
+{
+  pngStream *png;
+  unsigned char buf[ 256 * 3 ];
+  rgbQuad gray[256];
+  rgbQuad *pal;
+  int ppm;
+  int i;
+
+  if ( !( png = (pngStream *) malloc ( sizeof ( pngStream ))))
+    shutdown ( EF_MALLOC, "Error creating %s png stream\n",
+	       baseName[ map->io.vehicle ] );
+
+  png->fp       = fp;
+  png->rowBytes = ( width * map->io.bits + 7 ) / 8;
+  png->adler    = 1;
+  png->bits     = png->bitCount = 0;
+  png->start    = png->end = 0;
+  png->outLen   = 0;
+  for ( i = 0; i < DEFLATE_HASH; i++ ) png->head[i] = -1;
+
+  if ( !fwrite ( pngSignature, PNG_SIG_LEN, 1, fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing %s png signature\n",
+	       baseName[ map->io.vehicle ] );
+
+  putInt ( buf, width );
+  putInt ( buf + 4, height );
+  buf[8]  = map->io.bits;
+  buf[9]  = PNG_PALETTE;
+  buf[10] = buf[11] = buf[12] = 0;
+  pngWriteChunk ( fp, "IHDR", buf, 13 );
+
+  pal = imagePalette ( map, gray );
+  for ( i = 0; i < ( 1 << map->io.bits ); i++ ) {
+    buf[ i*3 ]     = pal[i].rgbRed;
+    buf[ i*3 + 1 ] = pal[i].rgbGreen;
+    buf[ i*3 + 2 ] = pal[i].rgbBlue;
+  }
+  pngWriteChunk ( fp, "PLTE", buf, 3 << map->io.bits );
+
+  /* same pixel size the bitmaps carry */
+  ppm = DIB_PELSPERMETER;
+  if (( map->io.type & FTF_NATIVE ) && !( map->io.type & FTF_INFO ))
+    ppm >>= map->io.level;
+  putInt ( buf, ppm );
+  putInt ( buf + 4, ppm );
+  buf[8] = 1;
+  pngWriteChunk ( fp, "pHYs", buf, 9 );
+
+  /* zlib header, then one fixed code block for the whole image */
+  putByte ( png, 0x78 );
+  putByte ( png, 0x01 );
+  putBits ( png, 1 << 1, 3 );
+
+  return png;
+} /* end pngOpen */
+
+void
+pngWriteRow ( pngStream *png, unsigned char *row )
+{
+  unsigned char filter = 0;
+
+  /* palette images do best unfiltered */
+  deflateData ( png, &filter, 1 );
+  deflateData ( png, row, png->rowBytes );
+} /* end pngWriteRow */
+
+void
+pngClose ( pngStream *png )
+{
+  unsigned char buf[4];
+
+  deflateWindow ( png, TRUE );
+
+  /* end the block, then an empty last block */
+  putLiteral ( png, 256 );
+  putBits ( png, 1 | ( 1 << 1 ), 3 );
+  putLiteral ( png, 256 );
+  if ( png->bitCount ) putBits ( png, 0, 8 - png->bitCount );
+
+  putInt ( buf, png->adler );
+  putByte ( png, buf[0] );
+  putByte ( png, buf[1] );
+  putByte ( png, buf[2] );
+  putByte ( png, buf[3] );
+
+  if ( png->outLen ) pngWriteChunk ( png->fp, "IDAT", png->out, png->outLen );
+  pngWriteChunk ( png->fp, "IEND", NULL, 0 );
+  free ( png );
+} /* end pngClose */
+
+void
+deflateData ( pngStream *png, unsigned char *buf, int len )
+{
+  int n;
+  int i;
+
+  png->adler = pngAdler ( png->adler, buf, len );
+
+  while ( len > 0 ) {
+    /* full window - code what we can and slide the top half down */
+    if ( png->end == 2 * DEFLATE_WSIZE ) {
+      deflateWindow ( png, FALSE );
+      memmove ( png->win, png->win + DEFLATE_WSIZE, DEFLATE_WSIZE );
+      png->start -= DEFLATE_WSIZE;
+      png->end   -= DEFLATE_WSIZE;
+      for ( i = 0; i < DEFLATE_HASH; i++ )
+	png->head[i] = ( png->head[i] >= DEFLATE_WSIZE ) ? png->head[i] - DEFLATE_WSIZE : -1;
+      for ( i = 0; i < DEFLATE_WSIZE; i++ )
+	png->prev[i] = ( png->prev[i] >= DEFLATE_WSIZE ) ? png->prev[i] - DEFLATE_WSIZE : -1;
+    }
+    n = MIN ( len, 2 * DEFLATE_WSIZE - png->end );
+    memcpy ( png->win + png->end, buf, n );
+    png->end += n;
+    buf += n;
+    len -= n;
+  }
+} /* end deflateData */
+
+#define DEFLATE_HASH_AT(w,s) \
+  (((( w )[ s ] << 10 ) ^ (( w )[ (s) + 1 ] << 5 ) ^ ( w )[ (s) + 2 ] ) & ( DEFLATE_HASH - 1 ))
+
+static void
+insertString ( pngStream *png, int s )
+{
+  int h;
+
+  h = DEFLATE_HASH_AT ( png->win, s );
+  png->prev[ s & ( DEFLATE_WSIZE - 1 ) ] = png->head[h];
+  png->head[h] = s;
+}
+
+void
+deflateWindow ( pngStream *png, int flush )
+{
+  unsigned char *win;
+  int limit;
+  int cand;
+  int chain;
+  int best, dist;
+  int maxLen;
+  int len;
+  int s, i;
+
+  win = png->win;
+  s   = png->start;
+
+  /* leave room to look ahead for a full match unless this is the end */
+  limit = flush ? png->end : png->end - DEFLATE_MAX;
+
+  while ( s < limit ) {
+    best = dist = 0;
+    if ( s + DEFLATE_MIN <= png->end ) {
+      maxLen = MIN ( DEFLATE_MAX, png->end - s );
+      cand   = png->head[ DEFLATE_HASH_AT ( win, s ) ];
+      for ( chain = DEFLATE_CHAIN;
+	    chain && ( cand >= 0 ) && ( s - cand <= DEFLATE_WSIZE ); chain-- ) {
+	if ( win[ cand + best ] == win[ s + best ] ) {
+	  for ( len = 0; ( len < maxLen ) && ( win[ cand + len ] == win[ s + len ] ); len++ );
+	  if ( len > best ) {
+	    best = len;
+	    dist = s - cand;
+	    if ( len == maxLen ) break;
+	  }
+	}
+	cand = png->prev[ cand & ( DEFLATE_WSIZE - 1 ) ];
+      }
+      insertString ( png, s );
+    }
+
+    if ( best >= DEFLATE_MIN ) {
+      putMatch ( png, best, dist );
+      if ( best <= DEFLATE_INSERT )
+	for ( i = 1; ( i < best ) && ( s + i + DEFLATE_MIN <= png->end ); i++ )
+	  insertString ( png, s + i );
+      s += best;
+    } else {
+      putLiteral ( png, win[s] );
+      s++;
+    }
+  }
+  png->start = s;
+} /* end deflateWindow */
+
+int
+isPngFile ( pathfindingmap *map )
+{
+  unsigned char sig[ PNG_SIG_LEN ];
+  int ret;
+
+  ret = ( fread ( sig, PNG_SIG_LEN, 1, map->fp ) &&
+	  !memcmp ( sig, pngSignature, PNG_SIG_LEN ));
+  fseek ( map->fp, 0, SEEK_SET );
+  return ret;
+} /* end isPngFile */
+
+void
+loadPng ( pathfindingmap *map )
+{
+  inflateStream s = { 0 };
+  unsigned char *file;
+  unsigned char *p;
+  unsigned int len;
+  int size;
+  int width = 0, height = 0;
+  int depth = 0, colorType = 0;
+  int rowBytes;
+
+  /* read in the whole file, it's small */
+  size = fileSize ( map );
+  if ( !( file = (unsigned char *) loadBuffer ( size )) ||
+       !( s.in = (unsigned char *) loadBuffer ( size )))
+    shutdown ( EF_MALLOC, "Error creating %s input image buffer\n",
+	       baseName[map->io.vehicle] );
+  if ( !fread ( file, size, 1, map->fp ))
+    shutdown ( EF_FILE_READ, "Error reading from %s input image file.\n",
+	       baseName[map->io.vehicle] );
+
+  if (( size < PNG_SIG_LEN ) || memcmp ( file, pngSignature, PNG_SIG_LEN ))
+    shutdown ( EF_BAD_FILE, "%s png file has bad signature\n",
+	       baseName[map->io.vehicle] );
+
+  /* step thru the chunks, gathering up the image data */
+  for ( p = file + PNG_SIG_LEN; p + 12 <= file + size; p += len + 12 ) {
+    len = getInt ( p );
+    if ( len > (unsigned int) ( file + size - p - 12 ))
+      shutdown ( EF_BAD_FILE, "%s png file is short\n", baseName[map->io.vehicle] );
+    if ( pngCrc ( 0, p + 4, len + 4 ) != getInt ( p + 8 + len ))
+      shutdown ( EF_BAD_FILE, "%s png file has a bad %.4s chunk\n",
+		 baseName[map->io.vehicle], p + 4 );
+
+    if ( !memcmp ( p + 4, "IHDR", 4 ) && ( len >= 13 )) {
+      width     = getInt ( p + 8 );
+      height    = getInt ( p + 12 );
+      depth     = p[16];
+      colorType = p[17];
+      if (( colorType != PNG_PALETTE ) && ( colorType != PNG_GRAY ))
+	shutdown ( EF_NOT_SUPPORTED, "%s png file must be a palette or gray image\n",
+		   baseName[map->io.vehicle] );
+      if ( depth > 8 )
+	shutdown ( EF_NOT_SUPPORTED, "%s png file must be 8 bits or less\n",
+		   baseName[map->io.vehicle] );
+      if ( p[18] || p[19] || p[20] )
+	shutdown ( EF_NOT_SUPPORTED, "%s png file can not be interlaced\n",
+		   baseName[map->io.vehicle] );
+
+    } else if ( !memcmp ( p + 4, "PLTE", 4 ) && ( len >= 3 )) {
+      /* same as the bitmaps - a light first color means NoGo is 0 */
+      if ( p[8] ) map->io.inverted = TRUE;
+
+    } else if ( !memcmp ( p + 4, "IDAT", 4 )) {
+      memcpy ( s.in + s.inLen, p + 8, len );
+      s.inLen += len;
+
+    } else if ( !memcmp ( p + 4, "IEND", 4 )) break;
+  }
+  freeLoadBuffer ( file );
+
+  if ( !isImageDim ( map, width, height ))
+    shutdown ( EF_BAD_DATA,
+	       "%s png file has the wrong dimentions\n",
+	       baseName[map->io.vehicle] );
+
+  map->io.bits = depth;
+
+  /* inflate to rows of filter byte and pixels, top row first */
+  rowBytes = ( width * depth + 7 ) / 8;
+  s.outLen = height * ( rowBytes + 1 );
+  if ( !( s.out = (unsigned char *) malloc ( s.outLen )))
+    shutdown ( EF_MALLOC, "Error creating %s input image buffer\n",
+	       baseName[map->io.vehicle] );
+  /* freed with the map if the data is bad */
+  map->bmp = s.out;
+
+  inflateData ( &s );
+  if ( s.outPos != s.outLen )
+    shutdown ( EF_BAD_DATA, "%s png file image data is short\n",
+	       baseName[map->io.vehicle] );
+  freeLoadBuffer ( s.in );
+
+  unfilterPng ( s.out, rowBytes, height, 1 );
+} /* end loadPng */
+
+static unsigned int
+getBits ( inflateStream *s, int count )
+{
+  unsigned int value;
+
+  while ( s->bitCount < count ) {
+    if ( s->inPos >= s->inLen )
+      shutdown ( EF_BAD_DATA, "png image data ends early\n" );
+    s->bits |= (unsigned int) s->in[ s->inPos++ ] << s->bitCount;
+    s->bitCount += 8;
+  }
+  value = s->bits & (( 1u << count ) - 1 );
+  s->bits >>= count;
+  s->bitCount -= count;
+  return value;
+}
+
+static void
+buildHuffman ( huffmanTable *h, unsigned char *lengths, int n )
+{
+  short offs[ INFLATE_MAX_BITS + 1 ];
+  int i;
+
+  memset ( h->count, 0, sizeof ( h->count ));
+  for ( i = 0; i < n; i++ ) h->count[ lengths[i] ]++;
+  h->count[0] = 0;
+
+  offs[1] = 0;
+  for ( i = 1; i < INFLATE_MAX_BITS; i++ ) offs[ i + 1 ] = offs[i] + h->count[i];
+  for ( i = 0; i < n; i++ )
+    if ( lengths[i] ) h->symbol[ offs[ lengths[i] ]++ ] = i;
+}
+
+static int
+decodeSymbol ( inflateStream *s, huffmanTable *h )
+{
+  int code = 0, first = 0, index = 0;
+  int count;
+  int len;
+
+  /* canonical codes - walk down a bit at a time */
+  for ( len = 1; len <= INFLATE_MAX_BITS; len++ ) {
+    code |= getBits ( s, 1 );
+    count = h->count[len];
+    if ( code - first < count ) return h->symbol[ index + code - first ];
+    index += count;
+    first  = ( first + count ) << 1;
+    code <<= 1;
+  }
+  shutdown ( EF_BAD_DATA, "png image data has a bad code\n" );
+  return -1;
+}
+
+static void
+inflateCodes ( inflateStream *s, huffmanTable *lit, huffmanTable *dist )
+{
+  int sym;
+  int len;
+  int d;
+
+  while (( sym = decodeSymbol ( s, lit )) != 256 ) {
+    if ( sym < 256 ) {
+      if ( s->outPos >= s->outLen )
+	shutdown ( EF_BAD_DATA, "png image data is too long\n" );
+      s->out[ s->outPos++ ] = sym;
+      continue;
+    }
+    sym -= 257;
+    if ( sym >= 29 ) shutdown ( EF_BAD_DATA, "png image data has a bad length\n" );
+    len = lenBase[sym] + getBits ( s, lenExtra[sym] );
+
+    sym = decodeSymbol ( s, dist );
+    if ( sym >= 30 ) shutdown ( EF_BAD_DATA, "png image data has a bad distance\n" );
+    d = distBase[sym] + getBits ( s, distExtra[sym] );
+
+    if (( d > s->outPos ) || ( s->outPos + len > s->outLen ))
+      shutdown ( EF_BAD_DATA, "png image data is too long\n" );
+    /* copies can overlap themselves - go a byte at a time */
+    for ( ; len; len-- ) {
+      s->out[ s->outPos ] = s->out[ s->outPos - d ];
+      s->outPos++;
+    }
+  }
+}
+
+void
+inflateData ( inflateStream *s )
+{
+  static unsigned char order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+  };
+  unsigned char lengths[ INFLATE_MAX_CODES + 32 ];
+  huffmanTable lit, dist;
+  int final, type;
+  int nlit, ndist, ncode;
+  int len, sym, rep;
+  int i;
+
+  if (( s->inLen < 2 ) || (( s->in[0] & 0x0f ) != 8 ) ||
+      ((( s->in[0] << 8 ) | s->in[1] ) % 31 ) || ( s->in[1] & 0x20 ))
+    shutdown ( EF_BAD_DATA, "png image data has a bad header\n" );
+  s->inPos = 2;
+
+  do {
+    final = getBits ( s, 1 );
+    type  = getBits ( s, 2 );
+
+    switch ( type )
+      {
+      case 0:
+	/* stored - starts on a byte */
+	s->bits = s->bitCount = 0;
+	if ( s->inPos + 4 > s->inLen )
+	  shutdown ( EF_BAD_DATA, "png image data ends early\n" );
+	len = s->in[ s->inPos ] | ( s->in[ s->inPos + 1 ] << 8 );
+	if (( len ^ 0xffff ) != ( s->in[ s->inPos + 2 ] | ( s->in[ s->inPos + 3 ] << 8 )))
+	  shutdown ( EF_BAD_DATA, "png image data has a bad stored block\n" );
+	s->inPos += 4;
+	if (( s->inPos + len > s->inLen ) || ( s->outPos + len > s->outLen ))
+	  shutdown ( EF_BAD_DATA, "png image data has a bad stored block\n" );
+	memcpy ( s->out + s->outPos, s->in + s->inPos, len );
+	s->inPos  += len;
+	s->outPos += len;
+	break;
+
+      case 1:
+	/* fixed codes */
+	for ( i = 0; i < 144; i++ ) lengths[i] = 8;
+	for ( ; i < 256; i++ ) lengths[i] = 9;
+	for ( ; i < 280; i++ ) lengths[i] = 7;
+	for ( ; i < 288; i++ ) lengths[i] = 8;
+	buildHuffman ( &lit, lengths, 288 );
+	for ( i = 0; i < 30; i++ ) lengths[i] = 5;
+	buildHuffman ( &dist, lengths, 30 );
+	inflateCodes ( s, &lit, &dist );
+	break;
+
+      case 2:
+	/* dynamic codes - the code lengths are coded themselves */
+	nlit  = getBits ( s, 5 ) + 257;
+	ndist = getBits ( s, 5 ) + 1;
+	ncode = getBits ( s, 4 ) + 4;
+	if (( nlit > 286 ) || ( ndist > 30 ))
+	  shutdown ( EF_BAD_DATA, "png image data has bad code lengths\n" );
+
+	memset ( lengths, 0, 19 );
+	for ( i = 0; i < ncode; i++ ) lengths[ order[i] ] = getBits ( s, 3 );
+	buildHuffman ( &lit, lengths, 19 );
+
+	for ( i = 0; i < nlit + ndist; ) {
+	  sym = decodeSymbol ( s, &lit );
+	  if ( sym < 16 ) {
+	    lengths[ i++ ] = sym;
+	    continue;
+	  }
+	  len = 0;
+	  if ( sym == 16 ) {
+	    if ( !i ) shutdown ( EF_BAD_DATA, "png image data has bad code lengths\n" );
+	    len = lengths[ i - 1 ];
+	    rep = 3 + getBits ( s, 2 );
+	  } else if ( sym == 17 ) rep = 3 + getBits ( s, 3 );
+	  else rep = 11 + getBits ( s, 7 );
+	  if ( i + rep > nlit + ndist )
+	    shutdown ( EF_BAD_DATA, "png image data has bad code lengths\n" );
+	  while ( rep-- ) lengths[ i++ ] = len;
+	}
+
+	buildHuffman ( &lit, lengths, nlit );
+	buildHuffman ( &dist, lengths + nlit, ndist );
+	inflateCodes ( s, &lit, &dist );
+	break;
+
+      default:
+	shutdown ( EF_BAD_DATA, "png image data has a bad block type\n" );
+      }
+  } while ( !final );
+
+  /* check the data came out right */
+  s->bits >>= s->bitCount & 7;
+  s->bitCount -= s->bitCount & 7;
+  while ( s->bitCount ) {
+    s->inPos--;
+    s->bitCount -= 8;
+  }
+  if (( s->inPos + 4 > s->inLen ) ||
+      ( getInt ( s->in + s->inPos ) != pngAdler ( 1, s->out, s->outPos )))
+    shutdown ( EF_BAD_DATA, "png image data fails its checksum\n" );
+} /* end inflateData */
+
+void
+unfilterPng ( unsigned char *scan, int rowBytes, int rows, int bpp )
+{
+  unsigned char *row;
+  unsigned char *prior;
+  int a, b, c;
+  int pa, pb, pc;
+  int y, i;
+
+  for ( y = 0; y < rows; y++ ) {
+    row   = scan + y * ( rowBytes + 1 ) + 1;
+    prior = y ? row - ( rowBytes + 1 ) : NULL;
+
+    switch ( row[-1] )
+      {
+      case 0:
+	break;
+      case 1:
+	for ( i = bpp; i < rowBytes; i++ ) row[i] += row[ i - bpp ];
+	break;
+      case 2:
+	if ( prior ) for ( i = 0; i < rowBytes; i++ ) row[i] += prior[i];
+	break;
+      case 3:
+	for ( i = 0; i < rowBytes; i++ )
+	  row[i] += ((( i >= bpp ) ? row[ i - bpp ] : 0 ) + ( prior ? prior[i] : 0 )) >> 1;
+	break;
+      case 4:
+	for ( i = 0; i < rowBytes; i++ ) {
+	  a = ( i >= bpp ) ? row[ i - bpp ] : 0;
+	  b = prior ? prior[i] : 0;
+	  c = ( prior && ( i >= bpp )) ? prior[ i - bpp ] : 0;
+	  pa = ABS ( b - c );
+	  pb = ABS ( a - c );
+	  pc = ABS ( a + b - c - c );
+	  row[i] += (( pa <= pb ) && ( pa <= pc )) ? a : ( pb <= pc ) ? b : c;
+	}
+	break;
+      default:
+	shutdown ( EF_BAD_DATA, "png image has a bad row filter\n" );
+      }
+  }
+} /* end unfilterPng */
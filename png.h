@@ -0,0 +1,107 @@
+/* png.h - png image input and output
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __PNG_H__
+#define __PNG_H__
+
+
+/************************************  includes              ************************/
+
+
+/************************************  macros                 ***********************/
+
+#define PNG_SIG_LEN    8
+#define PNG_PALETTE    3
+#define PNG_GRAY       0
+
+/* image data is written out in chunks this big */
+#define PNG_IDAT_SIZE  ( 64 * 1024 )
+
+/* deflate finds repeats in the last 32k of data with a hash of the next
+ * 3 bytes. matches longer than DEFLATE_INSERT aren't hashed all the way
+ * thru - runs of one color are most of a pathmap and cost nothing to find
+ */
+#define DEFLATE_WSIZE  32768
+#define DEFLATE_HASH   ( 1 << 15 )
+#define DEFLATE_MIN    3
+#define DEFLATE_MAX    258
+#define DEFLATE_CHAIN  32
+#define DEFLATE_INSERT 32
+
+#define INFLATE_MAX_BITS 15
+#define INFLATE_MAX_CODES 288
+
+
+/************************************  structures and enums  ************************/
+
+typedef struct _pngStream
+{
+  FILE          *fp;
+  int            rowBytes;
+  unsigned int   adler;
+  unsigned int   bits;
+  int            bitCount;
+  int            start;
+  int            end;
+  int            outLen;
+  int            head[ DEFLATE_HASH ];
+  int            prev[ DEFLATE_WSIZE ];
+  unsigned char  win[ 2 * DEFLATE_WSIZE ];
+  unsigned char  out[ PNG_IDAT_SIZE ];
+} pngStream;
+
+typedef struct _huffmanTable
+{
+  short          count[ INFLATE_MAX_BITS + 1 ];
+  short          symbol[ INFLATE_MAX_CODES ];
+} huffmanTable;
+
+typedef struct _inflateStream
+{
+  unsigned char *in;
+  int            inLen;
+  int            inPos;
+  unsigned int   bits;
+  int            bitCount;
+  unsigned char *out;
+  int            outLen;
+  int            outPos;
+} inflateStream;
+
+/************************************  prototypes             ***********************/
+
+unsigned int pngCrc     ( unsigned int crc, unsigned char *buf, int len );
+unsigned int pngAdler   ( unsigned int adler, unsigned char *buf, int len );
+void pngWriteChunk      ( FILE *fp, char *type, unsigned char *buf, int len );
+pngStream *pngOpen      ( pathfindingmap *map, FILE *fp, int width, int height );
+void pngWriteRow        ( pngStream *png, unsigned char *row );
+void pngClose           ( pngStream *png );
+void deflateData        ( pngStream *png, unsigned char *buf, int len );
+void deflateWindow      ( pngStream *png, int flush );
+int  isPngFile          ( pathfindingmap *map );
+void loadPng            ( pathfindingmap *map );
+void inflateData        ( inflateStream *s );
+void unfilterPng        ( unsigned char *scan, int rowBytes, int rows, int bpp );
+
+#endif /* __PNG_H__ */
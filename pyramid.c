@@ -0,0 +1,327 @@
+/* pyramid.c - zoom pyramid image output
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* a pyramid is the full size image cut into PYRAMID_TILE square tiles,
+ * then halved over and over down to a single pixel - the deep zoom layout
+ * browser map viewers page through. level n is 2^n pixels across and its
+ * tiles are <level>/<col>_<row>.bmp (.png with -p), row 0 at the top. the
+ * json descriptor sits next to the tile directory. tiles all of one color
+ * are written once under uniform/ and the descriptor points the tiles
+ * using them there.
+ *
+ * each level down keeps the highest palette index of a 2x2 block, so the
+ * lines and points on the diagnostic images don't fade out as you zoom out.
+ */
+
+/************************************  includes              ************************/
+#include "common.h"
+#include "commonutils.h"
+#include "image.h"
+#include "pyramid.h"
+#include "png.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+
+/************************************  functions             ************************/
+
+void
+initPyramid ( pathfindingmap *map )
+{
+  pyramidData  *p;
+  pyramidLevel *lvl;
+  char          buffer[ BUF_SIZE ];
+  char         *name;
+  int           dim;
+  int           i;
+
+  setImageColors ( map );
+
+  if ( !( p = (pyramidData *) calloc ( sizeof ( pyramidData ), 1 )))
+    shutdown ( EF_MALLOC, "Error creating %s pyramid\n", baseName[ map->io.vehicle ] );
+  map->pyramid = p;
+
+  /* everything is named after the image, less its extension */
+  p->base = fullPath ( map );
+  if (( name = strrchr ( p->base, '.' ))) *name = '\0';
+
+  p->ext = ( map->io.type & FTF_PNG ) ? FILE_PNG_EXT : FILE_BMP_EXT;
+
+  dim = map->res * imageScale ( map );
+  for ( p->levels = 1; ( 1 << ( p->levels - 1 )) < dim; p->levels++ );
+
+  if ( !( p->level = (pyramidLevel *) calloc ( sizeof ( pyramidLevel ) * p->levels, 1 )) ||
+       !( p->row = (unsigned char *) malloc ( PYRAMID_TILE )))
+    shutdown ( EF_MALLOC, "Error creating %s pyramid\n", baseName[ map->io.vehicle ] );
+
+  sprintf ( buffer, "%s%s", p->base, PYRAMID_DIR_EXT );
+  if ( !makeDir ( buffer ))
+    shutdown ( EF_FILE_OPEN, "Error creating directory: %s\n", buffer );
+  sprintf ( buffer, "%s%s%c%s", p->base, PYRAMID_DIR_EXT, PATHSEP, PYRAMID_SHARED );
+  if ( !makeDir ( buffer ))
+    shutdown ( EF_FILE_OPEN, "Error creating directory: %s\n", buffer );
+
+  for ( i = 0; i < p->levels; i++ ) {
+    lvl = &(p->level[i]);
+    lvl->dim   = dim >> ( p->levels - 1 - i );
+    lvl->tiles = ( lvl->dim + PYRAMID_TILE - 1 ) / PYRAMID_TILE;
+
+    if ( !( lvl->buf = (unsigned char *) malloc ( lvl->dim * MIN ( lvl->dim, PYRAMID_TILE ))))
+      shutdown ( EF_MALLOC, "Error creating %s pyramid\n", baseName[ map->io.vehicle ] );
+
+    sprintf ( buffer, "%s%s%c%d", p->base, PYRAMID_DIR_EXT, PATHSEP, i );
+    if ( !makeDir ( buffer ))
+      shutdown ( EF_FILE_OPEN, "Error creating directory: %s\n", buffer );
+  }
+
+  /* the descriptor is written as the tiles go by */
+  sprintf ( buffer, "%s%s", p->base, PYRAMID_DESC_EXT );
+  if ( !( p->desc = fopen ( buffer, "w" )))
+    shutdown ( EF_FILE_OPEN, "Error opening file for writing: %s\n", buffer );
+
+  if (( name = strrchr ( p->base, PATHSEP ))) name++;
+  else name = p->base;
+
+  fprintf ( p->desc,
+	    "{\n"
+	    "  \"name\": \"%s\",\n"
+	    "  \"tiles\": \"%s%s\",\n"
+	    "  \"format\": \"%s\",\n"
+	    "  \"bits\": %d,\n"
+	    "  \"tileSize\": %d,\n"
+	    "  \"width\": %d,\n"
+	    "  \"height\": %d,\n"
+	    "  \"minLevel\": 0,\n"
+	    "  \"maxLevel\": %d,\n"
+	    "  \"uniform\": {",
+	    name, name, PYRAMID_DIR_EXT, p->ext + 1, map->io.bits, PYRAMID_TILE,
+	    dim, dim, p->levels - 1 );
+} /* end initPyramid */
+
+void
+pyramidBand ( pathfindingmap *map, unsigned char *buf, int size )
+{
+  pyramidData  *p;
+  pyramidLevel *lvl;
+  unsigned char *dst;
+  int rowBytes;
+  int rows;
+  int x;
+
+  p   = map->pyramid;
+  lvl = &(p->level[ p->levels - 1 ]);
+
+  /* unpack the band into the top level, a byte a pixel */
+  rowBytes = lvl->dim * map->io.bits / 8;
+  for ( rows = size / rowBytes; rows > 0; rows--, buf += rowBytes ) {
+    dst = lvl->buf + lvl->rows * lvl->dim;
+    switch ( map->io.bits )
+      {
+      case 1:
+	for ( x = 0; x < lvl->dim; x++ )
+	  dst[x] = ( buf[ x >> 3 ] >> ( 7 - ( x & 7 ))) & 1;
+	break;
+      case 4:
+	for ( x = 0; x < lvl->dim; x++ )
+	  dst[x] = ( x & 1 ) ? buf[ x >> 1 ] & 0x0f : buf[ x >> 1 ] >> 4;
+	break;
+      default:
+	memcpy ( dst, buf, lvl->dim );
+      }
+    pyramidRowDone ( map, p->levels - 1 );
+  }
+} /* end pyramidBand */
+
+void
+pyramidRowDone ( pathfindingmap *map, int level )
+{
+  pyramidLevel *lvl;
+
+  lvl = &(map->pyramid->level[ level ]);
+  if ( ++(lvl->rows) == MIN ( lvl->dim, PYRAMID_TILE ))
+    writePyramidStrip ( map, level );
+} /* end pyramidRowDone */
+
+void
+writePyramidStrip ( pathfindingmap *map, int level )
+{
+  pyramidLevel *lvl;
+  pyramidLevel *next;
+  unsigned char *src;
+  unsigned char *dst;
+  int col;
+  int x, y;
+
+  lvl = &(map->pyramid->level[ level ]);
+
+  /* strips come up from the bottom of the image, tile rows are
+   * counted down from the top
+   */
+  for ( col = 0; col < lvl->tiles; col++ )
+    writePyramidTile ( map, level, col, lvl->tiles - 1 - lvl->strip,
+		       lvl->buf + col * PYRAMID_TILE, lvl->dim,
+		       MIN ( lvl->dim, PYRAMID_TILE ));
+
+  /* and the strip at half size goes on to the next level down */
+  if ( level > 0 ) {
+    next = &(map->pyramid->level[ level - 1 ]);
+    for ( y = 0; y < lvl->rows; y += 2 ) {
+      src = lvl->buf + y * lvl->dim;
+      dst = next->buf + next->rows * next->dim;
+      for ( x = 0; x < next->dim; x++ )
+	dst[x] = MAX ( MAX ( src[ 2*x ], src[ 2*x + 1 ] ),
+		       MAX ( src[ lvl->dim + 2*x ], src[ lvl->dim + 2*x + 1 ] ));
+      pyramidRowDone ( map, level - 1 );
+    }
+  }
+  lvl->rows = 0;
+  lvl->strip++;
+} /* end writePyramidStrip */
+
+void
+writePyramidTile ( pathfindingmap *map, int level, int col, int row,
+		   unsigned char *src, int stride, int dim )
+{
+  pyramidData *p;
+  char buffer[ BUF_SIZE ];
+  int color;
+  int size;
+  int x, y;
+
+  p = map->pyramid;
+
+  /* see if the tile is all one color */
+  color = src[0];
+  for ( y = 0; y < dim; y++ ) {
+    for ( x = 0; x < dim; x++ ) if ( src[ y * stride + x ] != color ) break;
+    if ( x < dim ) break;
+  }
+
+  if ( y < dim ) {
+    sprintf ( buffer, "%s%s%c%d%c%d_%d%s", p->base, PYRAMID_DIR_EXT,
+	      PATHSEP, level, PATHSEP, col, row, p->ext );
+    writeTile ( map, buffer, src, stride, dim );
+    p->written++;
+    return;
+  }
+
+  /* one color tiles are shared by every tile the same size */
+  for ( size = 0; ( 1 << size ) < dim; size++ );
+  if ( !p->shared[ size ][ color ] ) {
+    sprintf ( buffer, "%s%s%c%s%c%d_%d%s", p->base, PYRAMID_DIR_EXT,
+	      PATHSEP, PYRAMID_SHARED, PATHSEP, dim, color, p->ext );
+    writeTile ( map, buffer, src, stride, dim );
+    p->shared[ size ][ color ] = TRUE;
+    p->written++;
+  }
+
+  fprintf ( p->desc, "%s\n    \"%d/%d_%d\": \"%s/%d_%d%s\"",
+	    ( p->uniform ? "," : "" ), level, col, row,
+	    PYRAMID_SHARED, dim, color, p->ext );
+  p->uniform++;
+} /* end writePyramidTile */
+
+void
+writeTile ( pathfindingmap *map, char *name,
+	    unsigned char *src, int stride, int dim )
+{
+  FILE *fp;
+  pngStream *png = NULL;
+  unsigned char *dst;
+  int bytes;
+  int x, y;
+
+  if ( !( fp = fopen ( name, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening file for writing: %s\n", name );
+
+  /* png rows go top down, bitmap rows bottom up with 4 byte padding */
+  if ( map->io.type & FTF_PNG ) {
+    png    = pngOpen ( map, fp, dim, dim );
+    bytes  = png->rowBytes;
+    src   += ( dim - 1 ) * stride;
+    stride = -stride;
+  } else {
+    writeBmpHeaderDim ( map, fp, dim, dim );
+    bytes = (( dim * map->io.bits + 31 ) / 32 ) * 4;
+  }
+
+  /* pack the rows back down to the image depth */
+  dst = map->pyramid->row;
+  for ( y = 0; y < dim; y++, src += stride ) {
+    memset ( dst, 0, bytes );
+    switch ( map->io.bits )
+      {
+      case 1:
+	for ( x = 0; x < dim; x++ )
+	  if ( src[x] ) dst[ x >> 3 ] |= 0x80 >> ( x & 7 );
+	break;
+      case 4:
+	for ( x = 0; x < dim; x++ )
+	  dst[ x >> 1 ] |= ( x & 1 ) ? src[x] : src[x] << 4;
+	break;
+      default:
+	memcpy ( dst, src, dim );
+      }
+    if ( png ) pngWriteRow ( png, dst );
+    else if ( !fwrite ( dst, bytes, 1, fp ))
+      shutdown ( EF_FILE_WRITE, "Error writing to pyramid tile: %s\n", name );
+  }
+
+  if ( png ) pngClose ( png );
+  fclose ( fp );
+} /* end writeTile */
+
+void
+finishPyramid ( pathfindingmap *map )
+{
+  pyramidData *p;
+
+  if ( !( p = map->pyramid )) return;
+
+  fprintf ( p->desc, "%s  }\n}\n", ( p->uniform ? "\n" : "" ));
+
+  debug ( DBG_INFO, "%s pyramid: %d levels, %d tiles written, %d one color tiles shared\n",
+	  baseName[ map->io.vehicle ], p->levels, p->written, p->uniform );
+  freePyramid ( map );
+} /* end finishPyramid */
+
+/* finished or not - a build that failed lets go of it with the map */
+void
+freePyramid ( pathfindingmap *map )
+{
+  pyramidData *p;
+  int i;
+
+  if ( !( p = map->pyramid )) return;
+
+  if ( p->desc ) fclose ( p->desc );
+  if ( p->level )
+    for ( i = 0; i < p->levels; i++ ) free ( p->level[i].buf );
+  free ( p->level );
+  free ( p->row );
+  free ( p->base );
+  free ( p );
+  map->pyramid = NULL;
+} /* end freePyramid */
@@ -0,0 +1,85 @@
+/* pyramid.h - zoom pyramid image output
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __PYRAMID_H__
+#define __PYRAMID_H__
+
+
+/************************************  includes              ************************/
+
+
+/************************************  macros                 ***********************/
+
+/* pixels across and down a pyramid tile */
+#define PYRAMID_TILE 256
+
+/* tile sizes from 1 to PYRAMID_TILE pixels */
+#define PYRAMID_SIZES 9
+
+#define PYRAMID_DIR_EXT   "_files"
+#define PYRAMID_DESC_EXT  ".json"
+#define PYRAMID_SHARED    "uniform"
+
+
+/************************************  structures and enums  ************************/
+
+/* each level of the pyramid collects a strip of tiles, one byte a
+ * pixel, before writing it and passing it down to the next level
+ */
+typedef struct _pyramidLevel
+{
+  int            dim;
+  int            tiles;
+  int            rows;
+  int            strip;
+  unsigned char *buf;
+} pyramidLevel;
+
+typedef struct _pyramidData
+{
+  char                 *base;
+  char                 *ext;
+  FILE                 *desc;
+  int                   levels;
+  int                   written;
+  int                   uniform;
+  unsigned char         shared[PYRAMID_SIZES][256];
+  unsigned char        *row;
+  struct _pyramidLevel *level;
+} pyramidData;
+
+/************************************  prototypes             ***********************/
+
+void initPyramid      ( pathfindingmap *map );
+void pyramidBand      ( pathfindingmap *map, unsigned char *buf, int size );
+void pyramidRowDone   ( pathfindingmap *map, int level );
+void writePyramidStrip ( pathfindingmap *map, int level );
+void writePyramidTile ( pathfindingmap *map, int level, int col, int row,
+			unsigned char *src, int stride, int dim );
+void writeTile        ( pathfindingmap *map, char *name,
+			unsigned char *src, int stride, int dim );
+void finishPyramid    ( pathfindingmap *map );
+void freePyramid      ( pathfindingmap *map );
+
+#endif /* __PYRAMID_H__ */
@@ -0,0 +1,346 @@
+/* reach.c - what can be reached from the spawn points
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -r n, level n of the search map is flooded from the first spawn
+ * point (-s) and the others are checked - a spawn or control point
+ * sealed off by a stray NoGo pixel shows up here, not on a live server.
+ *
+ * the map is held as bits, 64 pixels to a word. a row is filled across
+ * its runs of DoGo a word at a time with shifts - no pixel is looked at
+ * on its own - then the row after and the row before take the pixels
+ * reached next to them, the 8 around as the smallOnes areas are made. the
+ * rows are swept forward and back until nothing changes, only looking at
+ * rows whose neighbours changed. NoGo tiles are words of 0 and are passed
+ * over, as are words already reached in full.
+ *
+ * the reached area is drawn in TankNLevelNReach.bmp, with the spawn points.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "image.h"
+#include "reach.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern THREAD_LOCAL userData data;
+
+/************************************  prototypes             ***********************/
+
+static void       loadPass     ( reachData *rd, pathfindingmap *map );
+static int        floodRow     ( reachData *rd, int row, int from );
+static reachWord  fillUp       ( reachWord gen, reachWord pro );
+static reachWord  fillDown     ( reachWord gen, reachWord pro );
+static int        isReached    ( reachData *rd, int x, int y );
+static void       writeReach   ( reachData *rd, pathfindingmap *map, int level );
+
+/************************************  functions             ************************/
+
+void
+floodReach ( mapIOData *in )
+{
+  mapIOData out = {0};
+  pathfindingmap *map;
+  reachData rd;
+  int level;
+  int x, y;
+  int row;
+  int changed;
+  int sealed = 0;
+  int i;
+
+  level = data.reachLevel;
+  if ( !( in->type & FTF_MAP ) || in->level ) {
+    debug ( DBG_WARN, "Only maps made from a level 0 search map are flooded, not %s\n",
+	    in->path );
+    return;
+  }
+  if ( level > ( ISSEA ( in->vehicle ) ? 5 : 2 )) {
+    debug ( DBG_WARN, "There is no level %d %s map to flood\n", level, baseName[ in->vehicle ] );
+    return;
+  }
+
+  out.path    = data.outpath;
+  out.vehicle = in->vehicle;
+  out.type    = FTF_MAP;
+  out.level   = level;
+  if ( !( map = getMap ( &(data.maps), in, &out )))
+    shutdown ( EF_FILE_READ, "Error loading %s\n", in->path );
+  /* small maps run out of tiles before the last level */
+  if (( map->rowsPerTile != TILE_DIM ) || ( map->bytesPerRow != ROW_BYTES ) || !map->tiles ) {
+    debug ( DBG_WARN, "The level %d %s map can't be flooded\n", level, baseName[ in->vehicle ] );
+    return;
+  }
+
+  memset ( &rd, 0, sizeof ( reachData ));
+  rd.words = map->tilesPerRow;
+  rd.rows  = map->tilesPerCol * TILE_DIM;
+  if ( !( rd.pass   = (reachWord *) malloc ( sizeof ( reachWord ) * rd.words * rd.rows )) ||
+       !( rd.reach  = (reachWord *) calloc ( sizeof ( reachWord ), rd.words * rd.rows )) ||
+       !( rd.toNext = (unsigned char *) calloc ( rd.rows, 1 )) ||
+       !( rd.toPrev = (unsigned char *) calloc ( rd.rows, 1 )))
+    shutdown ( EF_MALLOC, "Memory allocation error flooding the %s map\n", baseName[ in->vehicle ] );
+  loadPass ( &rd, map );
+
+  /* spawn points are level 0 pixels */
+  x = data.spawn[0][0] >> level;
+  y = data.spawn[0][1] >> level;
+  if ( !INRANGE ( x, 0, rd.words * TILE_DIM - 1 ) || !INRANGE ( y, 0, rd.rows - 1 ) ||
+       !( rd.pass[ y * rd.words + x / TILE_DIM ] & ( 1ULL << ( x % TILE_DIM )))) {
+    debug ( DBG_WARN, "%s spawn point %d,%d is not on DoGo at level %d\n",
+	    baseName[ in->vehicle ], data.spawn[0][0], data.spawn[0][1], level );
+    data.problems++;
+  }
+  else {
+    rd.reach[ y * rd.words + x / TILE_DIM ] = 1ULL << ( x % TILE_DIM );
+    floodRow ( &rd, y, -1 );
+    rd.toNext[y] = rd.toPrev[y] = TRUE;
+  }
+
+  /* forward then back, until neither sweep finds more */
+  do {
+    changed = FALSE;
+    for ( row = 1; row < rd.rows; row++ )
+      if ( rd.toNext[ row - 1 ] ) {
+	rd.toNext[ row - 1 ] = FALSE;
+	changed |= floodRow ( &rd, row, row - 1 );
+      }
+    for ( row = rd.rows - 2; row >= 0; row-- )
+      if ( rd.toPrev[ row + 1 ] ) {
+	rd.toPrev[ row + 1 ] = FALSE;
+	changed |= floodRow ( &rd, row, row + 1 );
+      }
+  } while ( changed );
+
+  for ( i = 1; i < data.spawns; i++ )
+    if ( !isReached ( &rd, data.spawn[i][0] >> level, data.spawn[i][1] >> level )) {
+      debug ( DBG_WARN, "%s spawn point %d,%d can't be reached from %d,%d at level %d\n",
+	      baseName[ in->vehicle ], data.spawn[i][0], data.spawn[i][1],
+	      data.spawn[0][0], data.spawn[0][1], level );
+      sealed++;
+    }
+  debug ( DBG_NOTICE, "%s level %d: %d of %d spawn points reached from %d,%d\n",
+	  baseName[ in->vehicle ], level, data.spawns - 1 - sealed, data.spawns - 1,
+	  data.spawn[0][0], data.spawn[0][1] );
+  data.problems += sealed;
+
+  writeReach ( &rd, map, level );
+
+  free ( rd.pass );
+  free ( rd.reach );
+  free ( rd.toNext );
+  free ( rd.toPrev );
+} /* end floodReach */
+
+/* one word for each tile across a row, uniform tiles are all 0s or 1s */
+static void
+loadPass ( reachData *rd, pathfindingmap *map )
+{
+  tileData *tile;
+  unsigned char *bits;
+  reachWord word;
+  int row, col;
+  int i;
+
+  for ( row = 0; row < rd->rows; row++ )
+    for ( col = 0; col < rd->words; col++ ) {
+      tile = &(map->tile[ ( row / TILE_DIM ) * map->tilesPerRow + col ]);
+      if ( tile->flag != TDT_MIXED ) {
+	rd->pass[ row * rd->words + col ] = ( tile->flag == TDT_DOGO ) ? ~0ULL : 0;
+	continue;
+      }
+      bits = tile->bits + ( row % TILE_DIM ) * ROW_BYTES;
+      for ( word = 0, i = ROW_BYTES - 1; i >= 0; i-- ) word = ( word << 8 ) | bits[i];
+      rd->pass[ row * rd->words + col ] = ~word;
+    }
+} /* end loadPass */
+
+/* take what row from reached next to row, then fill along the row.
+ * from -1 only fills. returns TRUE if the row changed */
+static int
+floodRow ( reachData *rd, int row, int from )
+{
+  reachWord *reach;
+  reachWord *pass;
+  reachWord *near = NULL;
+  reachWord  word;
+  reachWord  carry;
+  int changed = FALSE;
+  int i;
+
+  reach = rd->reach + row * rd->words;
+  pass  = rd->pass  + row * rd->words;
+  if ( from >= 0 ) near = rd->reach + from * rd->words;
+
+  /* filling to higher pixels, carried into the next word ... */
+  carry = 0;
+  for ( i = 0; i < rd->words; i++ ) {
+    if ( !pass[i] || ( reach[i] == pass[i] )) {
+      carry = reach[i] >> 63;
+      continue;
+    }
+    word = reach[i] | carry;
+    if ( near )
+      word |= near[i] | ( near[i] << 1 ) | ( near[i] >> 1 ) |
+	( i ? near[ i - 1 ] >> 63 : 0 ) | (( i < rd->words - 1 ) ? near[ i + 1 ] << 63 : 0 );
+    word = fillUp ( word & pass[i], pass[i] );
+    carry = word >> 63;
+    if ( word != reach[i] ) {
+      reach[i] = word;
+      changed  = TRUE;
+    }
+  }
+
+  /* ... then to lower ones */
+  carry = 0;
+  for ( i = rd->words - 1; i >= 0; i-- ) {
+    if ( !pass[i] || ( reach[i] == pass[i] )) {
+      carry = reach[i] << 63;
+      continue;
+    }
+    word = fillDown (( reach[i] | carry ) & pass[i], pass[i] );
+    carry = word << 63;
+    if ( word != reach[i] ) {
+      reach[i] = word;
+      changed  = TRUE;
+    }
+  }
+
+  if ( changed ) rd->toNext[ row ] = rd->toPrev[ row ] = TRUE;
+  return changed;
+} /* end floodRow */
+
+/* every bit of pro that a bit of gen reaches along a row of pro */
+reachWord
+fillRow ( reachWord gen, reachWord pro )
+{
+  return fillDown ( fillUp ( gen & pro, pro ), pro );
+} /* end fillRow */
+
+/* every bit of pro that a bit of gen reaches going up through pro */
+static reachWord
+fillUp ( reachWord gen, reachWord pro )
+{
+  gen |= pro & ( gen << 1 );
+  pro &= pro << 1;
+  gen |= pro & ( gen << 2 );
+  pro &= pro << 2;
+  gen |= pro & ( gen << 4 );
+  pro &= pro << 4;
+  gen |= pro & ( gen << 8 );
+  pro &= pro << 8;
+  gen |= pro & ( gen << 16 );
+  pro &= pro << 16;
+  gen |= pro & ( gen << 32 );
+  return gen;
+} /* end fillUp */
+
+static reachWord
+fillDown ( reachWord gen, reachWord pro )
+{
+  gen |= pro & ( gen >> 1 );
+  pro &= pro >> 1;
+  gen |= pro & ( gen >> 2 );
+  pro &= pro >> 2;
+  gen |= pro & ( gen >> 4 );
+  pro &= pro >> 4;
+  gen |= pro & ( gen >> 8 );
+  pro &= pro >> 8;
+  gen |= pro & ( gen >> 16 );
+  pro &= pro >> 16;
+  gen |= pro & ( gen >> 32 );
+  return gen;
+} /* end fillDown */
+
+static int
+isReached ( reachData *rd, int x, int y )
+{
+  if ( !INRANGE ( x, 0, rd->words * TILE_DIM - 1 ) || !INRANGE ( y, 0, rd->rows - 1 ))
+    return FALSE;
+  return ( rd->reach[ y * rd->words + x / TILE_DIM ] >> ( x % TILE_DIM )) & 1;
+} /* end isReached */
+
+/* a 4 bit bitmap, rows in the order of the other images */
+static void
+writeReach ( reachData *rd, pathfindingmap *map, int level )
+{
+  pathfindingmap image;
+  char buffer[ BUF_SIZE ];
+  unsigned char *line;
+  FILE *fp;
+  int width;
+  int x, y;
+  int color;
+  int i;
+
+  memset ( &image, 0, sizeof ( pathfindingmap ));
+  image.io.type    = FTF_IMG | FTF_MAP;
+  image.io.vehicle = map->io.vehicle;
+  image.io.level   = level;
+  image.io.bits    = 4;
+
+  width = rd->words * TILE_DIM;
+  if ( !( line = (unsigned char *) malloc ( width / 2 )))
+    shutdown ( EF_MALLOC, "Memory allocation error drawing the %s reach\n",
+	       baseName[ map->io.vehicle ] );
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_REACH, data.outpath, PATHSEP,
+	     baseName[ map->io.vehicle ], map->io.vehicle, level, FILE_BMP_EXT );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+  writeBmpHeaderDim ( &image, fp, width, rd->rows );
+
+  for ( y = 0; y < rd->rows; y++ ) {
+    memset ( line, 0, width / 2 );
+    for ( x = 0; x < width; x++ ) {
+      if ( !(( rd->pass[ y * rd->words + x / TILE_DIM ] >> ( x % TILE_DIM )) & 1 ))
+	color = REACH_NOGO;
+      else color = isReached ( rd, x, y ) ? REACH_REACHED : REACH_MISSED;
+      line[ x / 2 ] |= ( x % 2 ) ? color : color << 4;
+    }
+
+    /* the spawn points are 3 pixels across */
+    for ( i = 0; i < data.spawns; i++ ) {
+      if ( ABS (( data.spawn[i][1] >> level ) - y ) > 1 ) continue;
+      color = isReached ( rd, data.spawn[i][0] >> level, data.spawn[i][1] >> level ) ?
+	REACH_TARGET : REACH_SEALED;
+      for ( x = ( data.spawn[i][0] >> level ) - 1; x <= ( data.spawn[i][0] >> level ) + 1; x++ )
+	if ( INRANGE ( x, 0, width - 1 ))
+	  line[ x / 2 ] = ( x % 2 ) ? ( line[ x / 2 ] & 0xf0 ) | color :
+	    ( line[ x / 2 ] & 0x0f ) | ( color << 4 );
+    }
+    if ( !fwrite ( line, width / 2, 1, fp ))
+      shutdown ( EF_FILE_WRITE, "Error writing the %s reach image\n",
+		 baseName[ map->io.vehicle ] );
+  }
+
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing the %s reach image\n",
+	       baseName[ map->io.vehicle ] );
+  free ( line );
+} /* end writeReach */
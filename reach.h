@@ -0,0 +1,59 @@
+/* reach.h - what can be reached from the spawn points
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __REACH_H__
+#define __REACH_H__
+
+
+/************************************  macros                 ***********************/
+
+/* colors of the reach image, from the default palette */
+#define REACH_NOGO      15
+#define REACH_MISSED    8     /* DoGo that can't be reached */
+#define REACH_REACHED   10
+#define REACH_TARGET    7     /* a spawn point that was reached ... */
+#define REACH_SEALED    11    /* ... or not */
+
+/************************************  structures and enums  ************************/
+
+/* a map as rows of 64 bit words, a word for each tile across. bit n of a
+ * word is pixel n of the tile's row, as the map files have them */
+typedef unsigned long long reachWord;
+
+typedef struct _reachData
+{
+  int             words;    /* in a row */
+  int             rows;
+  reachWord      *pass;     /* DoGo pixels */
+  reachWord      *reach;    /* those reached so far */
+  unsigned char  *toNext;   /* rows changed that row + 1 hasn't seen */
+  unsigned char  *toPrev;   /* ... and that row - 1 hasn't */
+} reachData;
+
+/************************************  prototypes             ***********************/
+
+void             floodReach       ( mapIOData *in );
+reachWord        fillRow          ( reachWord gen, reachWord pro );
+
+#endif /* __REACH_H__ */
@@ -0,0 +1,432 @@
+/* registry.c - keeps track of the maps in memory
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* every map made while running is kept here, hashed on its type, vehicle,
+ * level and the file the job read it from, so getMap finds it without a
+ * walk of the map list. the maps are also kept in order of use so that
+ * with a memory budget (-m) the least recently used ones are freed between
+ * jobs. a freed map leaves a ghost behind, as does a map whose file came
+ * out of the cache (-c); if a later job needs it the compressed map is
+ * made again from the source file.
+ *
+ * only compressed maps are rebuilt - info and smallOnes maps are always
+ * filled in fresh by the functions that ask for them.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "registry.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern char *inputType[];
+extern THREAD_LOCAL userData data;
+
+static THREAD_LOCAL mapRegistry reg;
+
+/************************************  functions             ************************/
+
+static int
+sameSource ( char *a, char *b )
+{
+  if ( !a || !b ) return ( a == b );
+  return !strcmp ( a, b );
+} /* end sameSource */
+
+static int
+sameKey ( mapIOData *a, mapIOData *b )
+{
+  return (( IMGTYPES(a->type) == IMGTYPES(b->type) ) &&
+	  ( a->vehicle == b->vehicle ) &&
+	  ( a->level   == b->level   ));
+} /* end sameKey */
+
+static void
+lruUnlink ( pathfindingmap *map )
+{
+  if ( map->lruPrev ) map->lruPrev->lruNext = map->lruNext;
+  else reg.newest = map->lruNext;
+  if ( map->lruNext ) map->lruNext->lruPrev = map->lruPrev;
+  else reg.oldest = map->lruPrev;
+  map->lruPrev = map->lruNext = NULL;
+} /* end lruUnlink */
+
+static void
+lruPush ( pathfindingmap *map )
+{
+  map->lruPrev = NULL;
+  map->lruNext = reg.newest;
+  if ( reg.newest ) reg.newest->lruPrev = map;
+  else reg.oldest = map;
+  reg.newest = map;
+} /* end lruPush */
+
+static void
+hashUnlink ( pathfindingmap *map )
+{
+  pathfindingmap **p;
+
+  p = &( reg.bucket[ map->hash & ( REGISTRY_BUCKETS - 1 ) ] );
+  while ( *p && *p != map ) p = &((*p)->hashNext);
+  if ( *p ) *p = map->hashNext;
+  map->hashNext = NULL;
+} /* end hashUnlink */
+
+static void
+hashPush ( pathfindingmap *map )
+{
+  pathfindingmap **p;
+
+  map->hash = mapHash ( map->io.type, map->io.vehicle, map->io.level, map->source );
+  p = &( reg.bucket[ map->hash & ( REGISTRY_BUCKETS - 1 ) ] );
+  map->hashNext = *p;
+  *p = map;
+} /* end hashPush */
+
+static mapGhost **
+findGhost ( mapIOData *io )
+{
+  mapGhost **p;
+  unsigned int hash;
+
+  hash = mapHash ( io->type, io->vehicle, io->level, reg.source );
+  for ( p = &( reg.ghost[ hash & ( REGISTRY_BUCKETS - 1 ) ] ); *p; p = &((*p)->next) )
+    if ( sameKey ( &((*p)->io), io ) && sameSource ( (*p)->source, reg.source ))
+      return p;
+  return NULL;
+} /* end findGhost */
+
+static mapGhost *
+takeGhost ( mapIOData *io )
+{
+  mapGhost **p;
+  mapGhost  *g;
+
+  if ( !( p = findGhost ( io ))) return NULL;
+  g  = *p;
+  *p = g->next;
+  return g;
+} /* end takeGhost */
+
+static void
+freeGhost ( mapGhost *g )
+{
+  if ( g->source ) free ( g->source );
+  free ( g );
+} /* end freeGhost */
+
+void
+setMapSource ( mapIOData *in )
+{
+  /* the file the next job reads from - part of every map's key */
+  if ( !sameSource ( reg.source, in->path )) {
+    if ( reg.source ) free ( reg.source );
+    reg.source = ( in->path ) ? dupString ( in->path ) : NULL;
+  }
+  copyIO ( &(reg.root), *in );
+  reg.root.path = reg.source;
+} /* end setMapSource */
+
+unsigned int
+mapHash ( int type, int vehicle, int level, char *source )
+{
+  /* FNV-1a over the key */
+  unsigned int   hash = 2166136261u;
+  int            key[3];
+  unsigned char *p;
+  size_t         i;
+
+  key[0] = IMGTYPES(type);
+  key[1] = vehicle;
+  key[2] = level;
+  p = (unsigned char *) key;
+  for ( i = 0; i < sizeof ( key ); i++ )
+    hash = ( hash ^ p[i] ) * 16777619u;
+  if ( source )
+    for ( p = (unsigned char *) source; *p; p++ )
+      hash = ( hash ^ *p ) * 16777619u;
+  return hash;
+} /* end mapHash */
+
+void
+registerMap ( pathfindingmap *map )
+{
+  mapGhost *g;
+
+  map->source = ( reg.source ) ? dupString ( reg.source ) : NULL;
+  map->serial = reg.serial++;
+  hashPush ( map );
+  lruPush ( map );
+
+  /* it's back - it keeps its place, the ghost isn't needed */
+  if (( g = takeGhost ( &(map->io) ))) {
+    map->serial = g->serial;
+    freeGhost ( g );
+  }
+
+  map->bytes = mapBytes ( map );
+  reg.bytes += map->bytes;
+} /* end registerMap */
+
+void
+unregisterMap ( pathfindingmap *map )
+{
+  /* already let go of by releaseMaps */
+  if ( !map->lruPrev && ( reg.newest != map )) return;
+  hashUnlink ( map );
+  lruUnlink ( map );
+  reg.bytes -= map->bytes;
+  map->bytes = 0;
+  if ( map->source ) free ( map->source );
+  map->source = NULL;
+} /* end unregisterMap */
+
+pathfindingmap *
+lookupMap ( mapIOData io )
+{
+  pathfindingmap *map;
+  pathfindingmap *found = NULL;
+  mapGhost      **g;
+  unsigned int    hash;
+
+  /* 8 bit images hand their map the source's io, so two maps can share a
+   * key - the one made first is the one wanted */
+  hash = mapHash ( io.type, io.vehicle, io.level, reg.source );
+  for ( map = reg.bucket[ hash & ( REGISTRY_BUCKETS - 1 ) ]; map; map = map->hashNext )
+    if ( sameKey ( &(map->io), &io ) && sameSource ( map->source, reg.source ) &&
+	 ( !found || map->serial < found->serial ))
+      found = map;
+
+  /* a map made before it was let go - that one has to come back */
+  if ( found && ( g = findGhost ( &io )) && (*g)->serial < found->serial )
+    return NULL;
+  return found;
+} /* end lookupMap */
+
+void
+touchMap ( pathfindingmap *map )
+{
+  /* getMap may have changed what the map is - file it under its new key */
+  if ( map->hash != mapHash ( map->io.type, map->io.vehicle, map->io.level, map->source )) {
+    hashUnlink ( map );
+    hashPush ( map );
+  }
+  lruUnlink ( map );
+  lruPush ( map );
+
+  reg.bytes -= map->bytes;
+  map->bytes = mapBytes ( map );
+  reg.bytes += map->bytes;
+  if ( reg.bytes > reg.peak ) reg.peak = reg.bytes;
+} /* end touchMap */
+
+long long
+mapBytes ( pathfindingmap *map )
+{
+  long long bytes;
+  int i, j;
+
+  bytes = sizeof ( pathfindingmap );
+  if ( map->tile ) {
+    bytes += (long long) sizeof ( tileData ) * map->tiles;
+    for ( i = 0; i < map->tiles; i++ )
+      if ( map->tile[i].bits ) bytes += map->bytesPerTile;
+  }
+  if ( map->so )
+    bytes += (long long) sizeof ( smallOnesData ) * map->tiles;
+  if ( map->img ) {
+    bytes += (long long) sizeof ( tileImageData ) * map->tiles;
+    for ( i = 0; i < map->tiles; i++ )
+      for ( j = 0; j < 4; j++ )
+	if ( map->img[i].pt[j] ) bytes += TILE_BYTES;
+  }
+  if ( map->dirty ) bytes += map->tiles;
+  return bytes;
+} /* end mapBytes */
+
+void
+trimMaps ( void )
+{
+  pathfindingmap *map;
+  long long       budget;
+
+  /* maps are filled in after they are registered - count them again */
+  reg.bytes = 0;
+  for ( map = reg.newest; map; map = map->lruNext ) {
+    map->bytes = mapBytes ( map );
+    reg.bytes += map->bytes;
+  }
+  if ( reg.bytes > reg.peak ) reg.peak = reg.bytes;
+
+  if ( !data.budget ) return;
+  budget = data.budget * REGISTRY_MB;
+  while ( reg.oldest && reg.bytes > budget )
+    evictMap ( reg.oldest );
+} /* end trimMaps */
+
+static void
+addGhost ( mapIOData *io, char *source, int serial )
+{
+  mapGhost *g;
+  int       bucket;
+
+  if (!( g = (mapGhost *) malloc ( sizeof ( mapGhost ))))
+    shutdown ( EF_MALLOC, "Memory allocation error creating map ghost\n" );
+  copyIO ( &(g->io), *io );
+  g->io.path  = NULL;
+  g->io.type &= ~( FTF_READ | FTF_WRITE );
+  g->source   = ( source ) ? dupString ( source ) : NULL;
+  g->serial   = serial;
+  bucket      = mapHash ( g->io.type, g->io.vehicle, g->io.level, g->source )
+                & ( REGISTRY_BUCKETS - 1 );
+  g->next     = reg.ghost[ bucket ];
+  reg.ghost[ bucket ] = g;
+} /* end addGhost */
+
+void
+evictMap ( pathfindingmap *map )
+{
+  debug ( DBG_INFO, "Evicting %s %s level %d map (%lld bytes)\n",
+	  baseName[map->io.vehicle], inputType[findLn2 ( IMGTYPES(map->io.type))],
+	  map->io.level, map->bytes );
+
+  /* remember what it was so it can be made again */
+  addGhost ( &(map->io), map->source, map->serial );
+
+  reg.evicted++;
+  freeMap ( &map );
+} /* end evictMap */
+
+void
+ghostMap ( mapIOData *io )
+{
+  /* a map that was never made - the cache had its file - but later jobs
+   * may still need it */
+  if ( !lookupMap ( *io ) && !findGhost ( io ))
+    addGhost ( io, reg.source, reg.serial++ );
+} /* end ghostMap */
+
+pathfindingmap *
+rebuildMap ( mapIOData *io )
+{
+  pathfindingmap *map;
+  mapGhost       *g;
+  mapIOData       root = {0};
+  mapIOData       want = {0};
+  int             serial;
+
+  /* compressed maps are made from the source file, the rest are filled in
+   * by whoever asked for them */
+  if ( IMGTYPES(io->type) != FTF_MAP || !reg.root.path ) return NULL;
+  if ( !( g = takeGhost ( io ))) return NULL;
+
+  debug ( DBG_NOTICE, "Rebuilding evicted %s %s level %d map\n",
+	  baseName[g->io.vehicle], inputType[findLn2 ( IMGTYPES(g->io.type))],
+	  g->io.level );
+
+  copyIO ( &root, reg.root );
+  copyIO ( &want, g->io );
+  serial = g->serial;
+  freeGhost ( g );
+  reg.rebuilt++;
+
+  if ( sameKey ( &root, &want ))
+    map = getMap ( &(data.maps), &root, NULL );
+  else
+    map = getMap ( &(data.maps), &root, &want );
+  if ( map ) map->serial = serial;
+  return map;
+} /* end rebuildMap */
+
+pathfindingmap *
+releaseMaps ( char *source )
+{
+  pathfindingmap  *map;
+  pathfindingmap  *next;
+  pathfindingmap  *list = NULL;
+  mapGhost       **g;
+  mapGhost        *dead;
+  int i;
+
+  /* the file changed - its maps come out of the registry and the map list
+   * and are handed back in a list of their own */
+  for ( map = data.maps; map; map = next ) {
+    next = map->next;
+    if ( !sameSource ( map->source, source )) continue;
+    unregisterMap ( map );
+    if ( map->prev ) map->prev->next = map->next;
+    else data.maps = map->next;
+    if ( map->next ) map->next->prev = map->prev;
+    map->prev = NULL;
+    map->next = list;
+    if ( list ) list->prev = map;
+    list = map;
+  }
+
+  /* nothing of the old file is made again */
+  for ( i = 0; i < REGISTRY_BUCKETS; i++ )
+    for ( g = &( reg.ghost[i] ); *g; )
+      if ( sameSource ( (*g)->source, source )) {
+	dead = *g;
+	*g   = dead->next;
+	freeGhost ( dead );
+      } else g = &((*g)->next);
+
+  return list;
+} /* end releaseMaps */
+
+void
+swapRegistry ( mapRegistry *other )
+{
+  mapRegistry tmp;
+
+  /* each library context has a registry of its own */
+  tmp    = reg;
+  reg    = *other;
+  *other = tmp;
+} /* end swapRegistry */
+
+void
+freeRegistry ( void )
+{
+  mapGhost *g;
+  int i;
+
+  if ( data.budget )
+    debug ( DBG_NOTICE, "Map budget %d MB: %d maps evicted, %d rebuilt, peak %lld KB\n",
+	    data.budget, reg.evicted, reg.rebuilt, reg.peak / 1024 );
+
+  for ( i = 0; i < REGISTRY_BUCKETS; i++ )
+    while (( g = reg.ghost[i] )) {
+      reg.ghost[i] = g->next;
+      freeGhost ( g );
+    }
+  if ( reg.source ) free ( reg.source );
+  reg.source = NULL;
+  reg.root.path = NULL;
+} /* end freeRegistry */
@@ -0,0 +1,86 @@
+/* registry.h - map registry header file
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __REGISTRY_H__
+#define __REGISTRY_H__
+
+
+/************************************  macros                 ***********************/
+
+/* hash buckets for the maps, a power of 2 */
+#define REGISTRY_BUCKETS 256
+
+#define REGISTRY_MB ( 1024LL * 1024LL )
+
+
+/************************************  structures and enums  ************************/
+
+/* a map let go to stay under the memory budget. it is remembered by
+ * key so it can be made again from the source file when it is asked for
+ */
+typedef struct _mapGhost
+{
+  struct _mapIOData   io;
+  char               *source;
+  int                 serial;
+  struct _mapGhost   *next;
+} mapGhost;
+
+/* maps are hashed on type, vehicle, level and the file they came from,
+ * numbered in the order they were made, and kept in order of use - newest
+ * first
+ */
+typedef struct _mapRegistry
+{
+  struct _pathfindingmap *bucket[ REGISTRY_BUCKETS ];
+  struct _mapGhost       *ghost[ REGISTRY_BUCKETS ];
+  struct _pathfindingmap *newest;
+  struct _pathfindingmap *oldest;
+  struct _mapIOData       root;
+  char                   *source;
+  long long               bytes;
+  long long               peak;
+  int                     serial;
+  int                     evicted;
+  int                     rebuilt;
+} mapRegistry;
+
+/************************************  prototypes             ***********************/
+
+void            setMapSource    ( mapIOData *in );
+unsigned int    mapHash         ( int type, int vehicle, int level, char *source );
+void            registerMap     ( pathfindingmap *map );
+void            unregisterMap   ( pathfindingmap *map );
+pathfindingmap *lookupMap       ( mapIOData io );
+void            touchMap        ( pathfindingmap *map );
+long long       mapBytes        ( pathfindingmap *map );
+void            trimMaps        ( void );
+void            evictMap        ( pathfindingmap *map );
+void            ghostMap        ( mapIOData *io );
+pathfindingmap *rebuildMap      ( mapIOData *io );
+pathfindingmap *releaseMaps     ( char *source );
+void            swapRegistry    ( mapRegistry *other );
+void            freeRegistry    ( void );
+
+#endif /* __REGISTRY_H__ */
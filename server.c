@@ -0,0 +1,526 @@
+/* server.c - serving map tiles over http
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -H genPathmaps doesn't write any files. the maps made from the
+ * level 0 input - every compressed level, info and smallOnes - are kept in
+ * memory, and a small http server on this machine renders tiles of them
+ * as they are asked for:
+ *
+ *     GET /Tank/map/2/5/7.bmp         level 2 search map, column 5, row 7
+ *     GET /Tank/info/1/5/7.bmp        info map
+ *     GET /Tank/smallones/0/5/7.bmp   smallOnes points and links
+ *     GET /Tank/grid/0/5/7.bmp        numbered grid
+ *     GET /                           what is being served
+ *
+ * a tile is a TILE_DIM square 4 bit bitmap, drawn by the same code as the
+ * images, at the map's own resolution. the worker threads each render
+ * into their own copy of the map, one band wide, like writeBandsThreaded.
+ * tiles made are kept, newest first, up to TILE_CACHE_BYTES.
+ */
+
+/************************************  includes              ************************/
+
+#ifdef IS_UNIX
+  /* the sockets shutdown() would clash with ours */
+  #define shutdown socketShutdown
+  #include <errno.h>
+  #include <setjmp.h>
+  #include <signal.h>
+  #include <unistd.h>
+  #include <sys/socket.h>
+  #include <sys/time.h>
+  #include <netinet/in.h>
+  #include <arpa/inet.h>
+  #undef shutdown
+#endif
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "smallones.h"
+#include "registry.h"
+#include "image.h"
+#include "memory.h"
+#include "server.h"
+
+/************************************  global variables      ************************/
+
+extern THREAD_LOCAL userData data;
+extern char *baseName[];
+extern THREAD_LOCAL unsigned char colors[];
+
+#ifdef IS_UNIX
+
+static char *layerName[ TL_COUNT ] = { "map", "info", "smallones", "grid" };
+
+/* the map drawn for a layer and level, NULL if there isn't one */
+static pathfindingmap *served[ TL_COUNT ][ MAX_LEVEL + 1 ];
+
+static tileCache cache;
+static connQueue queue;
+
+/* bytes in a band of the level 0 map - the widest there is */
+static int bandBytes;
+
+/* the run and the 4 bit levels, for the workers to take over */
+static renderState workerState;
+
+/* where an error in a worker's request goes back to - see serverRecover */
+static THREAD_LOCAL jmp_buf serverTrap;
+static THREAD_LOCAL int     armed = FALSE;
+
+/************************************  prototypes             ***********************/
+
+static void  loadServedMaps ( jobList *job );
+static void *serveConnections ( void *arg );
+static void  serveRequest   ( int fd, pathfindingmap *band );
+static int   serveTile      ( int fd, pathfindingmap *band, char *path );
+static void  serveIndex     ( int fd );
+static void  sendResponse   ( int fd, char *status, char *type,
+			      unsigned char *body, size_t size );
+static servedTile *findTile ( int layer, int level, int col, int row );
+static void  storeTile      ( servedTile *tile );
+static unsigned char *renderTileBmp ( pathfindingmap *band, pathfindingmap *map,
+				      int layer, int col, int row, size_t *size );
+
+/************************************  functions             ************************/
+
+void
+serveMaps ( jobList *job, int port )
+{
+  struct sockaddr_in addr;
+  pthread_t thread;
+  pathfindingmap *band;
+  int listener;
+  int fd;
+  int on = 1;
+  int i;
+
+  loadServedMaps ( job );
+
+  memset ( &cache, 0, sizeof ( cache ));
+  memset ( &queue, 0, sizeof ( queue ));
+  pthread_mutex_init ( &(cache.lock), NULL );
+  pthread_mutex_init ( &(queue.lock), NULL );
+  pthread_cond_init  ( &(queue.cond), NULL );
+
+  /* a client hanging up mid reply is not worth dying over */
+  signal ( SIGPIPE, SIG_IGN );
+
+  if (( listener = socket ( AF_INET, SOCK_STREAM, 0 )) < 0 )
+    shutdown ( EF_FUNCTION_ERR, "Error creating server socket\n" );
+  setsockopt ( listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof ( on ));
+
+  memset ( &addr, 0, sizeof ( addr ));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons ( (unsigned short) port );
+  addr.sin_addr.s_addr = inet_addr ( SERVER_ADDRESS );
+
+  if ( bind ( listener, (struct sockaddr *) &addr, sizeof ( addr )) ||
+       listen ( listener, SERVER_QUEUE ))
+    shutdown ( EF_FUNCTION_ERR, "Error listening on %s port %d\n", SERVER_ADDRESS, port );
+
+  /* each worker draws into its own copy of the map */
+  saveRenderState ( &workerState );
+  for ( i = 0; i < data.threads; i++ ) {
+    if ( !( band = (pathfindingmap *) calloc ( sizeof ( pathfindingmap ), 1 )) ||
+	 !( band->buf = (unsigned char *) malloc ( bandBytes )))
+      shutdown ( EF_MALLOC, "Error creating tile buffer\n" );
+    if ( pthread_create ( &thread, NULL, serveConnections, band ))
+      shutdown ( EF_FUNCTION_ERR, "Error starting server thread\n" );
+    pthread_detach ( thread );
+  }
+
+  debug ( DBG_WARN, "Serving %s tiles on http://%s:%d/ with %d threads\n",
+	  baseName[ job->in.vehicle ], SERVER_ADDRESS, port, data.threads );
+  fflush ( stdout );
+
+  /* hand connections to the workers, waiting when they are all busy */
+  while ( TRUE ) {
+    if (( fd = accept ( listener, NULL, NULL )) < 0 ) {
+      if ( errno == EINTR ) continue;
+      shutdown ( EF_FUNCTION_ERR, "Error accepting connection\n" );
+    }
+    pthread_mutex_lock ( &(queue.lock) );
+    while ( queue.count == SERVER_QUEUE )
+      pthread_cond_wait ( &(queue.cond), &(queue.lock) );
+    queue.fd[ ( queue.head + queue.count++ ) % SERVER_QUEUE ] = fd;
+    pthread_cond_broadcast ( &(queue.cond) );
+    pthread_mutex_unlock ( &(queue.lock) );
+  }
+} /* end serveMaps */
+
+static void
+loadServedMaps ( jobList *job )
+{
+  pathfindingmap *set[ SET_MAPS ];
+  pathfindingmap *map;
+  mapIOData in;
+  int level;
+
+  in = job->in;
+  if ( !( in.type & FTF_MAP ) || in.level )
+    shutdown ( EF_NOT_SUPPORTED, "Tiles can only be served from a level 0 search map\n" );
+
+  getMapSet ( &in, set );
+  for ( level = 0; level <= MAX_LEVEL; level++ )
+    served[ TL_MAP ][ level ] = set[ level ];
+  served[ TL_INFO ][ set[ SET_INFO ]->io.level ] = set[ SET_INFO ];
+  map = served[ TL_SO ][ 0 ] = set[ SET_SO ];
+
+  /* tiles are 4 bit */
+  for ( level = 0; level < 16; level++ ) colors[ level ] = level;
+
+  /* links are gathered once, before the workers share them */
+  map->io.type |= FTF_LINES;
+  freeSegmentBins ( &(map->lines) );
+  buildSmallOnesLines ( map );
+
+  served[ TL_GRID ][ 0 ] = served[ TL_MAP ][ 0 ];
+  bandBytes = served[ TL_MAP ][ 0 ]->res * TILE_DIM * 4 / 8;
+} /* end loadServedMaps */
+
+static void *
+serveConnections ( void *arg )
+{
+  pathfindingmap *band = (pathfindingmap *) arg;
+  int fd;
+
+  loadRenderState ( &workerState );
+  while ( TRUE ) {
+    pthread_mutex_lock ( &(queue.lock) );
+    while ( !queue.count )
+      pthread_cond_wait ( &(queue.cond), &(queue.lock) );
+    fd = queue.fd[ queue.head ];
+    queue.head = ( queue.head + 1 ) % SERVER_QUEUE;
+    queue.count--;
+    pthread_cond_broadcast ( &(queue.cond) );
+    pthread_mutex_unlock ( &(queue.lock) );
+
+    /* an error ends the request, not the server */
+    if ( !setjmp ( serverTrap )) {
+      armed = TRUE;
+      serveRequest ( fd, band );
+    } else
+      sendResponse ( fd, "500 Internal Server Error", "text/plain",
+		     (unsigned char *) errorMessage (), strlen ( errorMessage ()));
+    armed = FALSE;
+    close ( fd );
+  }
+  return NULL;
+} /* end serveConnections */
+
+static void
+serveRequest ( int fd, pathfindingmap *band )
+{
+  char request[ SERVER_REQUEST + 1 ];
+  char method[ 8 ];
+  char path[ 256 ];
+  struct timeval timeout;
+  int len = 0;
+  int n;
+
+  timeout.tv_sec  = SERVER_TIMEOUT;
+  timeout.tv_usec = 0;
+  setsockopt ( fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof ( timeout ));
+
+  /* only the request line is wanted, but read up to the end of the
+   * headers so the client isn't reset */
+  do {
+    if (( n = recv ( fd, request + len, SERVER_REQUEST - len, 0 )) <= 0 ) break;
+    len += n;
+    request[ len ] = '\0';
+  } while (( len < SERVER_REQUEST ) && !strstr ( request, "\r\n\r\n" ));
+  request[ len ] = '\0';
+
+  if ( sscanf ( request, "%7s %255s HTTP/1.%*d", method, path ) != 2 ) {
+    sendResponse ( fd, "400 Bad Request", "text/plain", (unsigned char *) "Bad request\n", 12 );
+    return;
+  }
+  if ( strcmp ( method, "GET" )) {
+    sendResponse ( fd, "405 Method Not Allowed", "text/plain",
+		   (unsigned char *) "Only GET\n", 9 );
+    return;
+  }
+
+  if ( !strcmp ( path, "/" )) serveIndex ( fd );
+  else if ( !serveTile ( fd, band, path ))
+    sendResponse ( fd, "404 Not Found", "text/plain", (unsigned char *) "No such tile\n", 13 );
+} /* end serveRequest */
+
+static int
+serveTile ( int fd, pathfindingmap *band, char *path )
+{
+  pathfindingmap *map;
+  servedTile *tile;
+  unsigned char *bmp;
+  char vehicle[ 32 ];
+  char layerStr[ 32 ];
+  char ext[ 8 ];
+  size_t size;
+  int level, col, row;
+  int layer;
+
+  if ( sscanf ( path, "/%31[^/]/%31[^/]/%d/%d/%d.%7s",
+		vehicle, layerStr, &level, &col, &row, ext ) != 6 ) return FALSE;
+
+  for ( layer = 0; layer < TL_COUNT; layer++ )
+    if ( !strCaseCmp ( layerStr, layerName[ layer ], 32 )) break;
+
+  if (( layer == TL_COUNT ) || strCaseCmp ( ext, "bmp", 8 ) ||
+      strCaseCmp ( vehicle, baseName[ served[ TL_MAP ][ 0 ]->io.vehicle ], 32 ) ||
+      !INRANGE ( level, 0, MAX_LEVEL ) || !( map = served[ layer ][ level ]) ||
+      !INRANGE ( col, 0, map->tilesPerRow - 1 ) || !INRANGE ( row, 0, map->tilesPerCol - 1 ))
+    return FALSE;
+
+  /* copy it out of the cache while it is locked, it may be let go */
+  pthread_mutex_lock ( &(cache.lock) );
+  if (( tile = findTile ( layer, level, col, row ))) {
+    size = tile->size;
+    if (( bmp = (unsigned char *) malloc ( size )))
+      memcpy ( bmp, tile->bmp, size );
+    cache.hits++;
+  } else cache.misses++;
+  pthread_mutex_unlock ( &(cache.lock) );
+  if ( tile && !bmp )
+    shutdown ( EF_MALLOC, "Error copying tile\n" );
+
+  if ( !tile ) {
+    bmp = renderTileBmp ( band, map, layer, col, row, &size );
+
+    if ( !( tile = (servedTile *) calloc ( sizeof ( servedTile ), 1 )) ||
+	 !( tile->bmp = (unsigned char *) malloc ( size ))) {
+      /* the worker goes on, so nothing is left behind */
+      free ( tile );
+      free ( bmp );
+      shutdown ( EF_MALLOC, "Error caching tile\n" );
+    }
+    tile->layer = layer;
+    tile->level = level;
+    tile->col   = col;
+    tile->row   = row;
+    tile->size  = size;
+    memcpy ( tile->bmp, bmp, size );
+
+    pthread_mutex_lock ( &(cache.lock) );
+    storeTile ( tile );
+    pthread_mutex_unlock ( &(cache.lock) );
+  }
+
+  sendResponse ( fd, "200 OK", "image/bmp", bmp, size );
+  free ( bmp );
+  return TRUE;
+} /* end serveTile */
+
+static unsigned char *
+renderTileBmp ( pathfindingmap *band, pathfindingmap *map,
+		int layer, int col, int row, size_t *size )
+{
+  unsigned char *buf;
+  unsigned char *bmp = NULL;
+  FILE *fp;
+
+  /* draw on a copy of the map, keeping this worker's buffer */
+  buf   = band->buf;
+  *band = *map;
+  band->buf   = buf;
+  band->fill  = NULL;
+  band->rle   = NULL;
+  band->png   = NULL;
+  band->io.bits = 4;
+
+  switch ( layer )
+    {
+    case TL_MAP:
+      band->io.type = FTF_IMG | FTF_MAP | FTF_NATIVE;
+      break;
+    case TL_INFO:
+      band->io.type = FTF_IMG | FTF_INFO | FTF_NATIVE;
+      break;
+    case TL_SO:
+      band->io.type = FTF_IMG | FTF_SO | FTF_NATIVE;
+      break;
+    case TL_GRID:
+      band->io.type = FTF_IMG | FTF_GRID | FTF_NUMBERS | FTF_NATIVE;
+      break;
+    }
+  setSpanFill ( band );
+  renderTile ( band, col, row );
+
+  if ( !( fp = open_memstream ( (char **) &bmp, size )))
+    shutdown ( EF_MALLOC, "Error creating tile stream\n" );
+  writeBmpHeaderDim ( band, fp, TILE_DIM, TILE_DIM );
+  if ( !fwrite ( band->buf, TILE_DIM * TILE_DIM * band->io.bits / 8, 1, fp )) {
+    fclose ( fp );
+    free ( bmp );
+    shutdown ( EF_FILE_WRITE, "Error writing tile\n" );
+  }
+  fclose ( fp );
+
+  return bmp;
+} /* end renderTileBmp */
+
+static void
+serveIndex ( int fd )
+{
+  char text[ 2048 ];
+  pathfindingmap *map;
+  int len;
+  int layer, level;
+
+  map = served[ TL_MAP ][ 0 ];
+  len = sprintf ( text, "%s %dx%d tiles of %d pixels\n\n",
+		  baseName[ map->io.vehicle ], map->tilesPerRow, map->tilesPerCol, TILE_DIM );
+
+  for ( layer = 0; layer < TL_COUNT; layer++ )
+    for ( level = 0; level <= MAX_LEVEL; level++ )
+      if (( map = served[ layer ][ level ]))
+	len += sprintf ( text + len, "/%s/%s/%d/<col>/<row>.bmp  %dx%d\n",
+			 baseName[ map->io.vehicle ], layerName[ layer ], level,
+			 map->tilesPerRow, map->tilesPerCol );
+
+  pthread_mutex_lock ( &(cache.lock) );
+  len += sprintf ( text + len, "\n%lld bytes of tiles cached, %d hits, %d misses\n",
+		   cache.bytes, cache.hits, cache.misses );
+  pthread_mutex_unlock ( &(cache.lock) );
+
+  sendResponse ( fd, "200 OK", "text/plain", (unsigned char *) text, len );
+} /* end serveIndex */
+
+static void
+sendResponse ( int fd, char *status, char *type, unsigned char *body, size_t size )
+{
+  char header[ 256 ];
+  ssize_t n;
+  int len;
+
+  len = sprintf ( header,
+		  "HTTP/1.1 %s\r\n"
+		  "Content-Type: %s\r\n"
+		  "Content-Length: %lu\r\n"
+		  "Connection: close\r\n\r\n",
+		  status, type, (unsigned long) size );
+
+  if ( send ( fd, header, len, 0 ) != len ) return;
+  while ( size > 0 ) {
+    if (( n = send ( fd, body, size, 0 )) <= 0 ) return;
+    body += n;
+    size -= n;
+  }
+} /* end sendResponse */
+
+void
+serverRecover ( int err )
+{
+  /* only a worker thread in a request has somewhere to go back to */
+  if ( !armed || !err ) return;
+  armed = FALSE;
+  longjmp ( serverTrap, err );
+} /* end serverRecover */
+
+/************************************  tile cache            ************************/
+
+static unsigned int
+tileHash ( int layer, int level, int col, int row )
+{
+  return (( layer * 8 + level ) * 131 + col ) * 131 + row;
+} /* end tileHash */
+
+static servedTile *
+findTile ( int layer, int level, int col, int row )
+{
+  servedTile *tile;
+  unsigned int hash;
+
+  hash = tileHash ( layer, level, col, row );
+  for ( tile = cache.bucket[ hash & ( TILE_CACHE_BUCKETS - 1 ) ]; tile; tile = tile->hashNext )
+    if (( tile->hash == hash ) && ( tile->layer == layer ) && ( tile->level == level ) &&
+	( tile->col == col ) && ( tile->row == row ))
+      break;
+  if ( !tile || ( cache.newest == tile )) return tile;
+
+  /* move it to the front */
+  tile->lruPrev->lruNext = tile->lruNext;
+  if ( tile->lruNext ) tile->lruNext->lruPrev = tile->lruPrev;
+  else cache.oldest = tile->lruPrev;
+  tile->lruPrev = NULL;
+  tile->lruNext = cache.newest;
+  cache.newest->lruPrev = tile;
+  cache.newest = tile;
+  return tile;
+} /* end findTile */
+
+static void
+storeTile ( servedTile *tile )
+{
+  servedTile **link;
+  servedTile *old;
+
+  /* two workers can render the same tile, the first one in stays */
+  if ( findTile ( tile->layer, tile->level, tile->col, tile->row )) {
+    free ( tile->bmp );
+    free ( tile );
+    return;
+  }
+
+  tile->hash     = tileHash ( tile->layer, tile->level, tile->col, tile->row );
+  tile->hashNext = cache.bucket[ tile->hash & ( TILE_CACHE_BUCKETS - 1 ) ];
+  cache.bucket[ tile->hash & ( TILE_CACHE_BUCKETS - 1 ) ] = tile;
+
+  tile->lruNext = cache.newest;
+  if ( cache.newest ) cache.newest->lruPrev = tile;
+  else cache.oldest = tile;
+  cache.newest = tile;
+  cache.bytes += tile->size;
+
+  /* let go of the oldest tiles over the budget */
+  while (( cache.bytes > TILE_CACHE_BYTES ) && ( cache.oldest != cache.newest )) {
+    old = cache.oldest;
+    cache.oldest = old->lruPrev;
+    cache.oldest->lruNext = NULL;
+
+    for ( link = &(cache.bucket[ old->hash & ( TILE_CACHE_BUCKETS - 1 ) ]);
+	  *link != old; link = &((*link)->hashNext));
+    *link = old->hashNext;
+
+    cache.bytes -= old->size;
+    free ( old->bmp );
+    free ( old );
+  }
+} /* end storeTile */
+
+#else /* IS_UNIX */
+
+void
+serveMaps ( jobList *job, int port )
+{
+  shutdown ( EF_NOT_SUPPORTED, "Serving tiles needs a unix build\n" );
+} /* end serveMaps */
+
+void
+serverRecover ( int err )
+{
+} /* end serverRecover */
+
+#endif /* IS_UNIX */
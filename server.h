@@ -0,0 +1,111 @@
+/* server.h - serving map tiles over http
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+
+/************************************  includes              ************************/
+
+#ifdef IS_UNIX
+  #include <pthread.h>
+#endif
+
+/************************************  macros                 ***********************/
+
+/* the server only listens on this machine */
+#define SERVER_ADDRESS "127.0.0.1"
+
+/* connections waiting for a worker thread */
+#define SERVER_QUEUE 64
+
+/* longest request line and headers read from a connection */
+#define SERVER_REQUEST 4096
+
+/* seconds a connection gets to send its request */
+#define SERVER_TIMEOUT 5
+
+/* hash buckets for rendered tiles, a power of 2 */
+#define TILE_CACHE_BUCKETS 1024
+
+/* rendered tiles kept in memory */
+#define TILE_CACHE_BYTES ( 64LL * 1024LL * 1024LL )
+
+/************************************  structures and enums  ************************/
+
+typedef enum _tileLayer
+  {
+    TL_MAP = 0,
+    TL_INFO,
+    TL_SO,
+    TL_GRID,
+    TL_COUNT
+  } tileLayer;
+
+/* a tile rendered as a bitmap file, hashed on layer, level, column and
+ * row and kept in order of use - newest first
+ */
+typedef struct _servedTile
+{
+  unsigned int         hash;
+  int                  layer;
+  int                  level;
+  int                  col;
+  int                  row;
+  unsigned char       *bmp;
+  size_t               size;
+  struct _servedTile  *hashNext;
+  struct _servedTile  *lruPrev;
+  struct _servedTile  *lruNext;
+} servedTile;
+
+#ifdef IS_UNIX
+typedef struct _tileCache
+{
+  pthread_mutex_t      lock;
+  struct _servedTile  *bucket[ TILE_CACHE_BUCKETS ];
+  struct _servedTile  *newest;
+  struct _servedTile  *oldest;
+  long long            bytes;
+  int                  hits;
+  int                  misses;
+} tileCache;
+
+/* accepted connections handed from the listening thread to the workers */
+typedef struct _connQueue
+{
+  pthread_mutex_t      lock;
+  pthread_cond_t       cond;
+  int                  fd[ SERVER_QUEUE ];
+  int                  head;
+  int                  count;
+} connQueue;
+#endif
+
+/************************************  prototypes             ***********************/
+
+void            serveMaps       ( jobList *job, int port );
+void            serverRecover   ( int err );
+
+#endif /* __SERVER_H__ */
@@ -0,0 +1,309 @@
+/* sharedmaps.c - maps published in shared memory
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* publishMaps lays the maps made from a level 0 input out in one POSIX
+ * shared memory region, as sharedmaps.h describes. the offsets are worked
+ * out first, then the region is made that size and filled. the attach
+ * functions are for the programs reading it, and are in the library.
+ */
+
+/************************************  includes              ************************/
+
+#ifdef IS_UNIX
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+#include <time.h>
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "sharedmaps.h"
+
+/************************************  macros                 ***********************/
+
+#define SHARED_ALIGNED(n) ((( n ) + GPL_SHARED_ALIGN - 1 ) & ~((uint64_t) GPL_SHARED_ALIGN - 1 ))
+
+/************************************  global variables      ************************/
+
+extern THREAD_LOCAL userData data;
+extern char *baseName[];
+
+/* the layout is the game's, and the slots are getMapSet's */
+_Static_assert ( sizeof ( gplSharedSmallOnes ) == sizeof ( smallOnesData ),
+		 "gplSharedSmallOnes is not the game's smallOnes layout" );
+_Static_assert ( GPL_MAP == (int) FTF_MAP && GPL_INFO == (int) FTF_INFO &&
+		 GPL_SO == (int) FTF_SO,
+		 "GPL_MAP, GPL_INFO and GPL_SO are not the file types" );
+_Static_assert ( GPL_SHARED_INFO == SET_INFO && GPL_SHARED_SO == SET_SO &&
+		 GPL_SHARED_MAPS == SET_MAPS,
+		 "the shared slots are not getMapSet's" );
+
+#ifdef IS_UNIX
+
+/************************************  prototypes             ***********************/
+
+static uint64_t  layoutMaps  ( pathfindingmap **set, gplSharedHeader *head );
+static void      fillMap     ( unsigned char *base, pathfindingmap *map, gplSharedMap *desc );
+
+/************************************  functions             ************************/
+
+void
+publishMaps ( mapIOData *in )
+{
+  pathfindingmap *set[ SET_MAPS ];
+  gplSharedHeader head;
+  unsigned char *base;
+  char name[ BUF_SIZE ];
+  int fd;
+  int i;
+
+  if ( !( in->type & FTF_MAP ) || in->level ) {
+    debug ( DBG_WARN, "Only maps made from a level 0 search map are shared, not %s\n",
+	    in->path );
+    return;
+  }
+
+  getMapSet ( in, set );
+
+  memset ( &head, 0, sizeof ( gplSharedHeader ));
+  head.version    = GPL_SHARED_VERSION;
+  head.headerSize = sizeof ( gplSharedHeader );
+  head.vehicle    = in->vehicle;
+  head.published  = (uint64_t) time ( NULL );
+  strncpy ( head.vehicleName, baseName[ in->vehicle ], sizeof ( head.vehicleName ) - 1 );
+  head.size       = layoutMaps ( set, &head );
+
+  /* readers that have the old region keep it, new ones get this */
+  snprintf ( name, BUF_SIZE, "/%s.%s", data.shmName, baseName[ in->vehicle ] );
+  shm_unlink ( name );
+  if (( fd = shm_open ( name, O_RDWR | O_CREAT | O_EXCL, 0644 )) < 0 )
+    shutdown ( EF_FILE_OPEN, "Error making shared memory %s: %s\n", name, strerror ( errno ));
+  if ( ftruncate ( fd, head.size ) < 0 ) {
+    close ( fd );
+    shutdown ( EF_FILE_SIZE, "Error sizing shared memory %s: %s\n", name, strerror ( errno ));
+  }
+  base = mmap ( NULL, head.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close ( fd );
+  if ( base == MAP_FAILED )
+    shutdown ( EF_MALLOC, "Error mapping shared memory %s: %s\n", name, strerror ( errno ));
+
+  /* the region starts out zeroed, so magic is 0 until it is all there */
+  memcpy ( base, &head, sizeof ( gplSharedHeader ));
+  for ( i = 0; i < SET_MAPS; i++ )
+    if ( set[i] ) fillMap ( base, set[i], &(head.map[i]) );
+  __sync_synchronize ();
+  ((gplSharedHeader *) base)->magic = GPL_SHARED_MAGIC;
+
+  munmap ( base, head.size );
+
+  debug ( DBG_NOTICE, "Shared %s maps in %s, %llu bytes\n",
+	  baseName[ in->vehicle ], name, (unsigned long long) head.size );
+} /* end publishMaps */
+
+/* offsets of every section, returns the size of the region */
+static uint64_t
+layoutMaps ( pathfindingmap **set, gplSharedHeader *head )
+{
+  pathfindingmap *map;
+  gplSharedMap *desc;
+  uint64_t off;
+  int i;
+  int j;
+
+  off = SHARED_ALIGNED ( sizeof ( gplSharedHeader ));
+
+  for ( i = 0; i < SET_MAPS; i++ ) {
+    if ( !( map = set[i] )) continue;
+
+    desc = &(head->map[i]);
+    desc->type         = map->io.type & ( FTF_MAP | FTF_INFO | FTF_SO );
+    desc->level        = map->io.level;
+    desc->tilesPerRow  = map->tilesPerRow;
+    desc->tilesPerCol  = map->tilesPerCol;
+    desc->rowsPerTile  = map->rowsPerTile;
+    desc->bytesPerRow  = map->bytesPerRow;
+    desc->bytesPerTile = map->bytesPerTile;
+    desc->res          = map->res;
+
+    if ( desc->type == FTF_SO ) {
+      desc->soOffset = off;
+      off = SHARED_ALIGNED ( off + sizeof ( gplSharedSmallOnes ) * map->tiles );
+      continue;
+    }
+
+    for ( j = 0; j < map->tiles; j++ )
+      if ( map->tile[j].flag == TDT_MIXED ) desc->mixedTiles++;
+
+    desc->tileOffset = off;
+    off = SHARED_ALIGNED ( off + sizeof ( gplSharedTile ) * map->tiles );
+    desc->bitsOffset = off;
+    off = SHARED_ALIGNED ( off + (uint64_t) desc->bytesPerTile * desc->mixedTiles );
+  }
+
+  return off;
+} /* end layoutMaps */
+
+static void
+fillMap ( unsigned char *base, pathfindingmap *map, gplSharedMap *desc )
+{
+  gplSharedTile *tile;
+  unsigned char *bits;
+  uint32_t mixed = 0;
+  int i;
+
+  if ( desc->type == FTF_SO ) {
+    memcpy ( base + desc->soOffset, map->so, sizeof ( gplSharedSmallOnes ) * map->tiles );
+    return;
+  }
+
+  tile = (gplSharedTile *) ( base + desc->tileOffset );
+  bits = base + desc->bitsOffset;
+  for ( i = 0; i < map->tiles; i++ ) {
+    tile[i].flag = map->tile[i].flag;
+    if ( map->tile[i].flag != TDT_MIXED ) {
+      tile[i].bits = GPL_SHARED_NO_BITS;
+      continue;
+    }
+    tile[i].bits = mixed;
+    memcpy ( bits + (uint64_t) desc->bytesPerTile * mixed++, map->tile[i].bits,
+	     desc->bytesPerTile );
+  }
+} /* end fillMap */
+
+/************************************  attaching             ************************/
+
+const gplSharedHeader *
+gplAttach ( const char *name )
+{
+  gplSharedHeader *region;
+  struct stat st;
+  uint32_t magic;
+  int fd;
+
+  if (( fd = shm_open ( name, O_RDONLY, 0 )) < 0 ) return NULL;
+  if ( fstat ( fd, &st ) < 0 || st.st_size < (off_t) sizeof ( gplSharedHeader )) {
+    close ( fd );
+    errno = EINVAL;
+    return NULL;
+  }
+
+  region = mmap ( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+  close ( fd );
+  if ( region == MAP_FAILED ) return NULL;
+
+  /* not filled yet, or not one of ours */
+  magic = region->magic;
+  if ( magic != GPL_SHARED_MAGIC || region->version != GPL_SHARED_VERSION ||
+       region->size != (uint64_t) st.st_size ) {
+    munmap ( region, st.st_size );
+    errno = ( magic == GPL_SHARED_MAGIC ) ? ENOTSUP : EAGAIN;
+    return NULL;
+  }
+  __sync_synchronize ();
+
+  return region;
+} /* end gplAttach */
+
+void
+gplDetach ( const gplSharedHeader *region )
+{
+  if ( region ) munmap ( (void *) region, region->size );
+} /* end gplDetach */
+
+#endif /* IS_UNIX */
+
+const gplSharedMap *
+gplSharedFind ( const gplSharedHeader *region, int what, int level )
+{
+  int slot;
+
+  if ( !region ) return NULL;
+  switch ( what )
+    {
+    case GPL_MAP:
+      if ( !INRANGE ( level, 0, MAX_LEVEL )) return NULL;
+      slot = level;
+      break;
+    case GPL_INFO:
+      slot = GPL_SHARED_INFO;
+      break;
+    case GPL_SO:
+      slot = GPL_SHARED_SO;
+      break;
+    default:
+      return NULL;
+    }
+
+  return region->map[ slot ].type ? &(region->map[ slot ]) : NULL;
+} /* end gplSharedFind */
+
+const unsigned char *
+gplSharedBits ( const gplSharedHeader *region, const gplSharedMap *map, int tile )
+{
+  const gplSharedTile *t;
+
+  if ( !region || !map || !map->tileOffset ) return NULL;
+  if ( !INRANGE ( tile, 0, (int) ( map->tilesPerRow * map->tilesPerCol ) - 1 )) return NULL;
+
+  t = (const gplSharedTile *) ((const unsigned char *) region + map->tileOffset ) + tile;
+  if ( t->bits == GPL_SHARED_NO_BITS ) return NULL;
+
+  return (const unsigned char *) region + map->bitsOffset +
+    (uint64_t) map->bytesPerTile * t->bits;
+} /* end gplSharedBits */
+
+const gplSharedSmallOnes *
+gplSharedSO ( const gplSharedHeader *region )
+{
+  const gplSharedMap *map;
+
+  if ( !( map = gplSharedFind ( region, GPL_SO, 0 ))) return NULL;
+  return (const gplSharedSmallOnes *) ((const unsigned char *) region + map->soOffset );
+} /* end gplSharedSO */
+
+#ifndef IS_UNIX
+
+void
+publishMaps ( mapIOData *in )
+{
+  shutdown ( EF_NOT_SUPPORTED, "Shared memory needs a unix build\n" );
+} /* end publishMaps */
+
+const gplSharedHeader *
+gplAttach ( const char *name )
+{
+  return NULL;
+} /* end gplAttach */
+
+void
+gplDetach ( const gplSharedHeader *region )
+{
+} /* end gplDetach */
+
+#endif /* IS_UNIX */
@@ -0,0 +1,147 @@
+/* sharedmaps.h - the layout of maps shared in memory
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -E name, the maps of each vehicle built are also published in a
+ * POSIX shared memory region called /name.Vehicle - e.g. -E sim makes
+ * /sim.Tank. a program on the same machine maps it read only and uses
+ * the tiles where they are, without reading or parsing any files.
+ *
+ * the region has no pointers, only offsets from its start, so it can be
+ * mapped anywhere. everything is in the byte order of the machine that
+ * wrote it, and every section starts on a GPL_SHARED_ALIGN boundary:
+ *
+ *     gplSharedHeader                    with a gplSharedMap for levels
+ *                                        0 to 5, info and smallOnes
+ *     for each map in use:
+ *       gplSharedTile  [ tiles ]         flag, and where its bits are
+ *       tile bits      [ mixed tiles ]   bytesPerTile each
+ *       gplSharedSmallOnes [ tiles ]     the smallOnes map only
+ *
+ * search map bits are 1 a pixel, 1 for NoGo, the first pixel in the low
+ * bit. info bits are 2 a pixel. tiles are row major, as are the rows in
+ * a tile.
+ *
+ * a region is made again when its vehicle is built again. readers that
+ * have it mapped keep the old one. magic is written last, so a region
+ * that is still being filled will not attach.
+ */
+
+#ifndef __SHAREDMAPS_H__
+#define __SHAREDMAPS_H__
+
+#include <stdint.h>
+#include "libgenpathmaps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/************************************  macros                 ***********************/
+
+#define GPL_SHARED_MAGIC    0x50414d47   /* "GMAP" */
+#define GPL_SHARED_VERSION  1
+#define GPL_SHARED_ALIGN    64
+
+/* the slots in gplSharedHeader.map */
+#define GPL_SHARED_INFO     6
+#define GPL_SHARED_SO       7
+#define GPL_SHARED_MAPS     8
+
+/* gplSharedTile.bits of a tile that is all DoGo or all NoGo */
+#define GPL_SHARED_NO_BITS  0xffffffffu
+
+/************************************  structures and enums  ************************/
+
+typedef struct _gplSharedTile
+{
+  int32_t   flag;           /* -1 mixed, 0 DoGo, 1 NoGo */
+  uint32_t  bits;           /* index of the tile's bits, or GPL_SHARED_NO_BITS */
+} gplSharedTile;
+
+/* a tile's record in the game's smallOnes file */
+typedef struct _gplSharedSmallOnes
+{
+  uint16_t  hasLower;       /* point i links to point j below: bit i * 4 + j */
+  uint16_t  hasRight;       /* and to the right */
+  uint8_t   pt[4][2];       /* x, y in the tile */
+  uint8_t   active;         /* bit i + 4 set if point i is there */
+  uint8_t   na1;
+  uint8_t   na2;
+  uint8_t   na3;
+} gplSharedSmallOnes;
+
+typedef struct _gplSharedMap
+{
+  uint32_t  type;           /* GPL_MAP, GPL_INFO, GPL_SO - 0 for an empty slot */
+  uint32_t  level;
+  uint32_t  tilesPerRow;
+  uint32_t  tilesPerCol;
+  uint32_t  rowsPerTile;
+  uint32_t  bytesPerRow;
+  uint32_t  bytesPerTile;
+  uint32_t  res;            /* pixels across the level 0 map it was made from */
+  uint64_t  tileOffset;     /* gplSharedTile [ tiles ], 0 for smallOnes */
+  uint64_t  bitsOffset;     /* bits of the mixed tiles */
+  uint64_t  soOffset;       /* gplSharedSmallOnes [ tiles ], smallOnes only */
+  uint32_t  mixedTiles;
+  uint32_t  reserved;
+} gplSharedMap;
+
+typedef struct _gplSharedHeader
+{
+  uint32_t      magic;
+  uint32_t      version;
+  uint32_t      headerSize; /* sizeof ( gplSharedHeader ) */
+  uint32_t      vehicle;    /* 0 Tank, 1 Infantry, 2 Boat ... as in the file names */
+  char          vehicleName[16];
+  uint64_t      size;       /* of the whole region */
+  uint64_t      published;  /* unix time */
+  gplSharedMap  map[ GPL_SHARED_MAPS ];
+} gplSharedHeader;
+
+/************************************  prototypes             ***********************/
+
+/* map a region read only - NULL if it isn't there, is being made, or is
+ * a version this library doesn't know */
+GPL_API const gplSharedHeader *gplAttach      ( const char *name );
+GPL_API void                   gplDetach      ( const gplSharedHeader *region );
+
+/* a level of GPL_MAP, or GPL_INFO or GPL_SO - NULL if there isn't one */
+GPL_API const gplSharedMap    *gplSharedFind  ( const gplSharedHeader *region,
+						int what, int level );
+/* the bits of a mixed tile, NULL for the others */
+GPL_API const unsigned char   *gplSharedBits  ( const gplSharedHeader *region,
+						const gplSharedMap *map, int tile );
+GPL_API const gplSharedSmallOnes *gplSharedSO ( const gplSharedHeader *region );
+
+/* the program's side, for -E */
+#ifdef __GENPATHMAPS_H__
+void publishMaps ( mapIOData *in );
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHAREDMAPS_H__ */
@@ -29,6 +29,8 @@
 #include "pathfindingmap.h"
 #include "smallones.h"
 #include "textfile.h"
+#include "update.h"
+#include "islands.h"
 
 /************************************  global variables      ************************/
 
@@ -54,8 +56,6 @@ genSmallOnes ( pathfindingmap *map )
   pathfindingmap *soMap;
   pathfindingmap *srcMap;
   mapIOData       io;
-  tileData       *tile;
-  tileImageData  *img;
 
   int tileRow, tileCol;
   int curTile;
@@ -88,6 +88,15 @@ genSmallOnes ( pathfindingmap *map )
   soMap->bytesPerTile = srcMap->bytesPerTile;
   soMap->res          = srcMap->res;
 
+  /* already made - or updated - for another job */
+  if ( soMap->so ) return soMap;
+
+  /* only the changed tiles are needed when updating */
+  if ( updateSmallOnes ( soMap, srcMap )) {
+    findIslands ( soMap );
+    return soMap;
+  }
+
     /* allocate smallOnes buffer */
   if (!( soMap->so =
 	 (smallOnesData *) calloc ( sizeof(smallOnesData) * soMap->tiles, 1 )))
@@ -102,36 +111,45 @@ genSmallOnes ( pathfindingmap *map )
   /* adjust tiles for each map */
   soMap->tile = copyTiles( srcMap );
 
-  /* simplify things */
-  tile = soMap->tile;
-  img  = soMap->img;
-
   for ( tileRow = 0; tileRow < soMap->tilesPerRow; tileRow++ ) {
     for ( tileCol = 0; tileCol < soMap->tilesPerCol; tileCol++ ) {
       /* get offset into tile and so arrays */
       curTile = tileRow * soMap->tilesPerCol + tileCol;
+      tileSmallOnes ( soMap, curTile );
+    } /* end tileCol */
+  } /* end tileRow loop */
+
+  findIslands ( soMap );
+  return soMap;
+} /* end genSmallOnes */
+
+void
+tileSmallOnes ( pathfindingmap *soMap, int curTile )
+{
+  tileData      *tile;
+  tileImageData *img;
 
-      if ( tile[ curTile ].flag == TDT_NOGO ) {
-	/* smallOne is already zero'ed */
-	continue;
-      } else if ( tile[ curTile ].flag == TDT_DOGO ) {
+  /* simplify things */
+  tile = soMap->tile;
+  img  = soMap->img;
 
-	/* allocate tile image (all zero's) */
-	if (!( img[ curTile ].pt[0] = (unsigned char *) calloc ( TILE_BYTES, 1 )))
-	  shutdown ( EF_MALLOC, "Memory allocation error creating tile image\n" );
+  if ( tile[ curTile ].flag == TDT_NOGO ) {
+    /* smallOne is already zero'ed */
+    return;
+  } else if ( tile[ curTile ].flag == TDT_DOGO ) {
 
-	setPoint ( soMap, curTile, 0, DEF_OFF, DEF_OFF );
+    /* allocate tile image (all zero's) */
+    if (!( img[ curTile ].pt[0] = (unsigned char *) calloc ( TILE_BYTES, 1 )))
+      shutdown ( EF_MALLOC, "Memory allocation error creating tile image\n" );
 
-      } else if ( tile[ curTile ].flag == TDT_MIXED ) {
-	/* this tile has both NoGo's and DoGo's - find contiguos areas */
-	findAreas ( soMap, curTile );
+    setPoint ( soMap, curTile, 0, DEF_OFF, DEF_OFF );
 
-      } /*end MIXED */
-    } /* end tileCol */
-  } /* end tileRow loop */
+  } else if ( tile[ curTile ].flag == TDT_MIXED ) {
+    /* this tile has both NoGo's and DoGo's - find contiguos areas */
+    findAreas ( soMap, curTile );
 
-  return soMap;
-} /* end genSmallOnes */
+  } /*end MIXED */
+} /* end tileSmallOnes */
 
 void
 findAreas ( pathfindingmap *map, int offset )
@@ -199,6 +217,7 @@ addSegment (tileArea **area, int dimX, int dimY, int row, int begin, int end, in
 {
   tileArea *curArea  = NULL;
   tileArea *merged   = NULL;
+  tileArea *nextArea = NULL;
   lineList *curLines = NULL;
 
   if ( ! area )
@@ -214,6 +233,8 @@ addSegment (tileArea **area, int dimX, int dimY, int row, int begin, int end, in
     appendLine ( curArea, row, begin, end );
   else {
     do {
+      /* merging frees curArea - remember where to go next */
+      nextArea = curArea->next;
       if ( !curArea->lines ) {
 	/* add line and save area as merged */
 	merged = appendLine ( curArea, row, begin, end );
@@ -244,7 +265,7 @@ addSegment (tileArea **area, int dimX, int dimY, int row, int begin, int end, in
       }
 
       /* check every area */
-      if ( curArea->next ) curArea = curArea->next;
+      if ( nextArea ) curArea = nextArea;
 	  else break;
     } while ( curArea );
 
@@ -486,8 +507,8 @@ addSmallOnes ( pathfindingmap *map, tileArea *area, int offset )
 	      break;
 	    }
 	  }
-	  /* look down */
-	  if (( row + i ) >= 0 ) {
+	  /* look up */
+	  if (( row - i ) >= 0 ) {
 	    byteOff = ( row - i ) * bytesPerRow + col/8;
 	    bitOff  = col%8;
 	    if ( !(img->pt[level][byteOff] & ( 1 << bitOff ))) {
@@ -551,7 +572,8 @@ setPoint ( pathfindingmap *map, int offset, int level, int col, int row )
     if ( so[prevTile].active ) {
 
       /* yes, check each smallOnes point */
-      for ( i = 0; i < 4; i++ ) if ( so[prevTile].active & ( ACT_OFF << i )) {
+      for ( i = 0; i < 4; i++ ) if (( so[prevTile].active & ( ACT_OFF << i )) &&
+				    map->img[ prevTile ].pt[i] ) {
 
 	hasEdge = FALSE;
 	for ( rowByte = 0; ( rowByte < map->bytesPerRow ) && !hasEdge; rowByte++ ) {
@@ -584,7 +606,8 @@ setPoint ( pathfindingmap *map, int offset, int level, int col, int row )
     if ( so[prevTile].active ) {
 
       /* yes, check each smallOnes point */
-      for ( i = 0; i < 4; i++ ) if ( so[prevTile].active & ( ACT_OFF << i )) {
+      for ( i = 0; i < 4; i++ ) if (( so[prevTile].active & ( ACT_OFF << i )) &&
+				    map->img[ prevTile ].pt[i] ) {
 
 	/* assume the worse */
 	hasEdge = FALSE;
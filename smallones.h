@@ -83,6 +83,7 @@ typedef enum _edgeDirection
 /************************************  prototypes             **************************/
 
 pathfindingmap  *genSmallOnes       ( pathfindingmap *map );
+void             tileSmallOnes      ( pathfindingmap *soMap, int curTile );
 void             findAreas          ( pathfindingmap *map, int offset );
 void             addSegment         ( tileArea **area, int dimX, int dimY, 
 				      int row, int begin, int end, int contigious );
@@ -0,0 +1,258 @@
+/* stats.c - how much work each map makes for the pathfinder
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -a json or -a csv, every level of every vehicle's map and the
+ * smallOnes in the input directory are read and summed up, without
+ * drawing anything: the uniform and mixed tiles from the tile flags, the
+ * DoGo pixels with a popcount over the mixed tiles, and the points and
+ * links from the smallOnes active, hasLower and hasRight bits.
+ *
+ * the numbers go to Stats.json or Stats.csv, one record for each level
+ * and one for each smallOnes file found.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "memory.h"
+#include "textfile.h"
+#include "stats.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern THREAD_LOCAL userData data;
+
+/************************************  prototypes             ***********************/
+
+static void    statsLevel     ( pathfindingmap *map, mapStats *stats );
+static void    statsPoints    ( pathfindingmap *soMap, smallOnesStats *stats );
+static void    jsonVehicle    ( FILE *fp, vehicleType vehicle, mapStats *level, int *found,
+			        smallOnesStats *so, int first );
+static void    jsonString     ( FILE *fp, char *s );
+static void    csvVehicle     ( FILE *fp, vehicleType vehicle, mapStats *level, int *found,
+			        smallOnesStats *so );
+static double  ratio          ( double part, double whole );
+
+/************************************  functions             ************************/
+
+void
+writeStats ( void )
+{
+  char buffer[ BUF_SIZE ];
+  char path[ BUF_SIZE ];
+  pathfindingmap *map;
+  mapStats level[ MAX_LEVEL + 1 ];
+  int found[ MAX_LEVEL + 2 ];
+  smallOnesStats so;
+  vehicleType vehicle;
+  FILE *fp;
+  int files = 0;
+  int count;
+  int first = TRUE;
+  int i;
+
+  if ( !data.inpath || !data.outpath )
+    shutdown ( EF_DATA_MISSING, "Insufficient arguments\n" );
+  if ( !isDir ( data.inpath ) || !isDir ( data.outpath ))
+    shutdown ( EF_DATA_MISSING, "%ca sums up the pathmap files in a directory\n", COMSEP );
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_STATS, data.outpath, PATHSEP,
+	     ( data.stats == STATS_JSON ) ? FILE_JSON_EXT : FILE_CSV_EXT );
+  if ( !( fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+
+  if ( data.stats == STATS_JSON ) {
+    fprintf ( fp, "{%s  \"path\": ", LINEFEED );
+    jsonString ( fp, data.inpath );
+    fprintf ( fp, ",%s  \"vehicles\": [", LINEFEED );
+  } else {
+    fprintf ( fp, "vehicle,file,level,tiles,dogo,nogo,mixed,mixedDensity,walkable,"
+	      "nodes,links,areasPerTile,maxAreas%s", LINEFEED );
+  }
+
+  for ( vehicle = VT_TANK; vehicle <= VT_AMPHIBIUS; vehicle++ ) {
+    /* found[ MAX_LEVEL + 1 ] is the smallOnes */
+    memset ( found, 0, sizeof ( found ));
+    for ( i = 0; i <= MAX_LEVEL; i++ ) {
+      snprintf ( path, BUF_SIZE, FILENAME_MAP_RAW,
+		 data.inpath, PATHSEP, baseName[ vehicle ], vehicle, i );
+      if ( !( map = readMapFile ( path, FTF_MAP, vehicle, i ))) continue;
+      statsLevel ( map, &(level[i]) );
+      found[i] = TRUE;
+      freeMap ( &map );
+    }
+    snprintf ( path, BUF_SIZE, FILENAME_SO_RAW, data.inpath, PATHSEP, baseName[ vehicle ] );
+    if (( map = readMapFile ( path, FTF_SO, vehicle, 0 ))) {
+      statsPoints ( map, &so );
+      found[ MAX_LEVEL + 1 ] = TRUE;
+      freeMap ( &map );
+    }
+
+    count = 0;
+    for ( i = 0; i <= MAX_LEVEL + 1; i++ )
+      count += found[i];
+    if ( !count ) continue;
+    files += count;
+
+    if ( data.stats == STATS_JSON ) jsonVehicle ( fp, vehicle, level, found, &so, first );
+    else csvVehicle ( fp, vehicle, level, found, &so );
+    first = FALSE;
+  }
+
+  if ( data.stats == STATS_JSON )
+    fprintf ( fp, "%s  ]%s}%s", first ? "" : LINEFEED, LINEFEED, LINEFEED );
+  if ( fclose ( fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing %s\n", buffer );
+
+  debug ( DBG_NOTICE, "%d files summed up, see %s\n", files, buffer );
+
+  /* nothing else is done */
+  shutdown ( EF_NONE, "" );
+} /* end writeStats */
+
+static void
+statsLevel ( pathfindingmap *map, mapStats *stats )
+{
+  unsigned long long word;
+  tileData *tile;
+  int nogo;
+  int t, i;
+
+  memset ( stats, 0, sizeof ( mapStats ));
+  stats->tiles  = map->tiles;
+  stats->pixels = (long long) map->tiles * map->bytesPerTile * 8;
+
+  for ( t = 0; t < map->tiles; t++ ) {
+    tile = &(map->tile[t]);
+    if ( tile->flag == TDT_DOGO ) {
+      stats->doGo++;
+      stats->walkable += map->bytesPerTile * 8;
+      continue;
+    }
+    if ( tile->flag == TDT_NOGO ) {
+      stats->noGo++;
+      continue;
+    }
+
+    /* the NoGo bits of a mixed tile, a word at a time */
+    stats->mixed++;
+    nogo = 0;
+    for ( i = 0; i < map->bytesPerTile; i += 8 ) {
+      word = 0;
+      memcpy ( &word, tile->bits + i, MIN ( 8, map->bytesPerTile - i ));
+      nogo += __builtin_popcountll ( word );
+    }
+    stats->walkable += map->bytesPerTile * 8 - nogo;
+  }
+} /* end statsLevel */
+
+static void
+statsPoints ( pathfindingmap *soMap, smallOnesStats *stats )
+{
+  smallOnesData *so;
+  int areas;
+  int t;
+
+  memset ( stats, 0, sizeof ( smallOnesStats ));
+  stats->tiles = soMap->tiles;
+
+  for ( t = 0; t < soMap->tiles; t++ ) {
+    so = &(soMap->so[t]);
+    /* ACT_OFF << 0 to ACT_OFF << 3 */
+    areas = __builtin_popcount ( so->active & 0xf0 );
+    stats->nodes += areas;
+    stats->links += __builtin_popcount ( so->hasLower ) + __builtin_popcount ( so->hasRight );
+    if ( areas > stats->maxAreas ) stats->maxAreas = areas;
+  }
+} /* end statsPoints */
+
+static void
+jsonVehicle ( FILE *fp, vehicleType vehicle, mapStats *level, int *found,
+	      smallOnesStats *so, int first )
+{
+  int comma = FALSE;
+  int i;
+
+  fprintf ( fp, "%s%s    {%s      \"vehicle\": \"%s\",%s      \"levels\": [",
+	    first ? "" : ",", LINEFEED, LINEFEED, baseName[ vehicle ], LINEFEED );
+  for ( i = 0; i <= MAX_LEVEL; i++ ) {
+    if ( !found[i] ) continue;
+    fprintf ( fp, "%s%s        { \"level\": %d, \"tiles\": %d, \"dogo\": %d, \"nogo\": %d, "
+	      "\"mixed\": %d, \"mixedDensity\": %.4f, \"walkable\": %.4f }",
+	      comma ? "," : "", LINEFEED, i, level[i].tiles, level[i].doGo, level[i].noGo,
+	      level[i].mixed, ratio ( level[i].mixed, level[i].tiles ),
+	      ratio ( level[i].walkable, level[i].pixels ));
+    comma = TRUE;
+  }
+  fprintf ( fp, "%s      ],%s      \"smallOnes\": ", comma ? LINEFEED : "", LINEFEED );
+
+  if ( found[ MAX_LEVEL + 1 ] )
+    fprintf ( fp, "{ \"tiles\": %d, \"nodes\": %d, \"links\": %d, \"areasPerTile\": %.4f, "
+	      "\"maxAreas\": %d }", so->tiles, so->nodes, so->links,
+	      ratio ( so->nodes, so->tiles ), so->maxAreas );
+  else
+    fprintf ( fp, "null" );
+  fprintf ( fp, "%s    }", LINEFEED );
+} /* end jsonVehicle */
+
+/* paths can hold quotes and, on windows, backslashes */
+static void
+jsonString ( FILE *fp, char *s )
+{
+  fputc ( '"', fp );
+  for ( ; *s; s++ ) {
+    if (( *s == '"' ) || ( *s == '\\' )) fputc ( '\\', fp );
+    fputc ( *s, fp );
+  }
+  fputc ( '"', fp );
+} /* end jsonString */
+
+/* the map rows leave the smallOnes columns empty, and the other way */
+static void
+csvVehicle ( FILE *fp, vehicleType vehicle, mapStats *level, int *found,
+	     smallOnesStats *so )
+{
+  int i;
+
+  for ( i = 0; i <= MAX_LEVEL; i++ ) {
+    if ( !found[i] ) continue;
+    fprintf ( fp, "%s,map,%d,%d,%d,%d,%d,%.4f,%.4f,,,,%s", baseName[ vehicle ], i,
+	      level[i].tiles, level[i].doGo, level[i].noGo, level[i].mixed,
+	      ratio ( level[i].mixed, level[i].tiles ),
+	      ratio ( level[i].walkable, level[i].pixels ), LINEFEED );
+  }
+  if ( found[ MAX_LEVEL + 1 ] )
+    fprintf ( fp, "%s,smallOnes,0,%d,,,,,,%d,%d,%.4f,%d%s", baseName[ vehicle ],
+	      so->tiles, so->nodes, so->links, ratio ( so->nodes, so->tiles ),
+	      so->maxAreas, LINEFEED );
+} /* end csvVehicle */
+
+static double
+ratio ( double part, double whole )
+{
+  return whole ? part / whole : 0.0;
+} /* end ratio */
@@ -0,0 +1,61 @@
+/* stats.h - how much work each map makes for the pathfinder
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+
+/************************************  macros                 ***********************/
+
+/* formats of the report */
+#define STATS_JSON      1
+#define STATS_CSV       2
+
+/************************************  structures and enums  ************************/
+
+/* one level of one vehicle's map */
+typedef struct _mapStats
+{
+  int        tiles;
+  int        doGo;          /* uniform tiles */
+  int        noGo;
+  int        mixed;
+  long long  pixels;
+  long long  walkable;      /* DoGo pixels */
+} mapStats;
+
+/* ... and the smallOnes */
+typedef struct _smallOnesStats
+{
+  int  tiles;
+  int  nodes;               /* active points */
+  int  links;               /* lower and right */
+  int  maxAreas;            /* most points in a tile */
+} smallOnesStats;
+
+/************************************  prototypes             ***********************/
+
+void             writeStats       ( void );
+
+#endif /* __STATS_H__ */
@@ -0,0 +1,148 @@
+/* thumbnail.c - density thumbnails of pathfinding maps
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* a thumbnail is a small 8 bit gray picture of a map where each pixel is
+ * the share of NoGo's in the block of map pixels under it - black is all
+ * DoGo, white all NoGo. it is summed straight from the tile data: one
+ * color tiles are added in whole without looking at their bits, mixed
+ * tiles a row at a time with a popcount.
+ */
+
+/************************************  includes              ************************/
+#include "common.h"
+#include "commonutils.h"
+#include "image.h"
+#include "png.h"
+#include "thumbnail.h"
+
+/************************************  global variables      ************************/
+
+extern THREAD_LOCAL userData data;
+extern char *baseName[];
+
+/************************************  functions             ************************/
+
+void
+writeThumbnail ( pathfindingmap *map )
+{
+  unsigned int  *sum;
+  unsigned char *row;
+  pngStream     *png = NULL;
+  unsigned long long area;
+  int mapDim, dim, block;
+  int stride;
+  int tile;
+  int x, y;
+
+  if ( !map->tile || ( map->bytesPerRow > 8 ))
+    shutdown ( EF_BAD_DATA, "Can not make a thumbnail of the %s map\n",
+	       baseName[ map->io.vehicle ] );
+
+  /* the thumbnail is the biggest power of 2 that fits the asked for size
+   * and the map, so every pixel is the same square block of the map
+   */
+  mapDim = map->tilesPerRow * map->rowsPerTile;
+  for ( dim = 1; ( dim * 2 <= data.thumbSize ) && ( dim * 2 <= mapDim ); dim *= 2 );
+  block = mapDim / dim;
+  area  = (unsigned long long) block * block;
+
+  if ( !( sum = (unsigned int *) calloc ( sizeof ( unsigned int ), dim * dim )) ||
+       !( row = (unsigned char *) calloc ( dim + 4, 1 )))
+    shutdown ( EF_MALLOC, "Error creating %s thumbnail\n", baseName[ map->io.vehicle ] );
+
+  for ( tile = 0; tile < map->tiles; tile++ )
+    addThumbnailTile ( map, tile, sum, dim, block );
+
+  map->io.bits  = 8;
+  map->io.type |= FTF_GRAY;
+
+  /* png rows go top down, bitmap rows bottom up with 4 byte padding */
+  if ( map->io.type & FTF_PNG )
+    png = pngOpen ( map, map->fp, dim, dim );
+  else
+    writeBmpHeaderDim ( map, map->fp, dim, dim );
+  stride = (( dim + 3 ) / 4 ) * 4;
+
+  for ( y = 0; y < dim; y++ ) {
+    for ( x = 0; x < dim; x++ )
+      row[x] = (unsigned char) (( sum[ ( png ? dim - 1 - y : y ) * dim + x ] * 255ULL +
+				  area / 2 ) / area );
+    if ( png ) pngWriteRow ( png, row );
+    else if ( !fwrite ( row, stride, 1, map->fp ))
+      shutdown ( EF_FILE_WRITE, "Error writing to %s thumbnail\n",
+		 baseName[ map->io.vehicle ] );
+  }
+  if ( png ) pngClose ( png );
+
+  debug ( DBG_INFO, "%s %dx%d thumbnail, %d map pixels a side per pixel\n",
+	  baseName[ map->io.vehicle ], dim, dim, block );
+
+  free ( sum );
+  free ( row );
+} /* end writeThumbnail */
+
+void
+addThumbnailTile ( pathfindingmap *map, int tile, unsigned int *sum, int dim, int block )
+{
+  tileData *t;
+  unsigned long long bits;
+  unsigned long long mask;
+  int tileDim;
+  int x0, y0;
+  int x, y;
+  int i;
+
+  t       = &(map->tile[ tile ]);
+  tileDim = map->rowsPerTile;
+  x0      = ( tile % map->tilesPerRow ) * tileDim;
+  y0      = ( tile / map->tilesPerRow ) * tileDim;
+
+  if ( t->flag == TDT_DOGO ) return;
+
+  /* NoGo tiles fill every pixel they cover */
+  if ( t->flag == TDT_NOGO ) {
+    if ( block >= tileDim )
+      sum[ ( y0 / block ) * dim + x0 / block ] += tileDim * tileDim;
+    else
+      for ( y = y0 / block; y < ( y0 + tileDim ) / block; y++ )
+	for ( x = x0 / block; x < ( x0 + tileDim ) / block; x++ )
+	  sum[ y * dim + x ] += block * block;
+    return;
+  }
+
+  mask = ( block >= 64 ) ? ~0ULL : ( 1ULL << block ) - 1;
+  for ( y = 0; y < tileDim; y++ ) {
+    for ( bits = 0, i = map->bytesPerRow - 1; i >= 0; i-- )
+      bits = ( bits << 8 ) | t->bits[ y * map->bytesPerRow + i ];
+    if ( !bits ) continue;
+
+    /* a tile row is in one pixel, or split across several */
+    if ( block >= tileDim )
+      sum[ (( y0 + y ) / block ) * dim + x0 / block ] += __builtin_popcountll ( bits );
+    else
+      for ( x = 0; x < tileDim; x += block )
+	sum[ (( y0 + y ) / block ) * dim + ( x0 + x ) / block ] +=
+	  __builtin_popcountll (( bits >> x ) & mask );
+  }
+} /* end addThumbnailTile */
@@ -0,0 +1,416 @@
+/* update.c - rebuilding only the tiles that changed
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -U the files already in the output directory are taken as the
+ * last run's output. the level 0 map written then is read before anything
+ * is written this run and compared with the new input tile by tile. only
+ * the tiles that changed are worked on again:
+ *
+ *   - a compressed tile is made again if any of the four tiles below it
+ *     changed, the rest are taken from the last level file
+ *   - smallOnes are searched again for the changed tiles, and for the
+ *     tiles on their lower and right edges, since the links across an
+ *     edge are kept by the tile above or to the left. the tiles above and
+ *     to the left of those are searched too - their areas are needed to
+ *     find the links, and they come out the same as before
+ *   - info tiles are filled in again for the changed tiles
+ *
+ * the files come out the same as a full build. a missing file, or one that
+ * doesn't fit the new map, is made in full - as is everything after it.
+ *
+ * watching (-w) works the same way, except the last build's maps are still
+ * in memory - they are used in place of the files.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "smallones.h"
+#include "memory.h"
+#include "update.h"
+#include "islands.h"
+
+/************************************  macros                 ***********************/
+
+/* what is done again for a smallOnes tile */
+#define REDO_AREA 1
+#define REDO_LINK 2
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern char *inputType[];
+extern THREAD_LOCAL userData data;
+
+/* the level 0 map from the last run */
+static THREAD_LOCAL pathfindingmap prev;
+
+/* the maps of the last build, when they were kept */
+static THREAD_LOCAL pathfindingmap *retired = NULL;
+
+/************************************  functions             ************************/
+
+static pathfindingmap *
+findRetired ( int type, int vehicle, int level, int tilesPerRow, int rowsPerTile )
+{
+  pathfindingmap *m;
+
+  /* images of smallOnes and info maps are given the source's io, so go by
+   * what the map holds rather than what it says it is */
+  for ( m = retired; m; m = m->next ) {
+    if ( m->io.vehicle != vehicle ) continue;
+    if ( type == FTF_SO ) {
+      if ( m->so && ( m->tilesPerRow == tilesPerRow )) return m;
+    } else if ( m->tile && !m->so &&
+		( IMGTYPES( m->io.type ) & type ) && ( m->io.level == level ) &&
+		( m->rowsPerTile == rowsPerTile ) &&
+		( !tilesPerRow || ( m->tilesPerRow == tilesPerRow )))
+      return m;
+  }
+  return NULL;
+} /* end findRetired */
+
+static int
+loadPrevMap ( pathfindingmap *map, int type, int vehicle, int level,
+	      int tilesPerRow, int rowsPerTile )
+{
+  pathfindingmap *last;
+  mapFileHeader   header;
+  mapFileHeader   want;
+  char           *filename;
+  int             fits;
+
+  memset ( map, 0, sizeof ( pathfindingmap ));
+  map->io.path     = data.outpath;
+  map->io.type     = type;
+  map->io.vehicle  = vehicle;
+  map->io.level    = level;
+  map->tilesPerRow = map->tilesPerCol = tilesPerRow;
+  map->rowsPerTile = rowsPerTile;
+
+  /* the last build's map, if it's still around */
+  if (( last = findRetired ( type, vehicle, level, tilesPerRow, rowsPerTile ))) {
+    map->tile         = last->tile;
+    map->tiles        = last->tiles;
+    map->tilesPerRow  = last->tilesPerRow;
+    map->tilesPerCol  = last->tilesPerCol;
+    map->bytesPerRow  = last->bytesPerRow;
+    map->bytesPerTile = last->bytesPerTile;
+    map->res          = last->res;
+    last->tile = NULL;
+    return TRUE;
+  }
+  if ( !data.update ) return FALSE;
+
+  filename = fullPath ( map );
+  if ( !( map->fp = fopen ( filename, READ_MODE ))) {
+    debug ( DBG_NOTICE, "No previous %s %s level %d file: %s\n",
+	    baseName[vehicle], inputType[findLn2 ( type )], level, filename );
+    free ( filename );
+    return FALSE;
+  }
+
+  /* the header has to be the one this run would write - level 0 maps
+   * can be any size, that's checked against the input later */
+  fillHeader ( map, &want );
+  if ( !tilesPerRow ) want.ln2TilesPerRow = want.ln2TilesPerCol = -1;
+  fits = ( fread ( &header, sizeof ( mapFileHeader ), 1, map->fp ) &&
+	   ( header.ln2TilesPerRow == header.ln2TilesPerCol ) &&
+	   ( header.ln2TilesPerRow <= 8 ) &&
+	   (( want.ln2TilesPerRow < 0 ) || ( header.ln2TilesPerRow == want.ln2TilesPerRow )) &&
+	   ( header.ln2TileRes == want.ln2TileRes ) &&
+	   ( header.compLevel  == want.compLevel  ) &&
+	   ( header.isInfo     == want.isInfo     ) &&
+	   ( header.dataOffset == want.dataOffset ));
+
+  if ( fits ) {
+    rewind ( map->fp );
+    loadMapFile ( map );
+  } else
+    debug ( DBG_NOTICE, "Previous %s %s level %d file doesn't fit: %s\n",
+	    baseName[vehicle], inputType[findLn2 ( type )], level, filename );
+
+  fclose ( map->fp );
+  map->fp = NULL;
+  free ( filename );
+  return fits;
+} /* end loadPrevMap */
+
+static smallOnesData *
+loadPrevSmallOnes ( int vehicle, int tilesPerRow )
+{
+  pathfindingmap *last;
+  smallOnesData  *so = NULL;
+  FILE           *fp;
+  char           *filename;
+  int             dims[2];
+  int             tiles;
+
+  if (( last = findRetired ( FTF_SO, vehicle, 0, tilesPerRow, TILE_DIM ))) {
+    so = last->so;
+    last->so = NULL;
+    return so;
+  }
+  if ( !data.update ) return NULL;
+
+  filename = fullName ( data.outpath, FTF_SO, vehicle, 0 );
+  if ( !( fp = fopen ( filename, READ_MODE ))) {
+    debug ( DBG_NOTICE, "No previous %s smallOnes file: %s\n",
+	    baseName[vehicle], filename );
+    free ( filename );
+    return NULL;
+  }
+
+  tiles = tilesPerRow * tilesPerRow;
+  if ( fread ( dims, sizeof ( dims ), 1, fp ) &&
+       ( dims[0] == tilesPerRow ) && ( dims[1] == tilesPerRow ) &&
+       ( fseek ( fp, 0, SEEK_END ) == 0 ) &&
+       ( ftell ( fp ) == (long) ( sizeof ( dims ) + sizeof ( smallOnesData ) * tiles )) &&
+       ( fseek ( fp, sizeof ( dims ), SEEK_SET ) == 0 )) {
+
+    if ( !( so = ( smallOnesData * ) malloc ( sizeof ( smallOnesData ) * tiles )))
+      shutdown ( EF_MALLOC,
+		 "Error creating %s smallOnes data array.\n", baseName[vehicle] );
+    if ( !fread ( so, sizeof ( smallOnesData ) * tiles, 1, fp ))
+      shutdown ( EF_FILE_READ,
+		 "Error reading %s smallOnes data.\n", filename );
+  } else
+    debug ( DBG_NOTICE, "Previous %s smallOnes file doesn't fit: %s\n",
+	    baseName[vehicle], filename );
+
+  fclose ( fp );
+  free ( filename );
+  return so;
+} /* end loadPrevSmallOnes */
+
+void
+loadPrevious ( jobList *job )
+{
+  if ( !data.update || !job || prev.tile ) return;
+
+  /* a window patches the output directory - there is nothing to compare */
+  if ( data.writeflag & FTF_REGION ) {
+    debug ( DBG_WARN, "Ignoring %cU, it can't be used with %cW\n", COMSEP, COMSEP );
+    data.update = FALSE;
+    return;
+  }
+
+  /* read it now - the jobs are about to write over it */
+  if ( !loadPrevMap ( &prev, FTF_MAP, job->in.vehicle, 0, 0, TILE_DIM ))
+    debug ( DBG_WARN, "Nothing to update, making all %s files\n",
+	    baseName[job->in.vehicle] );
+} /* end loadPrevious */
+
+void
+markDirtyTiles ( pathfindingmap *map )
+{
+  int changed = 0;
+  int i;
+
+  if ( !prev.tile ) return;
+  if (( IMGTYPES( map->io.type ) != FTF_MAP ) || map->io.level || !map->tile ) return;
+
+  if (( prev.tiles != map->tiles ) || ( prev.bytesPerTile != map->bytesPerTile )) {
+    debug ( DBG_WARN, "Previous %s map is a different size, making all files\n",
+	    baseName[map->io.vehicle] );
+    return;
+  }
+
+  if ( map->dirty ) free ( map->dirty );
+  if ( !( map->dirty = (unsigned char *) calloc ( map->tiles, 1 )))
+    shutdown ( EF_MALLOC, "Error creating dirty tile array\n" );
+
+  for ( i = 0; i < map->tiles; i++ ) {
+    if ( prev.tile[i].flag != map->tile[i].flag )
+      map->dirty[i] = TRUE;
+    else if ( map->tile[i].flag == TDT_MIXED )
+      map->dirty[i] = ( memcmp ( prev.tile[i].bits, map->tile[i].bits,
+				 map->bytesPerTile ) != 0 );
+    changed += map->dirty[i];
+  }
+
+  debug ( DBG_NOTICE, "%d of %d %s tiles changed since the last run\n",
+	  changed, map->tiles, baseName[map->io.vehicle] );
+} /* end markDirtyTiles */
+
+int
+updateCompressed ( pathfindingmap *map, pathfindingmap *src )
+{
+  pathfindingmap last;
+  unsigned char *tileBuf = NULL;
+  unsigned char *dirty;
+  int row, col;
+  int curTile, srcTile;
+  int redone = 0;
+
+  /* a map made again doesn't keep what changed the last time */
+  if ( map->dirty ) free ( map->dirty );
+  map->dirty = NULL;
+
+  if ( !src->dirty || !map->tiles ) return FALSE;
+  if ( !loadPrevMap ( &last, FTF_MAP, map->io.vehicle, map->io.level,
+		      map->tilesPerRow, TILE_DIM )) return FALSE;
+
+  map->tile = last.tile;
+  if ( !( map->dirty = (unsigned char *) calloc ( map->tiles, 1 )))
+    shutdown ( EF_MALLOC, "Error creating dirty tile array\n" );
+
+  dirty = src->dirty;
+  for ( row = 0; row < map->tilesPerCol; row++ )
+    for ( col = 0; col < map->tilesPerRow; col++ ) {
+      curTile = row * map->tilesPerRow + col;
+      srcTile = row * 2 * src->tilesPerRow + col * 2;
+
+      /* only if one of the four tiles it's made from changed */
+      if ( !( dirty[ srcTile ] || dirty[ srcTile + 1 ] ||
+	      dirty[ srcTile + src->tilesPerRow ] ||
+	      dirty[ srcTile + src->tilesPerRow + 1 ] ))
+	continue;
+
+      if ( map->tile[ curTile ].bits ) free ( map->tile[ curTile ].bits );
+      map->tile[ curTile ].bits = NULL;
+      compressTile ( map, src->tile, col, row, &tileBuf );
+      map->dirty[ curTile ] = TRUE;
+      redone++;
+    }
+  if ( tileBuf ) free ( tileBuf );
+
+  debug ( DBG_NOTICE, "Updated %d of %d %s level %d tiles\n",
+	  redone, map->tiles, baseName[map->io.vehicle], map->io.level );
+  return TRUE;
+} /* end updateCompressed */
+
+int
+updateSmallOnes ( pathfindingmap *soMap, pathfindingmap *srcMap )
+{
+  smallOnesData *so;
+  unsigned char *dirty;
+  unsigned char *redo;
+  int row, col;
+  int curTile;
+  int width;
+  int redone = 0;
+
+  if ( !( dirty = srcMap->dirty )) return FALSE;
+  /* islands dropped last time can't be brought back one tile at a time */
+  if ( data.minIsland || ( data.islands & ISL_SPAWNS )) return FALSE;
+  if ( !( so = loadPrevSmallOnes ( soMap->io.vehicle, soMap->tilesPerRow ))) return FALSE;
+
+  soMap->so = so;
+  if (!( soMap->img =
+	 (tileImageData *) calloc ( sizeof ( tileImageData ) * soMap->tiles, 1 )))
+    shutdown ( EF_MALLOC,
+	       "Memory allocation error creating tile image buffer\n" );
+  soMap->tile = copyTiles ( srcMap );
+
+  if ( !( redo = (unsigned char *) calloc ( soMap->tiles, 1 )))
+    shutdown ( EF_MALLOC, "Error creating smallOnes update array\n" );
+
+  /* a tile's links are set when the tile below or to the right of it is
+   * searched - those are searched again, along with the tiles they link to
+   */
+  width = soMap->tilesPerRow;
+  for ( row = 0; row < soMap->tilesPerCol; row++ )
+    for ( col = 0; col < width; col++ ) {
+      curTile = row * width + col;
+      if ( !( dirty[ curTile ] ||
+	      (( row > 0 ) && dirty[ curTile - width ] ) ||
+	      (( col > 0 ) && dirty[ curTile - 1 ] )))
+	continue;
+      redo[ curTile ] |= REDO_AREA | REDO_LINK;
+      if ( row > 0 ) redo[ curTile - width ] |= REDO_AREA;
+      if ( col > 0 ) redo[ curTile - 1 ]     |= REDO_AREA;
+    }
+
+  /* in the same order as a full search */
+  for ( row = 0; row < soMap->tilesPerCol; row++ )
+    for ( col = 0; col < width; col++ ) {
+      curTile = row * width + col;
+      if ( !redo[ curTile ] ) continue;
+
+      if ( redo[ curTile ] & REDO_LINK ) {
+	if ( row > 0 ) so[ curTile - width ].hasLower = 0;
+	if ( col > 0 ) so[ curTile - 1 ].hasRight     = 0;
+	redone++;
+      }
+      memset ( so[ curTile ].pt, 0, sizeof ( so[ curTile ].pt ));
+      so[ curTile ].active = 0;
+
+      tileSmallOnes ( soMap, curTile );
+    }
+  free ( redo );
+
+  debug ( DBG_NOTICE, "Updated %d of %d %s smallOnes tiles\n",
+	  redone, soMap->tiles, baseName[soMap->io.vehicle] );
+  return TRUE;
+} /* end updateSmallOnes */
+
+int
+updateInfo ( pathfindingmap *infoMap, pathfindingmap *soMap, unsigned char *dirty )
+{
+  pathfindingmap last;
+  int tile;
+  int redone = 0;
+
+  if ( !dirty ) return FALSE;
+  if ( !loadPrevMap ( &last, FTF_INFO, infoMap->io.vehicle, infoMap->io.level,
+		      infoMap->tilesPerRow, infoMap->rowsPerTile )) return FALSE;
+
+  if ( last.bytesPerTile != infoMap->bytesPerTile ) {
+    freeTiles ( &last, &(last.tile) );
+    return FALSE;
+  }
+
+  infoMap->tile = last.tile;
+  for ( tile = 0; tile < infoMap->tiles; tile++ ) {
+    if ( !dirty[ tile ] ) continue;
+    if ( infoMap->tile[ tile ].bits ) free ( infoMap->tile[ tile ].bits );
+    infoMap->tile[ tile ].bits = NULL;
+    infoTile ( infoMap, soMap, tile );
+    redone++;
+  }
+
+  debug ( DBG_NOTICE, "Updated %d of %d %s info tiles\n",
+	  redone, infoMap->tiles, baseName[infoMap->io.vehicle] );
+  return TRUE;
+} /* end updateInfo */
+
+void
+keepPrevious ( pathfindingmap *maps )
+{
+  freeUpdate ();
+  retired = maps;
+
+  /* the level 0 map the new one is compared with */
+  if ( maps ) loadPrevMap ( &prev, FTF_MAP, maps->io.vehicle, 0, 0, TILE_DIM );
+} /* end keepPrevious */
+
+void
+freeUpdate ( void )
+{
+  if ( prev.tile ) freeTiles ( &prev, &(prev.tile) );
+  while ( retired ) retired = freeMap ( &retired );
+} /* end freeUpdate */
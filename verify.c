@@ -0,0 +1,288 @@
+/* verify.c - checking smallOnes against the level 0 map
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -Y, the smallOnes in a .raw or .txt file are checked against the
+ * level 0 map they are for. the game says nothing about smallOnes that
+ * are wrong, the bots just get lost.
+ *
+ * the area around each point is filled again, a tile at a time, from the
+ * map's bits - a row of a tile is one 64 bit word - and only its edges
+ * are kept. a point has to be on DoGo, and a link has to join areas that
+ * touch straight across the edge of the tiles, as genSmallOnes links
+ * them. areas that touch with no link between their points are reported
+ * too.
+ *
+ * every problem is a line in VehicleVerify.txt, in the tile and point
+ * notation of the smallOnes text files. the program ends with an error
+ * if anything was found, so a mod can be checked by a build script.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "memory.h"
+#include "smallones.h"
+#include "textfile.h"
+#include "reach.h"
+#include "verify.h"
+
+/************************************  global variables      ************************/
+
+extern char *baseName[];
+extern THREAD_LOCAL userData data;
+
+/************************************  prototypes             ***********************/
+
+static pathfindingmap *loadPoints   ( mapIOData *in );
+static void            tileEdges    ( verifyData *vd, int tile );
+static void            checkLinks   ( verifyData *vd, int tile, int next, int isLower );
+static void            report       ( verifyData *vd, verifyProblem problem,
+				      int tile, int i, int next, int j );
+
+/************************************  functions             ************************/
+
+void
+verifySmallOnes ( mapIOData *in )
+{
+  mapIOData out = {0};
+  verifyData vd;
+  char buffer[ BUF_SIZE ];
+  int problems;
+  int tile;
+  int i;
+
+  if ( !( in->type & FTF_MAP ) || in->level ) {
+    debug ( DBG_WARN, "SmallOnes are only checked against a level 0 search map, not %s\n",
+	    in->path );
+    return;
+  }
+
+  memset ( &vd, 0, sizeof ( verifyData ));
+  out.path    = data.outpath;
+  out.vehicle = in->vehicle;
+  out.type    = FTF_MAP;
+  if ( !( vd.map = getMap ( &(data.maps), in, &out )))
+    shutdown ( EF_FILE_READ, "Error loading %s\n", in->path );
+  if ( !( vd.soMap = loadPoints ( in ))) return;
+
+  if (( vd.soMap->tilesPerRow != vd.map->tilesPerRow ) ||
+      ( vd.map->rowsPerTile != TILE_DIM ) || ( vd.map->bytesPerRow != ROW_BYTES ))
+    shutdown ( EF_BAD_DATA, "%s smallOnes are for a %d pixel map, not %d\n",
+	       baseName[ in->vehicle ], vd.soMap->tilesPerRow * TILE_DIM, vd.map->res );
+
+  if ( !( vd.edge = (verifyEdges *) calloc ( sizeof ( verifyEdges ), vd.soMap->tiles * 4 )))
+    shutdown ( EF_MALLOC, "Memory allocation error checking the %s smallOnes\n",
+	       baseName[ in->vehicle ] );
+
+  snprintf ( buffer, BUF_SIZE, FILENAME_VERIFY,
+	     data.outpath, PATHSEP, baseName[ in->vehicle ] );
+  if ( !( vd.fp = fopen ( buffer, WRITE_MODE )))
+    shutdown ( EF_FILE_OPEN, "Error opening %s for writing\n", buffer );
+
+  /* the points first, their edges are needed by the links both ways */
+  for ( tile = 0; tile < vd.soMap->tiles; tile++ ) tileEdges ( &vd, tile );
+  for ( tile = 0; tile < vd.soMap->tiles; tile++ ) {
+    if ( tile / vd.soMap->tilesPerRow < vd.soMap->tilesPerCol - 1 )
+      checkLinks ( &vd, tile, tile + vd.soMap->tilesPerRow, TRUE );
+    if ( tile % vd.soMap->tilesPerRow < vd.soMap->tilesPerRow - 1 )
+      checkLinks ( &vd, tile, tile + 1, FALSE );
+  }
+
+  for ( problems = i = 0; i < VP_COUNT; i++ ) problems += vd.count[i];
+  fprintf ( vd.fp, "# %d points, %d links: %d on NoGo, %d apart, %d to no point, %d missing%s",
+	    vd.points, vd.links, vd.count[ VP_NOGO ], vd.count[ VP_APART ],
+	    vd.count[ VP_ABSENT ], vd.count[ VP_UNLINKED ], LINEFEED );
+  if ( fclose ( vd.fp ))
+    shutdown ( EF_FILE_WRITE, "Error writing %s\n", buffer );
+
+  debug ( problems ? DBG_WARN : DBG_NOTICE, "%s smallOnes: %d problems, see %s\n",
+	  baseName[ in->vehicle ], problems, buffer );
+  data.problems += problems;
+
+  free ( vd.edge );
+  freeMap ( &(vd.soMap) );
+} /* end verifySmallOnes */
+
+/* the vehicle's smallOnes from -Y, a file or Vehicle.raw or .txt in a
+ * directory. read here, so no islands are dropped from them */
+static pathfindingmap *
+loadPoints ( mapIOData *in )
+{
+  char path[ BUF_SIZE ];
+  int isText;
+
+  snprintf ( path, BUF_SIZE, "%s", data.verifyPath );
+  if ( isDir ( data.verifyPath )) {
+    snprintf ( path, BUF_SIZE, FILENAME_SO_RAW,
+	       data.verifyPath, PATHSEP, baseName[ in->vehicle ] );
+    if ( !isFile ( path ))
+      snprintf ( path, BUF_SIZE, FILENAME_TXT,
+		 data.verifyPath, PATHSEP, baseName[ in->vehicle ] );
+    if ( !isFile ( path )) {
+      debug ( DBG_WARN, "There are no %s smallOnes in %s to check\n",
+	      baseName[ in->vehicle ], data.verifyPath );
+      return NULL;
+    }
+  }
+  isText = ( strlen ( path ) > 4 ) && !strcmp ( path + strlen ( path ) - 4, FILE_TXT_EXT );
+
+  return readMapFile ( path, isText ? FTF_TXT : FTF_SO, in->vehicle, 0 );
+} /* end loadPoints */
+
+/* fill the area around each point of a tile, keep its edges */
+static void
+tileEdges ( verifyData *vd, int tile )
+{
+  smallOnesData *so;
+  tileData *src;
+  verifyEdges *edge;
+  reachWord pass[ TILE_DIM ];
+  reachWord area[ TILE_DIM ];
+  reachWord word, near;
+  int col, row;
+  int changed;
+  int i, r;
+
+  so  = &(vd->soMap->so[ tile ]);
+  src = &(vd->map->tile[ tile ]);
+  if ( !( so->active & 0xf0 )) return;
+
+  for ( r = 0; r < TILE_DIM; r++ ) {
+    if ( src->flag != TDT_MIXED ) {
+      pass[r] = ( src->flag == TDT_DOGO ) ? ~0ULL : 0;
+      continue;
+    }
+    for ( word = 0, i = ROW_BYTES - 1; i >= 0; i-- )
+      word = ( word << 8 ) | src->bits[ r * ROW_BYTES + i ];
+    pass[r] = ~word;
+  }
+
+  for ( i = 0; i < 4; i++ ) {
+    if ( !( so->active & ( ACT_OFF << i ))) continue;
+    vd->points++;
+    edge = &(vd->edge[ tile * 4 + i ]);
+
+    /* points flagged P in the text files are 64 pixels off */
+    col = so->pt[i][0] % TILE_DIM;
+    row = so->pt[i][1] % TILE_DIM;
+    if ( !(( pass[ row ] >> col ) & 1 )) {
+      report ( vd, VP_NOGO, tile, i, -1, -1 );
+      continue;
+    }
+
+    /* the 8 pixels around, down the tile and back until it stops growing */
+    memset ( area, 0, sizeof ( area ));
+    area[ row ] = fillRow ( 1ULL << col, pass[ row ] );
+    do {
+      changed = FALSE;
+      for ( r = 0; r < 2 * TILE_DIM; r++ ) {
+	row  = ( r < TILE_DIM ) ? r : 2 * TILE_DIM - 1 - r;
+	near = (( row > 0 ) ? area[ row - 1 ] : 0 ) | (( row < TILE_DIM - 1 ) ? area[ row + 1 ] : 0 );
+	if ( !near ) continue;
+	word = fillRow ( area[ row ] | near | ( near << 1 ) | ( near >> 1 ), pass[ row ] );
+	if ( word != area[ row ] ) {
+	  area[ row ] = word;
+	  changed     = TRUE;
+	}
+      }
+    } while ( changed );
+
+    edge->first = area[0];
+    edge->last  = area[ TILE_DIM - 1 ];
+    for ( r = 0; r < TILE_DIM; r++ ) {
+      edge->left  |= ( area[r] & 1 ) << r;
+      edge->right |= ( area[r] >> ( TILE_DIM - 1 )) << r;
+      edge->size  += __builtin_popcountll ( area[r] );
+    }
+  }
+} /* end tileEdges */
+
+/* the links from the points of tile to those of the next tile down or
+ * right, and the links that should be there */
+static void
+checkLinks ( verifyData *vd, int tile, int next, int isLower )
+{
+  smallOnesData *so;
+  verifyEdges *a, *b;
+  int links;
+  int touch;
+  int i, j;
+
+  so    = vd->soMap->so;
+  links = isLower ? so[ tile ].hasLower : so[ tile ].hasRight;
+
+  for ( i = 0; i < 4; i++ )
+    for ( j = 0; j < 4; j++ ) {
+      a = &(vd->edge[ tile * 4 + i ]);
+      b = &(vd->edge[ next * 4 + j ]);
+      touch = isLower ? ( a->last & b->first ) != 0 : ( a->right & b->left ) != 0;
+
+      if ( links & ( 1 << ( i * 4 + j ))) {
+	vd->links++;
+	if ( !( so[ tile ].active & ( ACT_OFF << i )) || !( so[ next ].active & ( ACT_OFF << j )))
+	  report ( vd, VP_ABSENT, tile, i, next, j );
+	/* points on NoGo are already reported */
+	else if ( a->size && b->size && !touch )
+	  report ( vd, VP_APART, tile, i, next, j );
+      } else if ( touch )
+	report ( vd, VP_UNLINKED, tile, i, next, j );
+    }
+} /* end checkLinks */
+
+static void
+report ( verifyData *vd, verifyProblem problem, int tile, int i, int next, int j )
+{
+  smallOnesData *so;
+  int tilesPerRow;
+
+  so          = vd->soMap->so;
+  tilesPerRow = vd->soMap->tilesPerRow;
+  vd->count[ problem ]++;
+
+  fprintf ( vd->fp, "tile: %02dx%02d:%d pt: %02dx%02d ", tile % tilesPerRow, tile / tilesPerRow, i,
+	    so[ tile ].pt[i][0] % TILE_DIM, so[ tile ].pt[i][1] % TILE_DIM );
+  switch ( problem )
+    {
+    case VP_NOGO:
+      fprintf ( vd->fp, "is on NoGo" );
+      break;
+    case VP_APART:
+      fprintf ( vd->fp, "links to %02dx%02d:%d, their areas don't touch",
+		next % tilesPerRow, next / tilesPerRow, j );
+      break;
+    case VP_ABSENT:
+      fprintf ( vd->fp, "links to %02dx%02d:%d, one of them isn't set",
+		next % tilesPerRow, next / tilesPerRow, j );
+      break;
+    case VP_UNLINKED:
+      fprintf ( vd->fp, "doesn't link to %02dx%02d:%d, their areas touch",
+		next % tilesPerRow, next / tilesPerRow, j );
+      break;
+    default:
+      break;
+    }
+  fprintf ( vd->fp, "%s", LINEFEED );
+} /* end report */
@@ -0,0 +1,66 @@
+/* verify.h - checking smallOnes against the level 0 map
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __VERIFY_H__
+#define __VERIFY_H__
+
+
+/************************************  structures and enums  ************************/
+
+/* what a smallOnes point or link can have wrong with it */
+typedef enum _verifyProblem
+  {
+    VP_NOGO = 0,    /* a point on a NoGo pixel */
+    VP_APART,       /* a link between areas that don't touch */
+    VP_ABSENT,      /* a link to a point that isn't there */
+    VP_UNLINKED,    /* areas that touch with no link */
+    VP_COUNT
+  } verifyProblem;
+
+/* the edges of the area around a point, bit n is pixel n along the edge */
+typedef struct _verifyEdges
+{
+  reachWord  first;   /* row 0 */
+  reachWord  last;    /* row 63, next to the next row of tiles */
+  reachWord  left;    /* col 0 */
+  reachWord  right;   /* col 63 */
+  int        size;    /* pixels in the area, 0 if the point isn't on DoGo */
+} verifyEdges;
+
+typedef struct _verifyData
+{
+  pathfindingmap *map;
+  pathfindingmap *soMap;
+  verifyEdges    *edge;     /* tile * 4 + point */
+  int             points;
+  int             links;
+  int             count[ VP_COUNT ];
+  FILE           *fp;
+} verifyData;
+
+/************************************  prototypes             ***********************/
+
+void             verifySmallOnes  ( mapIOData *in );
+
+#endif /* __VERIFY_H__ */
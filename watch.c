@@ -0,0 +1,264 @@
+/* watch.c - rebuilding the game files when the input changes
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/* with -w genPathmaps doesn't stop after the first build. the input -
+ * one file, or every level 0 image in a directory - is watched with
+ * inotify, and when an editor saves one the game files of that vehicle are
+ * built again. saves come in bursts, so a build waits until the files have
+ * been quiet for WATCH_QUIET_MS.
+ *
+ * the maps of the last build stay in memory and are handed to update.c,
+ * so only the tiles that changed are worked on. the maps of the other
+ * vehicles are left alone.
+ *
+ * an error while building goes back to waiting instead of exiting: the
+ * maps of the file that failed are freed, and it is built in full the next
+ * time it is saved.
+ */
+
+/************************************  includes              ************************/
+
+#include "common.h"
+#include "commonutils.h"
+#include "pathfindingmap.h"
+#include "registry.h"
+#include "cache.h"
+#include "update.h"
+#include "watch.h"
+
+#ifdef HAS_INOTIFY
+  #include <dirent.h>
+  #include <poll.h>
+  #include <pthread.h>
+  #include <sys/inotify.h>
+  #include <sys/time.h>
+#endif
+
+/************************************  global variables      ************************/
+
+extern THREAD_LOCAL userData data;
+
+static jmp_buf watchEnv;
+static int     armed = FALSE;
+
+#ifdef HAS_INOTIFY
+
+/* output flags as they came from the command line - reading a file's
+ * name changes them */
+static int       writeflag;
+static char     *watchDir  = NULL;
+static char     *watchName = NULL;
+static pthread_t mainThread;
+
+/************************************  functions             ************************/
+
+static int
+isWatchedFile ( char *path, int *vtype, int *level )
+{
+  data.writeflag = writeflag;
+  data.readflag  = RF_NONE;
+  if ( !isPathmapFile ( path, vtype, level )) return FALSE;
+
+  /* a watched file is built whatever it is - in a directory only the
+   * level 0 images are, the game files written there are not */
+  return ( watchName ||
+	   ((( data.readflag == RF_BMP ) || ( data.readflag == RF_RAW )) && !*level ));
+} /* end isWatchedFile */
+
+static void
+buildFile ( char *path, void (*runJobs) ( void ))
+{
+  struct timeval  start;
+  struct timeval  end;
+  pathfindingmap *map;
+  jobList        *job;
+  int vtype, level;
+
+  if ( !isWatchedFile ( path, &vtype, &level )) return;
+  gettimeofday ( &start, NULL );
+
+  if ( setjmp ( watchEnv )) {
+    /* drop what was made of this file - it starts over next time */
+    while (( job = data.jobs )) {
+      data.jobs = job->next;
+      freeJob ( job );
+    }
+    map = releaseMaps ( path );
+    while ( map ) map = freeMap ( &map );
+    freeUpdate ();
+    debug ( DBG_WARN, "%s was not built, waiting for it to change\n", path );
+    return;
+  }
+  armed = TRUE;
+
+  /* the last build of this file is what the new one is compared with */
+  cacheForget ();
+  keepPrevious ( releaseMaps ( path ));
+  addVehicle ( path, vtype, level );
+  loadPrevious ( data.jobs );
+  runJobs ();
+  freeUpdate ();
+
+  armed = FALSE;
+  gettimeofday ( &end, NULL );
+  debug ( DBG_WARN, "Built %s in %.2f seconds\n", path,
+	  ( end.tv_sec - start.tv_sec ) + ( end.tv_usec - start.tv_usec ) / 1e6 );
+} /* end buildFile */
+
+static void
+buildDir ( void (*runJobs) ( void ))
+{
+  char           path[ BUF_SIZE ];
+  DIR           *dir;
+  struct dirent *entry;
+
+  if ( !( dir = opendir ( watchDir )))
+    shutdown ( EF_FILE_OPEN, "Error reading directory: %s\n", watchDir );
+  while (( entry = readdir ( dir ))) {
+    if ( snprintf ( path, BUF_SIZE, "%s%c%s", watchDir, PATHSEP, entry->d_name ) >= BUF_SIZE ) {
+      debug ( DBG_WARN, "Path too long, not built: %s%c%s\n", watchDir, PATHSEP, entry->d_name );
+      continue;
+    }
+    buildFile ( path, runJobs );
+  }
+  closedir ( dir );
+} /* end buildDir */
+
+static int
+queueFile ( char **pending, int count, char *name )
+{
+  char path[ BUF_SIZE ];
+  int  i;
+
+  if ( watchName && strcmp ( name, watchName )) return count;
+  if ( snprintf ( path, BUF_SIZE, "%s%c%s", watchDir, PATHSEP, name ) >= BUF_SIZE ) {
+    debug ( DBG_WARN, "Path too long, not built: %s%c%s\n", watchDir, PATHSEP, name );
+    return count;
+  }
+
+  /* saved more than once - it's only built once */
+  for ( i = 0; i < count; i++ )
+    if ( !strcmp ( pending[i], path )) return count;
+  if ( count == WATCH_PENDING ) {
+    debug ( DBG_WARN, "Too many files changed, skipping %s\n", path );
+    return count;
+  }
+  pending[ count ] = dupString ( path );
+  return count + 1;
+} /* end queueFile */
+
+void
+watchInput ( void (*runJobs) ( void ))
+{
+  char                  buffer[ 4096 ] __attribute__ ((aligned ( __alignof__ ( struct inotify_event ))));
+  char                 *pending[ WATCH_PENDING ];
+  char                 *p;
+  struct inotify_event *event;
+  struct pollfd         pfd;
+  int count, timeout;
+  int len, i;
+
+  if ( !data.inpath || !data.outpath )
+    shutdown ( EF_DATA_MISSING, "Insufficient arguments\n" );
+  if ( !isDir ( data.outpath ))
+    shutdown ( EF_DATA_MISSING, "Output directory malformed\n" );
+
+  writeflag  = data.writeflag;
+  mainThread = pthread_self ();
+
+  /* a directory, or the directory the file is in */
+  if ( isDir ( data.inpath ))
+    watchDir = dupString ( data.inpath );
+  else if (( p = strrchr ( data.inpath, PATHSEP ))) {
+    watchDir  = dupString ( data.inpath );
+    watchDir[ p - data.inpath ] = '\0';
+    watchName = p + 1;
+  } else {
+    watchDir  = dupString ( "." );
+    watchName = data.inpath;
+  }
+
+  /* editors write the file or rename a new one over it */
+  pfd.events = POLLIN;
+  if ((( pfd.fd = inotify_init ()) < 0 ) ||
+      ( inotify_add_watch ( pfd.fd, watchDir, IN_CLOSE_WRITE | IN_MOVED_TO ) < 0 ))
+    shutdown ( EF_FILE_OPEN, "Error watching directory: %s\n", watchDir );
+
+  /* named the way changes to it will be */
+  if ( watchName ) {
+    if ( snprintf ( buffer, BUF_SIZE, "%s%c%s", watchDir, PATHSEP, watchName ) >= BUF_SIZE )
+      shutdown ( EF_DATA_MISSING, "Path too long: %s\n", data.inpath );
+    buildFile ( buffer, runJobs );
+  } else buildDir ( runJobs );
+  debug ( DBG_WARN, "Watching %s for changes\n", data.inpath );
+
+  for (;;) {
+    /* whoever is watching the output may not be a terminal */
+    fflush ( stdout );
+
+    /* wait for a change, then for the saves to stop */
+    count   = 0;
+    timeout = -1;
+    while ( poll ( &pfd, 1, timeout ) > 0 ) {
+      if (( len = read ( pfd.fd, buffer, sizeof ( buffer ))) <= 0 ) break;
+      for ( p = buffer; p < buffer + len;
+	    p += sizeof ( struct inotify_event ) + event->len ) {
+	event = (struct inotify_event *) p;
+	if ( event->len ) count = queueFile ( pending, count, event->name );
+      }
+      timeout = WATCH_QUIET_MS;
+    }
+
+    for ( i = 0; i < count; i++ ) {
+      buildFile ( pending[i], runJobs );
+      free ( pending[i] );
+    }
+  }
+} /* end watchInput */
+
+#else
+
+void
+watchInput ( void (*runJobs) ( void ))
+{
+  shutdown ( EF_NOT_SUPPORTED, "Watching for changes needs inotify\n" );
+} /* end watchInput */
+
+#endif /* HAS_INOTIFY */
+
+void
+watchRecover ( int err )
+{
+  if ( !armed || !err ) return;
+
+#ifdef HAS_INOTIFY
+  /* only the thread running the jobs can go back to waiting */
+  if ( !pthread_equal ( pthread_self (), mainThread )) return;
+#endif
+
+  armed = FALSE;
+  /* the map that failed to load is not linked anywhere freeAll looks */
+  dropLoad ();
+  longjmp ( watchEnv, err );
+} /* end watchRecover */
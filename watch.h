@@ -0,0 +1,51 @@
+/* watch.h - rebuilding when the input changes header file
+ *
+ * This file is part of genPathmaps - a utility for Battlefield 1942
+ *
+ * Copyright 2004 William Murphy
+ *
+ * Author: William Murphy - glyph@intergate.com
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __WATCH_H__
+#define __WATCH_H__
+
+
+/************************************  includes              ************************/
+
+#include <setjmp.h>
+
+/************************************  macros                 ***********************/
+
+/* inotify is linux only */
+#if defined ( IS_UNIX ) && defined ( __linux__ )
+  #define HAS_INOTIFY
+#endif
+
+/* editors save in bursts - wait this long for the file to be quiet */
+#define WATCH_QUIET_MS 300
+
+/* files that can be waiting to be built at once */
+#define WATCH_PENDING 16
+
+/************************************  prototypes             ***********************/
+
+void            watchInput      ( void (*runJobs) ( void ));
+void            watchRecover    ( int err );
+
+#endif /* __WATCH_H__ */